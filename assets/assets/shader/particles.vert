@@ -6,12 +6,11 @@ attribute vec2 uv;
 attribute vec2 position;
 attribute vec4 color;
 attribute vec2 size;
-attribute float frame;
 attribute float rotation;
+attribute vec4 uv_rect; // region of the current frame on the atlas page
 
 uniform mat4 vp;
 uniform float layer;
-uniform float frames;
 
 varying vec2 tex_coords;
 varying vec4 fcolor;
@@ -27,6 +26,6 @@ void main() {
 
 	gl_Position = vp * vec4(epos.x, epos.y, layer, 1.0);
 
-	tex_coords = vec2(uv.x*((frame+1.0)/frames), uv.y);
+	tex_coords = mix(uv_rect.xy, uv_rect.zw, uv);
 	fcolor = color;
 }
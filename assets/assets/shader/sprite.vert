@@ -1,17 +1,17 @@
 #version 100
-precision mediump float;
+precision highp float; // positions are in fixed point units (up to 32767)
 
-attribute vec3 position;
-attribute vec2 vertexUV;
+attribute vec2 position;
+attribute vec2 uv;
+attribute float layer;
 
 varying vec2 UV;
 
 uniform mat4 MVP;
 
 void main(){
-	vec4 v = vec4(position.xyz, 1);
-	gl_Position = MVP * v;
+	gl_Position = MVP * vec4(position, layer, 1);
 
-	UV = vertexUV;
+	UV = uv;
 }
 
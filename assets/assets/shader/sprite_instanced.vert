@@ -0,0 +1,26 @@
+#version 100
+precision highp float; // positions are in fixed point units (up to 32767)
+
+attribute vec2 corner;
+attribute vec2 position;
+attribute vec2 layer_rotation;
+attribute vec4 uv_rect;
+
+varying vec2 UV;
+
+uniform mat4 MVP;
+uniform vec2 texture_size; // in the units of position
+
+void main(){
+	vec2 half_size = (uv_rect.zw - uv_rect.xy) * texture_size * 0.5;
+	vec2 local = corner * half_size;
+	float rotation = layer_rotation.y * 3.14159265;
+	float c = cos(rotation);
+	float s = sin(rotation);
+	vec2 p = position + vec2(c*local.x - s*local.y, s*local.x + c*local.y);
+
+	gl_Position = MVP * vec4(p, layer_rotation.x, 1);
+
+	UV = mix(uv_rect.xy, uv_rect.zw, corner*0.5 + 0.5);
+}
+
@@ -7,6 +7,7 @@
 
 #include <cstring>
 #include <cstdio>
+#include <fstream>
 
 #ifdef WIN
 	#include <windows.h>
@@ -36,6 +37,9 @@ namespace {
 	std::string append_file(const std::string& folder, const std::string file) {
 		return folder+PHYSFS_getDirSeparator()+file;
 	}
+	bool is_absolute(const std::string& path) {
+		return !path.empty() && (path[0]=='/' || path[0]=='\\' || (path.size()>1 && path[1]==':'));
+	}
 	void create_dir(const std::string& dir) {
 #ifdef WIN
 		CreateDirectory(dir.c_str(), NULL);
@@ -91,7 +95,8 @@ namespace {
 namespace mo {
 namespace asset {
 
-	Asset_manager::Asset_manager(const std::string& exe_name, const std::string& app_name) {
+	Asset_manager::Asset_manager(const std::string& exe_name, const std::string& app_name,
+	                             const std::string& root_dir, const std::string& write_dir) {
 		if(!PHYSFS_init(exe_name.empty() ? nullptr : exe_name.c_str()))
 			FAIL("PhysFS-Init failed for \""<<exe_name<<"\": "<< PHYSFS_getLastError());
 
@@ -125,28 +130,33 @@ namespace asset {
 		write_dir_parent = "/persistent_data";
 #endif
 
-		create_dir(write_dir_parent);
-
-		std::string write_dir = write_dir_parent+PHYSFS_getDirSeparator()+app_name;
-		create_dir(write_dir);
+		auto write_path = write_dir;
+		if(write_path.empty()) {
+			create_dir(write_dir_parent);
+			write_path = write_dir_parent+PHYSFS_getDirSeparator()+app_name;
+		}
+		create_dir(write_path);
 
+		auto root = root_dir.empty() ? pwd() : root_dir;
 
 		if(!PHYSFS_addToSearchPath(PHYSFS_getBaseDir(), 1) ||
 				!PHYSFS_addToSearchPath(append_file(PHYSFS_getBaseDir(), "..").c_str(), 1)  ||
-				!PHYSFS_addToSearchPath(pwd().c_str(), 1) ||
-				!PHYSFS_addToSearchPath(write_dir.c_str(), 0))
+				!PHYSFS_addToSearchPath(root.c_str(), 1) ||
+				!PHYSFS_addToSearchPath(write_path.c_str(), 0))
 			FAIL("Unable to construct search path: "<< PHYSFS_getLastError());
 		
 		// add optional search path
 		PHYSFS_addToSearchPath(append_file(append_file(append_file(PHYSFS_getBaseDir(), ".."), "magnum_opus"), "assets").c_str(), 1);
 
-		if(!PHYSFS_setWriteDir(write_dir.c_str()))
-			FAIL("Unable to set write-dir to \""<<write_dir<<"\": "<< PHYSFS_getLastError());
+		if(!PHYSFS_setWriteDir(write_path.c_str()))
+			FAIL("Unable to set write-dir to \""<<write_path<<"\": "<< PHYSFS_getLastError());
 
 
-		auto add_source = [](const char* path){
-			if(!PHYSFS_addToSearchPath(path, 1))
-				WARN("Error adding custom archive \""<<path<<"\": "<<PHYSFS_getLastError());
+		// archives are relative to the root directory
+		auto add_source = [&](const std::string& path){
+			auto native = is_absolute(path) ? path : append_file(root, path);
+			if(!PHYSFS_addToSearchPath(native.c_str(), 1))
+				WARN("Error adding custom archive \""<<native<<"\": "<<PHYSFS_getLastError());
 		};
 
 		auto archive_file = _open("archives.lst");
@@ -179,7 +189,7 @@ namespace asset {
 			// load other archives
 			archive_file.process([&](istream& in) {
 				for(auto&& l : in.lines()) {
-					add_source(l.c_str());
+					add_source(l);
 				}
 			});
 		}
@@ -222,13 +232,25 @@ namespace asset {
 		return bdir;
 	}
 
-	std::vector<AID> Asset_manager::list(Asset_type type) {
+	std::vector<AID> Asset_manager::list(Asset_type type, const std::string& prefix) {
 		std::vector<AID> res;
 
-		_base_dir(type).process([&](const std::string& dir){
-			for(auto&& f : list_files(dir, "", ""))
+		auto list_dir = [&](const std::string& dir){
+			for(auto&& f : list_files(dir, prefix, ""))
 				res.emplace_back(type, f);
-		});
+		};
+
+		auto dir = _base_dir(type);
+		if(dir.is_nothing() && type==Asset_type::gen)
+			list_dir("");
+		else
+			dir.process(list_dir);
+
+		for(auto& d : _dispatcher) {
+			auto name = d.first.name();
+			if(d.first.type()==type && !name.empty() && util::starts_with(name, prefix))
+				res.emplace_back(d.first);
+		}
 
 		return res;
 	}
@@ -307,11 +329,21 @@ namespace asset {
 			if(!dir)
 				return util::nothing();
 
+			// f is a virtual path (already checked by _locate), file a native one
+			//   that is only usable if dir is a directory and not an archive
 			auto file = dir+"/"s+f;
-			return exists_file(file) ? util::just(std::move(file)) : util::nothing();
+			return std::ifstream(file).good() ? util::just(std::move(file)) : util::nothing();
 		});
 	}
 
+	auto Asset_manager::open(const AID& id) -> util::maybe<istream> {
+		auto path = _locate(id);
+		if(path.is_nothing())
+			return util::nothing();
+
+		return _open(path.get_or_throw(), id);
+	}
+
 	void Asset_manager::reload() {
 		for(auto& a : _assets) {
 			auto location = _locate(a.first);
@@ -336,6 +368,22 @@ namespace asset {
 		util::erase_if(_assets, [](const auto& v){return v.second.data.use_count()<=1;});
 	}
 
+	bool Asset_manager::erase(const AID& id) {
+		auto path = _locate(id);
+		if(!path)
+			return false;
+
+		_assets.erase(id);
+
+		if(!PHYSFS_delete(path.get_or_throw().c_str())) {
+			WARN("Unable to delete \""<<path.get_or_throw()<<"\": "<<PHYSFS_getLastError());
+			return false;
+		}
+
+		_post_write();
+		return true;
+	}
+
 	bool Asset_manager::exists(const AID& id)const noexcept {
 		auto path = _locate(id);
 		if(!path)
@@ -72,7 +72,13 @@ namespace asset {
 
 	class Asset_manager : util::no_copy_move {
 		public:
-			Asset_manager(const std::string& exe_name, const std::string& app_name);
+			/**
+			 * Searches the assets in root_dir (default: the working directory) and next to
+			 *   the executable. New assets are written to write_dir (default:
+			 *   ~/.config/<app_name>), e.g. to keep tests out of the users directory.
+			 */
+			Asset_manager(const std::string& exe_name, const std::string& app_name,
+			              const std::string& root_dir="", const std::string& write_dir="");
 			~Asset_manager();
 
 			void shrink_to_fit()noexcept;
@@ -83,15 +89,23 @@ namespace asset {
 			template<typename T>
 			auto load_maybe(const AID& id) -> util::maybe<Ptr<T>>;
 
-			auto list(Asset_type type) -> std::vector<AID>;
+			/// lists all assets of the given type (files in its directory and entries of the
+			///   .map files); gen:-assets are listed from the root directory
+			auto list(Asset_type type, const std::string& prefix="") -> std::vector<AID>;
 
 			template<typename T>
 			void save(const AID& id, const T& asset);
 
 			bool exists(const AID& id)const noexcept;
 
+			/// deletes an asset from the write directory; returns false if it couldn't be deleted
+			bool erase(const AID& id);
+
 			auto physical_location(const AID& id)const noexcept -> util::maybe<std::string>;
 
+			/// opens the asset for reading without loading it (i.e. it's neither shared nor reloaded)
+			auto open(const AID& id) -> util::maybe<istream>;
+
 			void reload();
 
 		private:
@@ -80,7 +80,8 @@ namespace asset {
 					return traits_type::eof();
 				}
 			}
-			setp(buffer, static_cast<size_t>(res)==bufferSize ? buffer+bufferSize : buffer+res);
+			// PHYSFS_write returns the number of objects (not bytes) => the whole buffer is free again
+			setp(buffer, buffer+bufferSize);
 
 			return 0;
 		}
@@ -1,10 +1,12 @@
 #include "engine.hpp"
 
 #include "utils/log.hpp"
+#include "utils/thread_pool.hpp"
 
 #include "configuration.hpp"
 #include "input_manager.hpp"
 #include "renderer/graphics_ctx.hpp"
+#include "renderer/texture_loader.hpp"
 #include "audio/audio_ctx.hpp"
 #include "asset/asset_manager.hpp"
 
@@ -116,7 +118,11 @@ Engine::Engine(const std::string& title, int argc, char** argv, char** env)
     _sdl(),
 	_graphics_ctx(std::make_unique<renderer::Graphics_ctx>(title, *_asset_manager)),
 	_audio_ctx(std::make_unique<audio::Audio_ctx>(*_asset_manager)),
-	_input_manager(std::make_unique<Input_manager>()), _current_time(SDL_GetTicks() / 1000.0f),
+	_input_manager(std::make_unique<Input_manager>()),
+	_thread_pool(std::make_unique<util::Thread_pool>()),
+	_texture_loader(std::make_unique<renderer::Texture_loader>(*_asset_manager, *_thread_pool,
+	                                                           _graphics_ctx->texture_cache_settings())),
+	_current_time(SDL_GetTicks() / 1000.0f),
 	_rh(std::make_unique<Reload_handler>(argc,argv,env)) {
 }
 
@@ -188,6 +194,7 @@ void Engine::on_frame() {
 
 
 	_graphics_ctx->start_frame();
+	_texture_loader->update();
 
 	_audio_ctx->flip();
 	_input_manager->update(delta_time);
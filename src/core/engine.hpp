@@ -21,8 +21,9 @@
 
 namespace mo {
 	namespace asset {class Asset_manager;}
-	namespace renderer {class Graphics_ctx;}
+	namespace renderer {class Graphics_ctx; class Texture_loader;}
 	namespace audio {class Audio_ctx;}
+	namespace util {class Thread_pool;}
 	class Configuration;
 	class Input_manager;
 
@@ -96,6 +97,9 @@ namespace mo {
 			auto& assets()const noexcept {return *_asset_manager;}
 			auto& input()noexcept {return *_input_manager;}
 			auto& input()const noexcept {return *_input_manager;}
+			auto& thread_pool()noexcept {return *_thread_pool;}
+			auto& thread_pool()const noexcept {return *_thread_pool;}
+			auto& texture_loader()noexcept {return *_texture_loader;}
 
 		protected:
 			virtual void _on_frame(float dt) {};
@@ -108,6 +112,8 @@ namespace mo {
 			std::unique_ptr<renderer::Graphics_ctx> _graphics_ctx;
 			std::unique_ptr<audio::Audio_ctx> _audio_ctx;
 			std::unique_ptr<Input_manager> _input_manager;
+			std::unique_ptr<util::Thread_pool> _thread_pool;
+			std::unique_ptr<renderer::Texture_loader> _texture_loader;
 			std::vector<std::shared_ptr<Screen>> _screen_stack;
 
 			float _current_time = 0;
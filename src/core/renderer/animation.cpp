@@ -21,7 +21,7 @@ namespace renderer{
 
 		int frame_width;
 		int frame_height;
-		Texture_ptr texture;
+		Atlas_texture texture;
 		std::string texName;
 		Animation_type currentAnim = Animation_type::idle;
 		std::unordered_map<Animation_type, Animation_frame_data> animations;
@@ -108,7 +108,7 @@ namespace renderer{
 	}
 
 	Texture_ptr Animation::texture() const noexcept{
-		return _data->texture;
+		return _data->texture.texture_ptr();
 	}
 
 	// Converting float frame to int frame --> 0.9 = 0 or 1.3 = 1
@@ -121,13 +121,14 @@ namespace renderer{
 		_data->currentAnim = type;
 		int row = _data->animations.find(type) -> second.row;
 
-		float width = _data->frame_width / static_cast<float>(_data->texture->width());
-		float height = _data->frame_height / static_cast<float>(_data->texture->height());
+		float width = _data->frame_width / static_cast<float>(_data->texture.width());
+		float height = _data->frame_height / static_cast<float>(_data->texture.height());
 		float startX = frame * width;
 		float startY = 1 - height - (row * height);
 		const glm::vec4 uv = glm::vec4(startX, startY, startX + width, startY + height);
 
-		return uv;
+		// relative to the original texture, that might be part of an atlas page
+		return _data->texture.remap(uv);
 	}
 
 	float Animation::next_frame(const Animation_type type, const float cur_frame, const float deltaTime, const bool repeat) const noexcept{
@@ -158,7 +159,7 @@ namespace asset {
 			ERROR("Error parsing JSON from "<<in.aid().str()<<" at "<<row<<":"<<column<<": "<<msg);
 		}, *r);
 
-		r->texture = in.manager().load<renderer::Texture>(r->texName);
+		r->texture = renderer::Atlas_texture(in.manager(), r->texName);
 
 		// Generating new Animation-Shared-Ptr and set _data-ptr to what r pointed to
 		auto anim = std::make_shared<renderer::Animation>(std::move(r));
@@ -167,7 +168,6 @@ namespace asset {
 	}
 
 	void Loader<renderer::Animation>::store(ostream out, const renderer::Animation& asset) {
-		asset._data->texName = asset._data->texture.aid().name();
 		sf2::serialize_json(out, asset);
 	}
 }
@@ -18,6 +18,7 @@
 #include <unordered_map>
 
 #include "../renderer/texture.hpp"
+#include "../renderer/texture_atlas.hpp"
 #include "../../core/asset/asset_manager.hpp"
 
 #include "../units.hpp"
@@ -3,6 +3,7 @@
 #include "camera.hpp"
 
 #include "graphics_ctx.hpp"
+#include "gl_state.hpp"
 
 #include <iostream>
 #include <glm/glm.hpp>
@@ -87,7 +88,7 @@ namespace renderer {
 	}
 
 	void Camera::bind_viewport()const noexcept {
-		glViewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
+		set_viewport(glm::ivec4(_viewport));
 	}
 
 	auto Camera::area()const noexcept -> glm::vec4 {
@@ -0,0 +1,134 @@
+#include "gl_state.hpp"
+
+#include "../utils/log.hpp"
+
+#include <GL/glew.h>
+
+#include <array>
+
+namespace mo {
+namespace renderer {
+
+	namespace {
+		constexpr unsigned int unknown = ~0u;
+		constexpr int max_texture_units = 8;
+
+		struct State {
+			unsigned int program = unknown;
+			int active_texture_unit = -1;
+			std::array<unsigned int, max_texture_units> textures;
+			unsigned int array_buffer = unknown;
+			unsigned int framebuffer = unknown;
+			glm::ivec4 viewport;
+			bool viewport_known = false;
+
+			Gl_state_stats stats;
+			Gl_state_stats last_frame_stats;
+
+			State() {
+				textures.fill(unknown);
+			}
+		};
+		State state;
+
+		/// true if the call has to be issued
+		template<class T>
+		bool update(T& cached, const T& value) {
+			if(cached==value) {
+				state.stats.elided++;
+				return false;
+			}
+
+			cached = value;
+			state.stats.issued++;
+			return true;
+		}
+	}
+
+	void use_program(unsigned int program) {
+		if(update(state.program, program))
+			glUseProgram(program);
+	}
+	void bind_texture(int unit, unsigned int texture) {
+		INVARIANT(unit>=0 && unit<max_texture_units, "to many textures");
+
+		if(update(state.textures[unit], texture)) {
+			if(state.active_texture_unit!=unit) {
+				state.active_texture_unit = unit;
+				state.stats.issued++;
+				glActiveTexture(GL_TEXTURE0+unit);
+			}
+
+			glBindTexture(GL_TEXTURE_2D, texture);
+		}
+	}
+	void bind_array_buffer(unsigned int buffer) {
+		if(update(state.array_buffer, buffer))
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	}
+	void bind_framebuffer(unsigned int framebuffer) {
+		if(update(state.framebuffer, framebuffer))
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	void set_viewport(glm::ivec4 viewport) {
+		if(!state.viewport_known) {
+			state.viewport_known = true;
+			state.viewport = viewport;
+			state.stats.issued++;
+			glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+
+		} else if(update(state.viewport, viewport)) {
+			glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+		}
+	}
+
+	auto current_viewport() -> glm::ivec4 {
+		if(!state.viewport_known) {
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			state.viewport = glm::ivec4{viewport[0], viewport[1], viewport[2], viewport[3]};
+			state.viewport_known = true;
+		}
+
+		return state.viewport;
+	}
+
+	// GL resets the bindings of deleted objects to 0
+	void forget_program(unsigned int program) {
+		// a deleted program stays in use until another one is bound
+		if(state.program==program)
+			state.program = unknown;
+	}
+	void forget_texture(unsigned int texture) {
+		for(auto& t : state.textures)
+			if(t==texture)
+				t = 0;
+	}
+	void forget_buffer(unsigned int buffer) {
+		if(state.array_buffer==buffer)
+			state.array_buffer = 0;
+	}
+	void forget_framebuffer(unsigned int framebuffer) {
+		if(state.framebuffer==framebuffer)
+			state.framebuffer = 0;
+	}
+
+	void invalidate_gl_state() {
+		auto stats = state.stats;
+		auto last_frame_stats = state.last_frame_stats;
+
+		state = State{};
+		state.stats = stats;
+		state.last_frame_stats = last_frame_stats;
+	}
+
+	void end_gl_state_frame() {
+		state.last_frame_stats = state.stats;
+		state.stats = Gl_state_stats{};
+	}
+	auto last_frame_gl_state_stats() -> const Gl_state_stats& {
+		return state.last_frame_stats;
+	}
+
+}
+}
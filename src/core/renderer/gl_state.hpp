@@ -0,0 +1,60 @@
+/**************************************************************************\
+ * tracks the bound GL objects to skip redundant state changes            *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+
+namespace mo {
+namespace renderer {
+
+	/// state changes that went through the tracker during one frame
+	struct Gl_state_stats {
+		std::size_t issued = 0; //< calls that reached the driver
+		std::size_t elided = 0; //< calls that would not have changed anything
+	};
+
+	/**
+	 * Thin cache of the currently bound program, textures, array buffer,
+	 *   framebuffer and viewport of the (single) GL context.
+	 * All binds of these objects have to go through these functions, or the
+	 *   cache has to be invalidated afterwards (e.g. after SOIL created a texture).
+	 */
+	extern void use_program(unsigned int program);
+	extern void bind_texture(int unit, unsigned int texture);
+	extern void bind_array_buffer(unsigned int buffer);
+	extern void bind_framebuffer(unsigned int framebuffer);
+	extern void set_viewport(glm::ivec4 viewport);
+
+	/// the current viewport (x, y, width, height); only queried from GL if it is unknown
+	extern auto current_viewport() -> glm::ivec4;
+
+	/// has to be called when the object is deleted, because GL reuses the names
+	extern void forget_program(unsigned int program);
+	extern void forget_texture(unsigned int texture);
+	extern void forget_buffer(unsigned int buffer);
+	extern void forget_framebuffer(unsigned int framebuffer);
+
+	/// after GL calls that bypassed the tracker
+	extern void invalidate_gl_state();
+
+	/// called once per frame, rotates the statistics
+	extern void end_gl_state_frame();
+	extern auto last_frame_gl_state_stats() -> const Gl_state_stats&;
+
+}
+}
@@ -6,6 +6,11 @@
 #include <GL/glew.h>
 #include <sf2/sf2.hpp>
 
+#include "stream_ring.hpp"
+#include "gl_state.hpp"
+#include "program_cache.hpp"
+#include "texture_loader.hpp"
+
 #include "../utils/log.hpp"
 #include "../asset/asset_manager.hpp"
 
@@ -38,6 +43,12 @@ namespace renderer {
 			bool fullscreen;
 			float max_screenshake = 0.5;
 			float brightness = 1.1;
+			int stream_buffer_kb = 4096; //< per frame in flight; 0 disables the stream ring
+			bool program_cache = true;   //< share shader programs between screens
+			bool program_binary_cache = true; //< store linked programs in the write directory
+			bool texture_cache = true;        //< store decoded textures in the write directory
+			bool texture_mipmaps = false;
+			bool texture_compression = false; //< DXT5; looks bad for pixel art
 		};
 
 		sf2_structDef(Graphics_cfg,
@@ -45,13 +56,19 @@ namespace renderer {
 			height,
 			fullscreen,
 			max_screenshake,
-			brightness
+			brightness,
+			stream_buffer_kb,
+			program_cache,
+			program_binary_cache,
+			texture_cache,
+			texture_mipmaps,
+			texture_compression
 		)
 
 	#ifndef EMSCRIPTEN
-		constexpr auto default_cfg = Graphics_cfg{1920,1080,true, 0.5f, 1.2f};
+		constexpr auto default_cfg = Graphics_cfg{1920,1080,true, 0.5f, 1.2f, 4096, true, true, true, false, false};
 	#else
-		constexpr auto default_cfg = Graphics_cfg{1024,512,false, 0.5f, 1.2f};
+		constexpr auto default_cfg = Graphics_cfg{1024,512,false, 0.5f, 1.2f, 4096, true, true, true, false, false};
 	#endif
 
 	}
@@ -69,6 +86,12 @@ namespace renderer {
 		_max_screenshake = cfg.max_screenshake;
 		_brightness = cfg.brightness;
 		_fullscreen = cfg.fullscreen;
+		_stream_buffer_kb = cfg.stream_buffer_kb;
+		_program_cache_enabled = cfg.program_cache;
+		_program_binary_cache_enabled = cfg.program_binary_cache;
+		_texture_cache_enabled = cfg.texture_cache;
+		_texture_mipmaps = cfg.texture_mipmaps;
+		_texture_compression = cfg.texture_compression;
 
 		if(&cfg==&default_cfg) {
 			assets.save<Graphics_cfg>("cfg:graphics"_aid, cfg);
@@ -127,14 +150,22 @@ namespace renderer {
 		glEnable(GL_DEPTH_TEST);
 		set_clear_color(0.0f,0.0f,0.0f);
 		SDL_GL_SetSwapInterval(1);
+
+		if(_stream_buffer_kb>0)
+			_stream_ring = std::make_unique<Stream_ring>(_stream_buffer_kb*std::size_t(1024));
+
+		if(_program_cache_enabled)
+			_program_cache = std::make_unique<Program_cache>(_assets, _program_binary_cache_enabled);
 	}
 
 	Graphics_ctx::~Graphics_ctx() {
+		_program_cache.reset();
+		_stream_ring.reset();
 		SDL_GL_DeleteContext(_gl_ctx);
 	}
 
 	void Graphics_ctx::reset_viewport()const noexcept {
-		glViewport(0,0, win_width(), win_height());
+		set_viewport({0,0, win_width(), win_height()});
 	}
 
 	void Graphics_ctx::start_frame() {
@@ -150,20 +181,46 @@ namespace renderer {
 		float cpu_delta_time = SDL_GetTicks() / 1000.0f - _frame_start_time;
 		_cpu_delta_time_smoothed=(1.0f-smooth_factor)*_cpu_delta_time_smoothed+smooth_factor*cpu_delta_time;
 
+		if(_stream_ring) {
+			_stream_ring->end_frame();
+			auto& uploads = _stream_ring->last_frame_stats();
+			_upload_time_smoothed=(1.0f-smooth_factor)*_upload_time_smoothed+smooth_factor*uploads.ms;
+		}
+		end_gl_state_frame();
+
+		if(_first_frame) {
+			_first_frame = false;
+			if(_program_cache) {
+				auto& programs = _program_cache->stats();
+				INFO("First frame after "<<_startup_watch.ms()<<"ms (shader programs: "
+				     <<programs.linked<<" linked, "<<programs.loaded<<" loaded from cache, "
+				     <<programs.reused<<" reused, "<<programs.ms<<"ms)");
+			} else {
+				INFO("First frame after "<<_startup_watch.ms()<<"ms (shader program cache disabled)");
+			}
+		}
+
 		_time_since_last_FPS_output+=delta_time;
 		if(_time_since_last_FPS_output>=1.0f){
 			_time_since_last_FPS_output=0.0f;
 			std::ostringstream osstr;
 			osstr<<_name<<" ("<<(int((1.0f/_delta_time_smoothed)*10.0f)/10.0f)<<" FPS, ";
 			osstr<<(int(_delta_time_smoothed*10000.0f)/10.0f)<<" ms/frame, ";
-			osstr<<(int(_cpu_delta_time_smoothed*10000.0f)/10.0f)<<" ms/frame [cpu])";
+			osstr<<(int(_cpu_delta_time_smoothed*10000.0f)/10.0f)<<" ms/frame [cpu]";
+			if(_stream_ring) {
+				auto& uploads = _stream_ring->last_frame_stats();
+				osstr<<", "<<(int(_upload_time_smoothed*100.0f)/100.0f)<<" ms/frame [upload], ";
+				osstr<<(uploads.bytes/1024)<<" KiB, "<<uploads.fallbacks<<" fallbacks, "<<uploads.stalls<<" stalls";
+			}
+			auto& gl_state = last_frame_gl_state_stats();
+			osstr<<", "<<gl_state.issued<<" binds ("<<gl_state.elided<<" elided)";
+			osstr<<")";
 			SDL_SetWindowTitle(_window.get(), osstr.str().c_str());
 		}
 		SDL_GL_SwapWindow(_window.get());
 
 		// unbind texture
-		glActiveTexture(0);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		bind_texture(0, 0);
 
 #ifndef SLOW_SYSTEM
 		if( delta_time < 1.f/60 ) {
@@ -178,12 +235,22 @@ namespace renderer {
 	auto Graphics_ctx::max_screenshake()const noexcept -> float {
 		return _screenshake_enabled ? _max_screenshake * 100 : 0;
 	}
+	auto Graphics_ctx::texture_cache_settings()const noexcept -> Texture_cache_settings {
+		auto settings = Texture_cache_settings{};
+		settings.enabled = _texture_cache_enabled;
+		settings.mipmaps = _texture_mipmaps;
+		settings.compression = _texture_compression;
+		return settings;
+	}
+
 	void Graphics_ctx::toggle_screenschake(bool enable) {
 		_screenshake_enabled = enable;
 	}
 
 	void Graphics_ctx::resolution(int width, int height, float max_screenshake) {
-		Graphics_cfg cfg{_win_width, _win_height, _fullscreen, _max_screenshake};
+		Graphics_cfg cfg{_win_width, _win_height, _fullscreen, _max_screenshake, _brightness, _stream_buffer_kb,
+		                 _program_cache_enabled, _program_binary_cache_enabled,
+		                 _texture_cache_enabled, _texture_mipmaps, _texture_compression};
 		_assets.save<Graphics_cfg>("cfg:graphics"_aid, cfg);
 	}
 
@@ -22,12 +22,18 @@
 #include <SDL2/SDL.h>
 #include <glm/vec3.hpp>
 
+#include "../utils/stopwatch.hpp"
+
 namespace mo {
 	namespace asset{
 		class Asset_manager;
 	}
 
 namespace renderer {
+	class Stream_ring;
+	class Program_cache;
+	struct Texture_cache_settings;
+
 	class Graphics_ctx {
 		public:
 			Graphics_ctx(const std::string& name, asset::Asset_manager& assets);
@@ -49,6 +55,8 @@ namespace renderer {
 
 			void toggle_screenschake(bool enable);
 
+			auto texture_cache_settings()const noexcept -> Texture_cache_settings;
+
 		private:
 			asset::Asset_manager& _assets;
 			std::string _name;
@@ -56,16 +64,28 @@ namespace renderer {
 			bool _fullscreen;
 			float _max_screenshake;
 			float _brightness;
+			int _stream_buffer_kb;
+			bool _program_cache_enabled;
+			bool _program_binary_cache_enabled;
+			bool _texture_cache_enabled;
+			bool _texture_mipmaps;
+			bool _texture_compression;
 			bool _screenshake_enabled = true;
 
 			std::unique_ptr<SDL_Window,void(*)(SDL_Window*)> _window;
 			SDL_GLContext _gl_ctx;
 			glm::vec3 _clear_color;
+			std::unique_ptr<Stream_ring> _stream_ring;
+			std::unique_ptr<Program_cache> _program_cache;
 
 			float _frame_start_time = 0;
 			float _delta_time_smoothed = 0;
 			float _cpu_delta_time_smoothed = 0;
 			float _time_since_last_FPS_output = 0;
+			float _upload_time_smoothed = 0;
+
+			util::Stopwatch _startup_watch;
+			bool _first_frame = true;
 	};
 
 	struct Disable_depthtest {
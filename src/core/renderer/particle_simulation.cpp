@@ -0,0 +1,398 @@
+#include "particle_simulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mo {
+namespace renderer {
+
+	using namespace unit_literals;
+
+	namespace {
+		/// larger areas are checked particle by particle
+		constexpr auto max_collision_map_size = 128*128;
+
+		constexpr auto two_pi = 2*PI;
+		constexpr auto half_pi = PI/2;
+
+		auto plain(int8_t v) {return static_cast<float>(v);}
+		auto plain(glm::vec4 v) {return v;}
+		auto plain(Position v) {return remove_units(v);}
+		template<class T>
+		auto plain(const Value_type<T>& v) {return v.value();}
+
+		/// value of the curve at t=0 for the given seed (includes the random deviation)
+		template<class T>
+		auto intercept(const util::Xerp<T>& curve, uint16_t seed) {
+			return plain(curve(0, seed));
+		}
+		/// change from t=0 to t=1 (0 for constant curves); independent of the seed
+		template<class T>
+		auto slope(const util::Xerp<T>& curve) {
+			return plain(curve(1, 0)) - plain(curve(0, 0));
+		}
+
+		/**
+		 * sin and cos of an angle in (-2PI, 2PI), branchless so it can be vectorized.
+		 * The absolute error is below 1e-6, which is more than enough for particles.
+		 */
+		inline void fast_sin_cos(float x, float& s, float& c) {
+			x = x>PI ? x-two_pi : (x<-PI ? x+two_pi : x);
+
+			// sin(PI-x)==sin(x) and cos(PI-x)==-cos(x)
+			auto mirror = x>half_pi ? PI : (x<-half_pi ? -PI : 0.f);
+			auto sign = mirror!=0.f ? -1.f : 1.f;
+			x = mirror!=0.f ? mirror-x : x;
+
+			auto x2 = x*x;
+			s = x*(1.f + x2*(-1.f/6 + x2*(1.f/120 + x2*(-1.f/5040 + x2*(1.f/362880 + x2*(-1.f/39916800))))));
+			c = sign * (1.f + x2*(-1.f/2 + x2*(1.f/24 + x2*(-1.f/720 + x2*(1.f/40320 + x2*(-1.f/3628800 + x2*(1.f/479001600)))))));
+		}
+
+		inline auto tile(float p) {
+			return static_cast<int>(p+0.5f);
+		}
+	}
+
+	void Environment_callback::collision_map(int left, int top, int width, int height,
+	                                         uint8_t* out)const noexcept {
+		for(auto y=0; y<height; ++y)
+			for(auto x=0; x<width; ++x)
+				*out++ = check_collision(left+x, top+y) ? 1 : 0;
+	}
+
+
+	Particle_simulation::Particle_simulation(Particle_curves curves,
+	                                         Collision_handler collision_handler, bool reverse)
+	    : _curves(std::move(curves)), _collision_handler(collision_handler), _reverse(reverse) {
+		_update_slopes();
+	}
+
+	void Particle_simulation::reset(Particle_curves curves, Collision_handler collision_handler,
+	                                bool reverse) {
+		_curves = std::move(curves);
+		_collision_handler = collision_handler;
+		_reverse = reverse;
+		_update_slopes();
+
+		_foreach_array([](auto& array) {
+			array.clear();
+		});
+	}
+
+	void Particle_simulation::acceleration(util::Xerp<Speed_per_time> acceleration,
+	                                       util::Xerp<Angle_acceleration> angular_acceleration) {
+		_curves.acceleration = acceleration;
+		_curves.angular_acceleration = angular_acceleration;
+		_update_slopes();
+
+		for(auto i=0u; i<_seed.size(); ++i)
+			_resolve_acceleration(i);
+	}
+
+	void Particle_simulation::_update_slopes() {
+		_slopes.color                = slope(_curves.color);
+		_slopes.size                 = slope(_curves.size);
+		_slopes.frame                = slope(_curves.frame);
+		_slopes.acceleration         = slope(_curves.acceleration);
+		_slopes.angular_acceleration = slope(_curves.angular_acceleration);
+		_slopes.rotation_offset      = slope(_curves.rotation_offset);
+
+		auto& aa = _curves.angular_acceleration;
+		_rotating = aa.initial_value.value()!=0.f || aa.final_value.value()!=0.f
+		         || aa.max_deviation.value()!=0.f
+		         || std::any_of(aa.cpoints.begin(), aa.cpoints.end(), [](auto v){return v.value()!=0.f;});
+	}
+
+	void Particle_simulation::_resolve_acceleration(std::size_t i) {
+		_acceleration_intercept[i]         = intercept(_curves.acceleration, _seed[i]);
+		_angular_acceleration_intercept[i] = intercept(_curves.angular_acceleration, _seed[i]);
+	}
+
+	void Particle_simulation::add(glm::vec2 position, glm::vec2 initial_velocity,
+	                              float orientation, float ttl, uint16_t seed) {
+		_seed.push_back(seed);
+		_x.push_back(position.x);
+		_y.push_back(position.y);
+		_initial_velocity_x.push_back(initial_velocity.x);
+		_initial_velocity_y.push_back(initial_velocity.y);
+		_direction_x.push_back(glm::cos(orientation));
+		_direction_y.push_back(glm::sin(orientation));
+		_orientation.push_back(orientation);
+		_velocity.push_back(0);
+		_angular_velocity.push_back(0);
+		_time_to_live.push_back(ttl);
+		_max_age.push_back(ttl);
+
+		_color_intercept.push_back(intercept(_curves.color, seed));
+		_size_intercept.push_back(intercept(_curves.size, seed));
+		_frame_intercept.push_back(intercept(_curves.frame, seed));
+		_acceleration_intercept.push_back(0);
+		_angular_acceleration_intercept.push_back(0);
+		_rotation_offset_intercept.push_back(intercept(_curves.rotation_offset, seed));
+		_resolve_acceleration(_seed.size()-1);
+
+		_instances.push_back(Particle_instance{position, glm::vec4{0}, glm::vec2{0}, 0, _uv_rect});
+	}
+
+	void Particle_simulation::simulate(float dt, const Environment_callback& env) {
+		const auto n = _seed.size();
+		if(n==0)
+			return;
+
+		// the loops only use local pointers and copies, so the compiler knows
+		//   that they don't alias and can vectorize them
+		_t.resize(n);
+		auto t = _t.data();
+		auto ttl = _time_to_live.data();
+		auto max_age = _max_age.data();
+		auto velocity = _velocity.data();
+		auto angular_velocity = _angular_velocity.data();
+		auto orientation = _orientation.data();
+		auto dir_x = _direction_x.data();
+		auto dir_y = _direction_y.data();
+
+		// t runs from 0 to 1 over the lifetime (1 to 0 if reversed)
+		const auto t_offset = _reverse ? 1.f : 0.f;
+		const auto t_sign = _reverse ? -1.f : 1.f;
+
+		{
+			auto acc = _acceleration_intercept.data();
+			auto angular_acc = _angular_acceleration_intercept.data();
+			const auto acc_slope = _slopes.acceleration;
+			const auto angular_acc_slope = _slopes.angular_acceleration;
+
+			for(auto i=std::size_t(0); i<n; ++i) {
+				t[i] = t_offset + t_sign * (max_age[i]-ttl[i]) / max_age[i];
+				velocity[i]         += (acc[i] + t[i]*acc_slope) * dt;
+				angular_velocity[i] += (angular_acc[i] + t[i]*angular_acc_slope) * dt;
+			}
+		}
+
+		// orientation only changes if there is an angular acceleration (or a collision)
+		if(_rotating) {
+			for(auto i=std::size_t(0); i<n; ++i) {
+				auto o = orientation[i] + angular_velocity[i]*dt;
+				auto turns = o * (1.f/two_pi);
+				o = (turns - static_cast<float>(static_cast<int32_t>(turns))) * two_pi;
+				orientation[i] = o;
+
+				fast_sin_cos(o, dir_y[i], dir_x[i]);
+			}
+		}
+
+		if(_collision_handler!=Collision_handler::none)
+			_collide(env);
+
+		// integration, bounds and the rest of the instance data
+		auto x = _x.data();
+		auto y = _y.data();
+		auto initial_velocity_x = _initial_velocity_x.data();
+		auto initial_velocity_y = _initial_velocity_y.data();
+
+		auto min_x = x[0];
+		auto min_y = y[0];
+		auto max_x = x[0];
+		auto max_y = y[0];
+		auto dead = 0;
+
+		for(auto i=std::size_t(0); i<n; ++i) {
+			auto step = velocity[i]*dt;
+			x[i] += dir_x[i]*step + initial_velocity_x[i]*dt;
+			y[i] += dir_y[i]*step + initial_velocity_y[i]*dt;
+
+			min_x = std::min(min_x, x[i]);
+			min_y = std::min(min_y, y[i]);
+			max_x = std::max(max_x, x[i]);
+			max_y = std::max(max_y, y[i]);
+
+			ttl[i] = std::max(ttl[i]-dt, 0.f);
+			dead += ttl[i]<=0.f ? 1 : 0;
+		}
+
+		{
+			constexpr auto quarter_turn = (90_deg).value();
+			auto color = _color_intercept.data();
+			auto size = _size_intercept.data();
+			auto frame = _frame_intercept.data();
+			auto rotation_offset = _rotation_offset_intercept.data();
+			const auto color_slope = _slopes.color;
+			const auto size_slope = _slopes.size;
+			const auto frame_slope = _slopes.frame;
+			const auto rotation_slope = _slopes.rotation_offset;
+			const auto uv_rect = _uv_rect;
+			const auto frame_width = (_uv_rect.z-_uv_rect.x) / (_curves.frame.max()+1.f);
+			auto inst = _instances.data();
+
+			for(auto i=std::size_t(0); i<n; ++i) {
+				auto& p = inst[i];
+				p.position     = glm::vec2{x[i], y[i]};
+				p.color        = color[i] + t[i]*color_slope;
+				p.size         = size[i] + t[i]*size_slope;
+				p.rotation     = orientation[i] + rotation_offset[i] + t[i]*rotation_slope - quarter_turn;
+				// the texture contains frames 0..max, the particle uses the range up to the end of its frame
+				auto f = static_cast<float>(static_cast<int>(frame[i] + t[i]*frame_slope)); // Xerp<int8_t> truncates
+				p.uv_rect      = glm::vec4{uv_rect.x, uv_rect.y, uv_rect.x + (f+1.f)*frame_width, uv_rect.w};
+			}
+		}
+
+		_top_left = {min_x, min_y};
+		_bottom_right = {max_x, max_y};
+
+		if(dead>0)
+			_compact();
+	}
+
+	void Particle_simulation::_collide(const Environment_callback& env) {
+		const auto n = _seed.size();
+		auto x = _x.data();
+		auto y = _y.data();
+
+		_tile_x.resize(n);
+		_tile_y.resize(n);
+		_hits.resize(n);
+		auto tile_x = _tile_x.data();
+		auto tile_y = _tile_y.data();
+		auto hits = _hits.data();
+
+		for(auto i=std::size_t(0); i<n; ++i) {
+			tile_x[i] = tile(x[i]);
+			tile_y[i] = tile(y[i]);
+		}
+
+		// query all tiles that contain particles at once
+		auto min_x = tile_x[0];
+		auto min_y = tile_y[0];
+		auto max_x = min_x;
+		auto max_y = min_y;
+		for(auto i=std::size_t(0); i<n; ++i) {
+			min_x = std::min(min_x, tile_x[i]);
+			min_y = std::min(min_y, tile_y[i]);
+			max_x = std::max(max_x, tile_x[i]);
+			max_y = std::max(max_y, tile_y[i]);
+		}
+
+		auto width  = max_x-min_x+1;
+		auto height = max_y-min_y+1;
+
+		// indices of all particles in solid tiles
+		auto hit_count = std::size_t(0);
+
+		if(int64_t(width)*height <= max_collision_map_size) {
+			_collision_map.resize(width*height);
+			env.collision_map(min_x, min_y, width, height, _collision_map.data());
+
+			auto map = _collision_map.data();
+			for(auto i=std::size_t(0); i<n; ++i) {
+				hits[hit_count] = static_cast<uint32_t>(i);
+				hit_count += map[(tile_y[i]-min_y)*width + tile_x[i]-min_x];
+			}
+
+		} else {
+			for(auto i=std::size_t(0); i<n; ++i) {
+				hits[hit_count] = static_cast<uint32_t>(i);
+				hit_count += env.check_collision(tile_x[i], tile_y[i]) ? 1 : 0;
+			}
+		}
+
+		// collisions are rare, so they are handled one by one
+		for(auto h=std::size_t(0); h<hit_count; ++h) {
+			auto i = hits[h];
+
+			if(_collision_handler==Collision_handler::kill) {
+				_time_to_live[i] = 0;
+				_velocity[i] = 0;
+				continue;
+			}
+
+			auto arel = glm::abs(glm::vec2{tile_x[i]-x[i], tile_y[i]-y[i]});
+
+			if(arel.x<0.01f && arel.y<0.01f) {
+				_time_to_live[i] = 0;
+				_velocity[i] = 0;
+				continue;
+			}
+
+			// mirror the direction (equal to atan2 of the new direction, modulo 2PI)
+			auto& dx = _direction_x[i];
+			auto& dy = _direction_y[i];
+			auto& o = _orientation[i];
+
+			if(glm::abs(arel.x-arel.y) < 0.01f) {
+				dx=-dx;
+				dy=-dy;
+				o = o + PI;
+
+			} else if(arel.x > arel.y) {
+				dx=-dx;
+				o = PI - o;
+			} else {
+				dy=-dy;
+				o = -o;
+			}
+
+			switch(_collision_handler) {
+				case Collision_handler::stop:
+					_velocity[i]*=0.2f;
+					break;
+
+				case Collision_handler::bounce:
+				default:
+					_velocity[i]*=0.9f;
+					break;
+			}
+		}
+	}
+
+	template<class F>
+	void Particle_simulation::_foreach_array(F&& f) {
+		f(_seed);
+		f(_x);
+		f(_y);
+		f(_initial_velocity_x);
+		f(_initial_velocity_y);
+		f(_direction_x);
+		f(_direction_y);
+		f(_orientation);
+		f(_velocity);
+		f(_angular_velocity);
+		f(_time_to_live);
+		f(_max_age);
+		f(_color_intercept);
+		f(_size_intercept);
+		f(_frame_intercept);
+		f(_acceleration_intercept);
+		f(_angular_acceleration_intercept);
+		f(_rotation_offset_intercept);
+		f(_instances);
+	}
+
+	void Particle_simulation::_compact() {
+		// dead particles are replaced by the last living ones (like std::swap
+		//   with the last element), so only a few entries have to be moved
+		auto ttl = _time_to_live.data();
+		auto end = _seed.size();
+
+		_moves.clear();
+		for(auto i=std::size_t(0); i<end; ++i) {
+			if(ttl[i]>0)
+				continue;
+
+			while(end>i+1 && ttl[end-1]<=0)
+				end--;
+
+			end--;
+			if(end>i)
+				_moves.emplace_back(static_cast<uint32_t>(end), static_cast<uint32_t>(i));
+		}
+
+		_foreach_array([&](auto& array) {
+			for(auto& m : _moves)
+				array[m.second] = array[m.first];
+
+			array.erase(array.begin()+end, array.end());
+		});
+	}
+
+}
+}
@@ -0,0 +1,173 @@
+/**************************************************************************\
+ * data-oriented simulation of the particles of an emitter                *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include "../units.hpp"
+#include "../utils/math.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mo {
+namespace renderer {
+
+	/**
+	 * Read-only view of the solid tiles of the world.
+	 * Emitters are updated in parallel, so all methods may be called
+	 *   concurrently and must not modify any shared state.
+	 */
+	struct Environment_callback {
+		virtual ~Environment_callback()noexcept{}
+
+		virtual bool check_collision(int x, int y)const noexcept=0;
+
+		/**
+		 * Writes the result of check_collision for all tiles in the given rect
+		 *   into out (row major, width*height entries; 0=free, 1=solid).
+		 * Should be overridden if the environment can answer this faster than
+		 *   by calling check_collision for each tile.
+		 */
+		virtual void collision_map(int left, int top, int width, int height, uint8_t* out)const noexcept;
+	};
+
+	enum class Collision_handler {
+		none,
+		kill,
+		bounce,
+		stop
+	};
+
+	/// the per-instance data of a particle, as consumed by the particle shader
+	struct Particle_instance {
+		glm::vec2 position;
+		glm::vec4 color;
+		glm::vec2 size;
+		float     rotation;
+		glm::vec4 uv_rect; //< region of the current animation frame in the texture (atlas page)
+	};
+
+	struct Particle_curves {
+		util::Xerp<Angle>              rotation_offset;
+		util::Xerp<Speed_per_time>     acceleration;
+		util::Xerp<Angle_acceleration> angular_acceleration;
+		util::Xerp<glm::vec4>          color;
+		util::Xerp<Position>           size;
+		util::Xerp<int8_t>             frame;
+	};
+
+	/**
+	 * The particles of one emitter, stored as one array per property.
+	 * All curves are either linear or constant in t, so their value for a
+	 *   particle is intercept(seed) + t*slope. The intercepts are resolved once
+	 *   when a particle is spawned and the slopes once per emitter, which
+	 *   replaces the seed lookups of util::Xerp in the per-frame loops.
+	 * The instance data for the GPU is written in the same pass as the positions.
+	 */
+	class Particle_simulation {
+		public:
+			Particle_simulation(Particle_curves curves, Collision_handler collision_handler,
+			                    bool reverse);
+
+			/// removes all particles and replaces the parameters (keeps the allocated memory)
+			void reset(Particle_curves curves, Collision_handler collision_handler, bool reverse);
+
+			/// region of the texture in its atlas page; divided into the animation frames
+			void texture_rect(glm::vec4 uv_rect)noexcept {_uv_rect = uv_rect;}
+
+			void add(glm::vec2 position, glm::vec2 initial_velocity, float orientation,
+			         float ttl, uint16_t seed);
+
+			void simulate(float dt, const Environment_callback& env);
+
+			void acceleration(util::Xerp<Speed_per_time> acceleration,
+			                  util::Xerp<Angle_acceleration> angular_acceleration);
+
+			auto curves()const noexcept -> const Particle_curves& {return _curves;}
+			auto instances()const noexcept -> const std::vector<Particle_instance>& {return _instances;}
+			auto seeds()const noexcept -> const std::vector<uint16_t>& {return _seed;}
+			auto size()const noexcept {return _seed.size();}
+			auto empty()const noexcept {return _seed.empty();}
+
+			/// bounds of all particles after the last simulate()
+			auto top_left()const noexcept {return _top_left;}
+			auto bottom_right()const noexcept {return _bottom_right;}
+
+		private:
+			struct Slopes {
+				glm::vec4 color;
+				glm::vec2 size;
+				float frame;
+				float acceleration;
+				float angular_acceleration;
+				float rotation_offset;
+			};
+
+			void _update_slopes();
+			void _resolve_acceleration(std::size_t i);
+			void _collide(const Environment_callback& env);
+			void _compact();
+
+			template<class F>
+			void _foreach_array(F&& f);
+
+			Particle_curves   _curves;
+			Collision_handler _collision_handler;
+			bool              _reverse;
+			bool              _rotating; //< false if the angular acceleration is always 0
+			Slopes            _slopes;
+			glm::vec4         _uv_rect {0,0,1,1};
+
+			// per particle
+			std::vector<uint16_t>  _seed;
+			std::vector<float>     _x;
+			std::vector<float>     _y;
+			std::vector<float>     _initial_velocity_x;
+			std::vector<float>     _initial_velocity_y;
+			std::vector<float>     _direction_x; //< cos of the orientation
+			std::vector<float>     _direction_y; //< sin of the orientation
+			std::vector<float>     _orientation;
+			std::vector<float>     _velocity;
+			std::vector<float>     _angular_velocity;
+			std::vector<float>     _time_to_live;
+			std::vector<float>     _max_age;
+
+			std::vector<glm::vec4> _color_intercept;
+			std::vector<glm::vec2> _size_intercept;
+			std::vector<float>     _frame_intercept;
+			std::vector<float>     _acceleration_intercept;
+			std::vector<float>     _angular_acceleration_intercept;
+			std::vector<float>     _rotation_offset_intercept;
+
+			std::vector<Particle_instance> _instances;
+
+			// scratch space, reused between frames
+			std::vector<float>    _t;
+			std::vector<int32_t>  _tile_x;
+			std::vector<int32_t>  _tile_y;
+			std::vector<uint32_t> _hits;
+			std::vector<std::pair<uint32_t, uint32_t>> _moves; //< (from, to) when removing dead particles
+			std::vector<uint8_t>  _collision_map;
+
+			glm::vec2 _top_left;
+			glm::vec2 _bottom_right;
+	};
+
+}
+}
@@ -2,9 +2,12 @@
 
 #include "primitives.hpp"
 #include "graphics_ctx.hpp"
+#include "program_cache.hpp"
 
 #include "../utils/random.hpp"
+#include "../utils/thread_pool.hpp"
 
+#include <algorithm>
 #include <limits>
 
 namespace mo {
@@ -24,13 +27,11 @@ namespace renderer {
 			Vertex_layout::Mode::triangle_strip,
 			vertex("xy",       &Base_vertex::xy,        0, 0),
 			vertex("uv",       &Base_vertex::uv,        0, 0),
-			vertex("position", &Particle::position,     1, 1),
-			vertex("color",    &Particle::color,        1, 1),
-			vertex("size",     &Particle::size,         1, 1),
-			vertex("rotation", &Particle::rotation,     1, 1),
-			vertex("frame",    &Particle::frame,        1, 1),
-			vertex("ttl",      &Particle::time_to_live, 1, 1),
-			vertex("max_age",  &Particle::max_age,      1, 1)
+			vertex("position", &Particle_instance::position,     1, 1),
+			vertex("color",    &Particle_instance::color,        1, 1),
+			vertex("size",     &Particle_instance::size,         1, 1),
+			vertex("rotation", &Particle_instance::rotation,     1, 1),
+			vertex("uv_rect",  &Particle_instance::uv_rect,      1, 1)
 		};
 
 		std::vector<Base_vertex> particle_vertices {
@@ -40,32 +41,20 @@ namespace renderer {
 			{{ .5, .5}, {1,0}}
 		};
 
+		/// emitters per job; most emitters are small
+		constexpr auto min_emiters_per_chunk = 4;
+
+		/// initial size of the shared instance buffer (grows on demand)
+		constexpr auto initial_instance_capacity = 1024;
+
+		/// retired emitters kept for reuse
+		constexpr auto max_free_emiters = 64;
+
 		struct Default_env_callback : Environment_callback {
-			bool check_collision(int, int)noexcept {
+			bool check_collision(int, int)const noexcept override {
 				return false;
 			}
 		};
-
-		auto rng = create_random_generator();
-
-		auto rand_point(float radius) -> glm::vec2 {
-			auto phi = random_real(rng, 0.f, 2*PI);
-			auto r = random_real(rng, 0.f, radius);
-			return {r*glm::cos(phi), r*glm::sin(phi)};
-		}
-
-		auto next_pseed() -> uint16_t {
-		//	static uint16_t n = 0;
-		//	return n++;
-			return random_int(rng, uint16_t{0}, std::numeric_limits<uint16_t>::max());
-		}
-	}
-
-	Particle::Particle(glm::vec2 pos, glm::vec2 velocity, float rot, float ttl, uint16_t seed)
-	    : seed(seed), position(pos), initial_velocity(velocity),
-	      color{0}, size{0}, orientation{rot}, frame{0},
-	      velocity{0}, angular_velocity{0}, time_to_live(ttl), max_age(ttl)
-	{
 	}
 
 	Particle_emiter::Particle_emiter(
@@ -81,20 +70,61 @@ namespace renderer {
 	        util::Xerp<glm::vec4> color,
 	        util::Xerp<Position> size,
 	        util::Xerp<int8_t> frame,
-	        Texture_ptr texture,
-	        bool reverse)
+	        Atlas_texture texture,
+	        bool reverse,
+	        uint64_t seed)
 	    : _center(center), _orientation(orientation), _radius(radius), _offset(offset),
 	      _spawn_rate(spawn_rate), _collision_handler(collision_handler),
 	      _min_ttl(min_ttl), _max_ttl(max_ttl), _max_particles(max_particles), _reverse(reverse),
-	      _frame(frame), _direction(direction), _rotation_offset(rotation_offset),
-	      _acceleration(acceleration), _angular_acceleration(angular_acceleration),
-	      _color(color), _size(size), _texture(texture),
-	      _obj(particle_vertex_layout, create_buffer(particle_vertices),
-	           create_dynamic_buffer<Particle>(max_particles))
+	      _direction(direction),
+	      _simulation(Particle_curves{rotation_offset, acceleration, angular_acceleration,
+	                                  color, size, frame},
+	                  collision_handler, reverse),
+	      _texture(texture),
+	      _rng(seed)
 	{
 		_bottom_right = _top_left = remove_units(_center);
 	}
 
+	void Particle_emiter::reset(
+	        Position center, Angle orientation, Distance radius,
+	        Distance offset,
+	        Collision_handler collision_handler,
+	        float spawn_rate, std::size_t max_particles,
+	        Time min_ttl, Time max_ttl,
+	        util::Xerp<Angle> direction,
+	        util::Xerp<Angle> rotation_offset,
+	        util::Xerp<Speed_per_time> acceleration,
+	        util::Xerp<Angle_acceleration> angular_acceleration,
+	        util::Xerp<glm::vec4> color,
+	        util::Xerp<Position> size,
+	        util::Xerp<int8_t> frame,
+	        Atlas_texture texture,
+	        bool reverse,
+	        uint64_t seed) {
+		_center = center;
+		_orientation = orientation;
+		_velocity = Velocity{0,0};
+		_radius = radius;
+		_offset = offset;
+		_spawn_rate = spawn_rate;
+		_collision_handler = collision_handler;
+		_min_ttl = min_ttl;
+		_max_ttl = max_ttl;
+		_max_particles = max_particles;
+		_reverse = reverse;
+		_direction = direction;
+		_simulation.reset(Particle_curves{rotation_offset, acceleration, angular_acceleration,
+		                                  color, size, frame},
+		                  collision_handler, reverse);
+		_texture = std::move(texture);
+		_dt_acc = Time{0};
+		_activated = true;
+		_rng = util::split_mix_generator(seed);
+
+		_bottom_right = _top_left = remove_units(_center);
+	}
+
 	void Particle_emiter::update_center(Position center, Angle orientation, Velocity velocity) {
 		_center = center;
 		_orientation = normalize(orientation);
@@ -102,34 +132,47 @@ namespace renderer {
 		update_bounds(remove_units(center));
 	}
 
-	void Particle_emiter::update(bool active, Time dt, Environment_callback& env) {
+	void Particle_emiter::update(bool active, Time dt, const Environment_callback& env) {
 		if(active && _activated) {
 			spawn_new(dt, env);
 		}
 
-		auto di = simulate(dt, env);
+		if(_simulation.empty())
+			return;
 
-		_particles.erase(di, _particles.end());
+		// looked up every frame, because the atlas may have been reloaded
+		if(_texture)
+			_simulation.texture_rect(_texture.uv_rect());
+
+		_simulation.simulate(dt.value(), env);
+
+		_top_left = glm::min(remove_units(_center), _simulation.top_left());
+		_bottom_right = glm::max(remove_units(_center), _simulation.bottom_right());
 	}
-	void Particle_emiter::spawn_new(Time dt, Environment_callback& env) {
+	auto Particle_emiter::rand_point(float radius) -> glm::vec2 {
+		auto phi = random_real(_rng, 0.f, 2*PI);
+		auto r = random_real(_rng, 0.f, radius);
+		return {r*glm::cos(phi), r*glm::sin(phi)};
+	}
+	void Particle_emiter::spawn_new(Time dt, const Environment_callback& env) {
 		_dt_acc+=dt;
 
 		auto to_spawn = static_cast<std::size_t>(_spawn_rate * _dt_acc.value() + 0.5f);
 		_dt_acc-=Time(to_spawn/_spawn_rate);
 
-		to_spawn = glm::min(to_spawn, _max_particles-_particles.size());
+		to_spawn = glm::min(to_spawn, _max_particles-std::min(_max_particles, _simulation.size()));
 
 		for(std::size_t i=0; i<to_spawn; ++i) {
-			auto seed = next_pseed();
+			auto seed = random_int(_rng, uint16_t{0}, std::numeric_limits<uint16_t>::max());
 
 			auto start = remove_units(_center+rotate(Position{_offset,0_m}, _orientation))
 			             + rand_point(_radius.value());
 			auto dir = normalize(_direction(0, seed) + _orientation).value();
 
-			auto ttl = random_int(rng, _min_ttl, _max_ttl).value();
+			auto ttl = random_int(_rng, _min_ttl, _max_ttl).value();
 
 			if(_reverse) {
-				auto dest = start+rotate(glm::vec2{1,0}, Angle(dir)) * ttl * _acceleration.avg(seed).value() * ttl;
+				auto dest = start+rotate(glm::vec2{1,0}, Angle(dir)) * ttl * _simulation.curves().acceleration.avg(seed).value() * ttl;
 
 				if(_collision_handler!=Collision_handler::none) {
 					auto max_distance = glm::length(dest-start);
@@ -153,102 +196,8 @@ namespace renderer {
 				dir -= (180.0_deg).value();
 			}
 
-			_particles.emplace_back(
-				start,
-				remove_units(_velocity),
-				dir,
-				ttl, seed);
-		}
-	}
-	auto Particle_emiter::simulate(Time dt,
-	                               Environment_callback& env) -> std::vector<Particle>::iterator {
-		if(_particles.empty())
-			return _particles.end();
-
-		_bottom_right = _top_left = remove_units(_center);
-
-		auto last = _particles.end() -1;
-
-		for(auto iter=_particles.begin(); iter!=last+1;) {
-			if(simulate_one(dt.value(), env, *iter)) {
-				++iter;
-
-			} else {
-				std::swap(*last, *iter);
-				last--;
-			}
-		}
-
-		return last+1;
-	}
-	auto Particle_emiter::simulate_one(float dt, Environment_callback& env, Particle& p) -> bool {
-		auto t = !_reverse ? (p.max_age-p.time_to_live) / p.max_age
-		                   : 1- (p.max_age-p.time_to_live) / p.max_age;
-
-		p.color    = _color(t, p.seed);
-		p.size     = remove_units(_size(t, p.seed));
-		p.frame    = _frame(t, p.seed);
-
-		p.velocity         += (_acceleration(t, p.seed)*dt).value();
-		p.angular_velocity += (_angular_acceleration(t, p.seed)*dt).value();
-
-		p.orientation = normalize(Angle(p.orientation+ p.angular_velocity*dt)).value();
-		p.rotation = p.orientation + _rotation_offset(t, p.seed).value() - 90_deg;
-
-		if(_collision_handler!=Collision_handler::none) {
-			int x = static_cast<int>(p.position.x+0.5);
-			int y = static_cast<int>(p.position.y+0.5);
-
-			if(env.check_collision(x,y)) {
-				if(_collision_handler==Collision_handler::kill)
-					return false;
-
-
-				auto rel = glm::vec2{x-p.position.x, y-p.position.y};
-				auto arel = glm::abs(rel);
-
-				if((arel.x<0.01 && arel.y<0.01))
-					return false;
-
-				auto dv = glm::vec2{glm::cos(p.orientation), glm::sin(p.orientation)};
-
-				if(glm::abs(arel.x-arel.y) < 0.01) {
-					dv.x=-dv.x;
-					dv.y=-dv.y;
-
-				} else if(arel.x > arel.y) {
-					dv.x=-dv.x;
-				} else {
-					dv.y=-dv.y;
-				}
-
-				//auto np = p.position+ dv*p.velocity * (1/30.f);
-				//if(env.check_collision(np.x+0.5f, y+0.5f))
-				//	return false;
-
-				p.orientation = glm::atan(dv.y, dv.x);
-
-				switch(_collision_handler) {
-					case Collision_handler::stop:
-						p.velocity*=0.2f;
-						break;
-
-					case Collision_handler::bounce:
-					default:
-						p.velocity*=0.9f;
-						break;
-				}
-			}
+			_simulation.add(start, remove_units(_velocity), dir, ttl, seed);
 		}
-
-		auto r = p.velocity * dt;
-		p.position += r*glm::vec2{glm::cos(p.orientation), glm::sin(p.orientation)};
-		p.position += p.initial_velocity * dt;
-
-		update_bounds(p.position);
-
-		p.time_to_live=glm::max(p.time_to_live-dt, 0.f);
-		return p.time_to_live>0;
 	}
 	void Particle_emiter::update_bounds(glm::vec2 p) {
 		if(p.x<_top_left.x)
@@ -264,32 +213,24 @@ namespace renderer {
 			_bottom_right.y = p.y;
 	}
 
-	void Particle_emiter::draw(Shader_program& prog) {
-		if(_texture)
-			_texture->bind();
-
-		prog.set_uniform("frames", static_cast<float>(_frame.max()+1));
-
-		_obj.buffer(1).set(_particles);
-		_obj.draw();
-	}
 	bool Particle_emiter::visible(glm::vec2 top_left, glm::vec2 bottom_right)const noexcept {
 		return _bottom_right.x >= top_left.x && _top_left.x <=bottom_right.x &&
 		       _bottom_right.y >= top_left.y && _top_left.y <=bottom_right.y;
 	}
 	bool Particle_emiter::empty()const noexcept {
-		return _particles.empty();
+		return _simulation.empty();
 	}
 
 
-	Particle_renderer::Particle_renderer(asset::Asset_manager& assets,
-	                                     std::unique_ptr<Environment_callback> env)
-	    : _env(env ? std::move(env) : std::make_unique<Default_env_callback>())
+	Particle_renderer::Particle_renderer(asset::Asset_manager& assets, util::Thread_pool& thread_pool,
+	                                     uint64_t seed, std::unique_ptr<Environment_callback> env)
+	    : _env(env ? std::move(env) : std::make_unique<Default_env_callback>()),
+	      _thread_pool(thread_pool), _seed_rng(seed),
+	      _obj(particle_vertex_layout, create_buffer(particle_vertices),
+	           create_dynamic_buffer<Particle_instance>(initial_instance_capacity))
 	{
-		_prog.attach_shader(assets.load<renderer::Shader>("vert_shader:particles"_aid))
-		     .attach_shader(assets.load<renderer::Shader>("frag_shader:particles"_aid))
-		     .bind_all_attribute_locations(renderer::particle_vertex_layout)
-		     .build();
+		_prog = load_program(assets, "vert_shader:particles"_aid,
+		                     "frag_shader:particles"_aid, particle_vertex_layout);
 	}
 
 	void Particle_renderer::draw(const Camera& cam) {
@@ -299,18 +240,63 @@ namespace renderer {
 		glm::vec2 top_left    {cam_area.x-1, cam_area.y-1};
 		glm::vec2 bottom_right{cam_area.z+1, cam_area.w+1};
 
-		_prog.bind()
+		_visible.clear();
+		for(auto& pe : _emiter) {
+			if(!pe->empty() && pe->texture() && pe->visible(top_left, bottom_right))
+				_visible.push_back(pe.get());
+		}
+
+		if(_visible.empty())
+			return;
+
+		// group by texture (most emitters share the same atlas page), keeping the creation order
+		//   within a group. The groups are ordered by their first emitter, so the draw order
+		//   doesn't depend on where the textures have been allocated.
+		auto group_of = [&](const Texture* texture) {
+			return std::find_if(_groups.begin(), _groups.end(), [&](auto& g) {
+				return g.texture==texture;
+			});
+		};
+
+		_groups.clear();
+		for(auto pe : _visible) {
+			auto texture = &pe->texture().texture();
+			auto group = group_of(texture);
+			if(group==_groups.end())
+				group = _groups.insert(_groups.end(), Draw_group{texture, 0, 0});
+
+			group->count += pe->instances().size();
+		}
+
+		auto offset = std::size_t(0);
+		for(auto& group : _groups) {
+			group.first = offset;
+			offset += group.count;
+			group.count = 0;
+		}
+
+		_instances.resize(offset);
+		for(auto pe : _visible) {
+			auto group = group_of(&pe->texture().texture());
+			auto& instances = pe->instances();
+
+			std::copy(instances.begin(), instances.end(), _instances.begin() + (group->first+group->count));
+			group->count += instances.size();
+		}
+
+		_obj.buffer(1).set(_instances);
+
+		_prog->bind()
 		     .set_uniform("vp", cam.vp())
 		     .set_uniform("texture", 0)
 		     .set_uniform("layer", 0.9f);
 
-		for(auto& pe : _emiter) {
-			if(pe->visible(top_left, bottom_right)) {
-				pe->draw(_prog);
-			}
+		for(auto& group : _groups) {
+			group.texture->bind();
+			_obj.draw_instances(group.first, group.count);
 		}
 
-		_prog.unbind();
+		_prog->unbind();
 	}
 	void Particle_renderer::update(Time dt, const Camera& cam) {
 		auto cam_area  = cam.area();
@@ -318,17 +304,30 @@ namespace renderer {
 		glm::vec2 bottom_right{cam_area.z+5, cam_area.w+5};
 
 
+		_update_jobs.clear();
 		for(auto& pe : _emiter) {
 			if(pe->visible(top_left, bottom_right)) {
-				pe->update(pe.use_count()>1, dt, *_env);
+				_update_jobs.push_back(Update_job{pe.get(), pe.use_count()>1});
 			}
 		}
 
-		_emiter.erase(
-		            std::remove_if(_emiter.begin(),
-		                           _emiter.end(),
-		                           [](auto& pe){return pe.use_count()<=1 && pe->empty();}),
-		            _emiter.end());
+		// emitters only share the (read-only) environment, so they can be updated in parallel
+		const auto& env = *_env;
+		_thread_pool.parallel_for(_update_jobs.size(), min_emiters_per_chunk,
+		                          [&](std::size_t begin, std::size_t end, std::size_t) {
+			for(auto i=begin; i<end; ++i)
+				_update_jobs[i].emiter->update(_update_jobs[i].active, dt, env);
+		});
+
+		auto retired = std::stable_partition(_emiter.begin(), _emiter.end(),
+		                                     [](auto& pe){return pe.use_count()>1 || !pe->empty();});
+
+		for(auto iter=retired; iter!=_emiter.end(); ++iter) {
+			if(_free_emiters.size()<max_free_emiters)
+				_free_emiters.emplace_back(std::move(*iter));
+		}
+
+		_emiter.erase(retired, _emiter.end());
 	}
 
 }
@@ -20,46 +20,19 @@
 #include "../units.hpp"
 #include "../utils/maybe.hpp"
 #include "../utils/math.hpp"
+#include "../utils/random.hpp"
 
-#include "shader.hpp"
+#include "particle_simulation.hpp"
+#include "program_cache.hpp"
 #include "vertex_object.hpp"
 #include "texture.hpp"
+#include "texture_atlas.hpp"
 #include "camera.hpp"
 
 namespace mo {
-namespace renderer {
-
-	struct Particle {
-		uint16_t  seed;
-
-		glm::vec2 position;
-		glm::vec2 initial_velocity;
-		glm::vec4 color;
-		glm::vec2 size;
-		float     rotation;
-		float     orientation;
-		float     frame;
-
-		float     velocity;
-		float     angular_velocity;
-		float     time_to_live;
-		float     max_age;
-
-		Particle(glm::vec2 pos, glm::vec2 velocity, float rot, float ttl, uint16_t seed);
-	};
-
-	struct Environment_callback {
-		virtual ~Environment_callback()noexcept{}
-
-		virtual bool check_collision(int x, int y)noexcept=0;
-	};
+	namespace util {class Thread_pool;}
 
-	enum class Collision_handler {
-		none,
-		kill,
-		bounce,
-		stop
-	};
+namespace renderer {
 
 	class Particle_emiter {
 		public:
@@ -77,9 +50,8 @@ namespace renderer {
 				_max_ttl = max;
 			}
 			void acceleration(util::Xerp<Speed_per_time> acceleration,
-			                  util::Xerp<Angle_acceleration> angular_acceleration)noexcept {
-				_acceleration = acceleration;
-				_angular_acceleration = angular_acceleration;
+			                  util::Xerp<Angle_acceleration> angular_acceleration) {
+				_simulation.acceleration(acceleration, angular_acceleration);
 			}
 
 
@@ -99,21 +71,43 @@ namespace renderer {
 			                util::Xerp<glm::vec4> color,
 			                util::Xerp<Position> size,
 			                util::Xerp<int8_t> frame,
-			                Texture_ptr texture,
-			                bool reverse);
-
-			void update(bool active, Time dt, Environment_callback& env);
+			                Atlas_texture texture,
+			                bool reverse,
+			                uint64_t seed);
+
+			/// reinitializes a retired emitter (reusing its memory)
+			void reset(Position center, Angle orientation, Distance radius,
+			           Distance offset,
+			           Collision_handler collision_handler,
+			           float spawn_rate, std::size_t max_particles,
+			           Time min_ttl, Time max_ttl,
+			           util::Xerp<Angle> direction,
+			           util::Xerp<Angle> rotation_offset,
+			           util::Xerp<Speed_per_time> acceleration,
+			           util::Xerp<Angle_acceleration> angular_acceleration,
+			           util::Xerp<glm::vec4> color,
+			           util::Xerp<Position> size,
+			           util::Xerp<int8_t> frame,
+			           Atlas_texture texture,
+			           bool reverse,
+			           uint64_t seed);
+
+			/// may be called concurrently for different emitters
+			void update(bool active, Time dt, const Environment_callback& env);
+
+			auto instances()const noexcept -> const std::vector<Particle_instance>& {
+				return _simulation.instances();
+			}
 
-			void draw(Shader_program& prog);
+			auto texture()const noexcept -> const Atlas_texture& {return _texture;}
 
 			bool visible(glm::vec2 top_left, glm::vec2 bottom_right)const noexcept;
 
 			bool empty()const noexcept;
 
 		private:
-			void spawn_new(Time dt, Environment_callback& env);
-			auto simulate(Time dt, Environment_callback& env) -> std::vector<Particle>::iterator;
-			auto simulate_one(float dt, Environment_callback& env, Particle& p) -> bool;
+			void spawn_new(Time dt, const Environment_callback& env);
+			auto rand_point(float radius) -> glm::vec2;
 			void update_bounds(glm::vec2);
 
 			Position          _center;
@@ -128,29 +122,24 @@ namespace renderer {
 			std::size_t       _max_particles;
 			bool              _reverse;
 
-			util::Xerp<int8_t>             _frame;
-			util::Xerp<Angle>              _direction;
-			util::Xerp<Angle>              _rotation_offset;
-			util::Xerp<Speed_per_time>     _acceleration;
-			util::Xerp<Angle_acceleration> _angular_acceleration;
-			util::Xerp<glm::vec4>          _color;
-			util::Xerp<Position>           _size;
+			util::Xerp<Angle>   _direction;
+			Particle_simulation _simulation;
 
-			glm::vec2             _top_left;
-			glm::vec2             _bottom_right;
-			std::vector<Particle> _particles;
-			Texture_ptr           _texture;
-			Object                _obj;
+			glm::vec2           _top_left;
+			glm::vec2           _bottom_right;
+			Atlas_texture       _texture;
 
 			Time _dt_acc {0};
 			bool _activated = true;
+			util::split_mix_generator _rng; //< own stream, so the result doesn't depend on the update order
 	};
 	using Particle_emiter_ptr = std::shared_ptr<Particle_emiter>;
 
 
 	class Particle_renderer {
 		public:
-			Particle_renderer(asset::Asset_manager& assets, std::unique_ptr<Environment_callback> env=std::unique_ptr<Environment_callback>());
+			Particle_renderer(asset::Asset_manager& assets, util::Thread_pool& thread_pool, uint64_t seed,
+			                  std::unique_ptr<Environment_callback> env=std::unique_ptr<Environment_callback>());
 
 			Particle_emiter_ptr create_emiter(Position center, Angle orientation, Distance radius,
 			                                  Distance offset, Collision_handler collision_handler,
@@ -163,17 +152,35 @@ namespace renderer {
 							                  util::Xerp<glm::vec4> color,
 							                  util::Xerp<Position> size,
 							                  util::Xerp<int8_t> frame,
-							                  Texture_ptr texture,
+							                  Atlas_texture texture,
 			                                  bool reverse=false);
 
 			void draw(const Camera& cam);
 			void update(Time dt, const Camera& cam);
 
 		private:
+			struct Update_job {
+				Particle_emiter* emiter;
+				bool active;
+			};
+			struct Draw_group {
+				const Texture* texture;
+				std::size_t first;
+				std::size_t count;
+			};
+
 			std::unique_ptr<Environment_callback> _env;
-			Shader_program _prog;
+			util::Thread_pool& _thread_pool;
+			util::split_mix_generator _seed_rng;
+			Shader_program_ptr _prog;
+			Object _obj; //< shared by all emitters; buffer 1 contains the instances of all visible particles
 
 			std::vector<Particle_emiter_ptr> _emiter;
+			std::vector<Particle_emiter_ptr> _free_emiters; //< retired emitters, recycled by create_emiter
+			std::vector<Update_job> _update_jobs;
+			std::vector<Particle_emiter*> _visible;
+			std::vector<Particle_instance> _instances;
+			std::vector<Draw_group> _groups;
 	};
 
 	inline Particle_emiter_ptr Particle_renderer::create_emiter(Position center, Angle orientation,
@@ -188,9 +195,19 @@ namespace renderer {
 										                 util::Xerp<glm::vec4> color,
 										                 util::Xerp<Position> size,
 										                 util::Xerp<int8_t> frame,
-										                 Texture_ptr texture,
+										                 Atlas_texture texture,
 	                                                     bool reverse ) {
-		auto pe = std::make_shared<Particle_emiter>(center, orientation, radius, offset, collision_handler, spawn_rate, max_particles, min_ttl, max_ttl, direction, rotation_offset, acceleration, angular_acceleration, color, size, frame, texture, reverse);
+		auto pe = Particle_emiter_ptr{};
+
+		if(!_free_emiters.empty()) {
+			pe = std::move(_free_emiters.back());
+			_free_emiters.pop_back();
+			pe->reset(center, orientation, radius, offset, collision_handler, spawn_rate, max_particles, min_ttl, max_ttl, direction, rotation_offset, acceleration, angular_acceleration, color, size, frame, texture, reverse, _seed_rng());
+
+		} else {
+			pe = std::make_shared<Particle_emiter>(center, orientation, radius, offset, collision_handler, spawn_rate, max_particles, min_ttl, max_ttl, direction, rotation_offset, acceleration, angular_acceleration, color, size, frame, texture, reverse, _seed_rng());
+		}
+
 		_emiter.emplace_back(pe);
 
 		return pe;
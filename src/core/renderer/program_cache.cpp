@@ -0,0 +1,227 @@
+#include "program_cache.hpp"
+
+#include "vertex_object.hpp"
+
+#include "../asset/asset_manager.hpp"
+#include "../utils/log.hpp"
+#include "../utils/stopwatch.hpp"
+
+#include <GL/glew.h>
+
+#include <cstring>
+#include <sstream>
+
+namespace mo {
+namespace renderer {
+
+	namespace {
+		constexpr auto cache_prefix = "program_cache_";
+		constexpr auto cache_suffix = ".bin";
+
+		/// bumped when the file format changes
+		constexpr uint64_t cache_version = 1;
+
+		Program_cache* current_cache = nullptr;
+
+		class Fnv1a {
+			public:
+				void add(const std::string& str)noexcept {
+					for(auto c : str) {
+						_hash ^= static_cast<uint8_t>(c);
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				void add(uint64_t v)noexcept {
+					for(auto i=0; i<8; ++i, v>>=8) {
+						_hash ^= v & 0xff;
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				auto value()const noexcept {return _hash;}
+
+			private:
+				uint64_t _hash = 0xcbf29ce484222325ull;
+		};
+
+		auto gl_string(GLenum name) -> std::string {
+			auto str = glGetString(name);
+			return str ? reinterpret_cast<const char*>(str) : "";
+		}
+
+		/// e.g. "vert_shader:simple;frag_shader:simple;position,uv"
+		auto program_key(const asset::AID& vertex_shader, const asset::AID& fragment_shader,
+		                 const Vertex_layout& layout) -> std::string {
+			auto key = vertex_shader.str()+";"+fragment_shader.str()+";";
+			for(auto& e : layout.elements())
+				key += e.name+",";
+
+			return key;
+		}
+
+		auto key_prefix(uint64_t key_hash) {
+			std::stringstream s;
+			s<<cache_prefix<<std::hex<<key_hash<<"_";
+			return s.str();
+		}
+
+		auto starts_with(const std::string& str, const std::string& prefix) {
+			return str.compare(0, prefix.size(), prefix)==0;
+		}
+	}
+
+	auto program_cache()noexcept -> Program_cache* {
+		return current_cache;
+	}
+
+	auto load_program(asset::Asset_manager& assets,
+	                  const asset::AID& vertex_shader, const asset::AID& fragment_shader,
+	                  const Vertex_layout& layout) -> Shader_program_ptr {
+		if(current_cache)
+			return current_cache->get(vertex_shader, fragment_shader, layout);
+
+		auto prog = std::make_shared<Shader_program>();
+		prog->attach_shader(assets.load<Shader>(vertex_shader))
+		     .attach_shader(assets.load<Shader>(fragment_shader))
+		     .bind_all_attribute_locations(layout)
+		     .build();
+
+		return prog;
+	}
+
+
+	Program_cache::Program_cache(asset::Asset_manager& assets, bool store_binaries)
+	    : _assets(assets), _store_binaries(store_binaries && Shader_program::binaries_supported()) {
+
+		INVARIANT(!current_cache, "Only one program cache is allowed per context");
+
+		// binaries are only valid for the driver that created them
+		auto driver = Fnv1a{};
+		driver.add(cache_version);
+		driver.add(gl_string(GL_VENDOR));
+		driver.add(gl_string(GL_RENDERER));
+		driver.add(gl_string(GL_VERSION));
+		_driver_hash = driver.value();
+
+		if(store_binaries && !_store_binaries)
+			INFO("Program binaries are not supported by the driver");
+
+		current_cache = this;
+	}
+	Program_cache::~Program_cache()noexcept {
+		if(current_cache==this)
+			current_cache = nullptr;
+	}
+
+	auto Program_cache::get(const asset::AID& vertex_shader, const asset::AID& fragment_shader,
+	                        const Vertex_layout& layout) -> Shader_program_ptr {
+		auto key = program_key(vertex_shader, fragment_shader, layout);
+
+		auto iter = _programs.find(key);
+		if(iter!=_programs.end()) {
+			_stats.reused++;
+			return iter->second;
+		}
+
+		auto watch = util::Stopwatch{};
+
+		auto prog = std::make_shared<Shader_program>();
+		prog->attach_shader(_assets.load<Shader>(vertex_shader))
+		     .attach_shader(_assets.load<Shader>(fragment_shader))
+		     .bind_all_attribute_locations(layout);
+
+		if(_store_binaries) {
+			auto key_hash = Fnv1a{};
+			key_hash.add(key);
+
+			auto hash = Fnv1a{};
+			hash.add(_driver_hash);
+			for(auto& s : prog->attached_shaders())
+				hash.add(s->source_hash());
+
+			std::stringstream name;
+			name<<key_prefix(key_hash.value())<<std::hex<<hash.value()<<cache_suffix;
+			auto aid = asset::AID{asset::Asset_type::gen, name.str()};
+
+			if(_load_binary(*prog, aid)) {
+				_stats.loaded++;
+
+			} else {
+				prog->build();
+				_stats.linked++;
+				_store_binary(*prog, aid, key_hash.value());
+			}
+
+		} else {
+			prog->build();
+			_stats.linked++;
+		}
+
+		_stats.ms += watch.ms();
+		DEBUG("Created shader program "<<key<<" in "<<watch.ms()<<"ms");
+
+		_programs.emplace(std::move(key), prog);
+		return prog;
+	}
+
+	auto Program_cache::_load_binary(Shader_program& prog, const asset::AID& aid) -> bool {
+		// read through PhysFS instead of mapping the file, so this doesn't depend
+		//   on the write directory being a plain directory
+		try {
+			auto binary = _assets.load_maybe<Program_binary>(aid);
+			if(binary.is_nothing())
+				return false;
+
+			auto& b = *binary.get_or_throw();
+			if(prog.load_binary(b.format, b.data)) {
+				DEBUG("Loaded cached program binary "<<aid.str()<<" ("<<b.data.size()<<" bytes)");
+				return true;
+			}
+
+		} catch(asset::Loading_failed& e) {
+			WARN("Unable to read program cache entry "<<aid.str()<<": "<<e.what());
+		}
+
+		WARN("Discarding invalid program cache entry "<<aid.str());
+		_assets.erase(aid);
+		return false;
+	}
+
+	void Program_cache::_store_binary(const Shader_program& prog, const asset::AID& aid,
+	                                  uint64_t key_hash) {
+		auto binary = Program_binary{};
+		binary.data = prog.binary(binary.format);
+		if(binary.data.empty())
+			return;
+
+		// older versions of this program (changed shaders or driver) will never be used again
+		auto prefix = key_prefix(key_hash);
+		for(auto& entry : _assets.list(asset::Asset_type::gen, prefix)) {
+			if(entry!=aid && starts_with(entry.name(), prefix)) {
+				DEBUG("Removing stale program cache entry "<<entry.str());
+				_assets.erase(entry);
+			}
+		}
+
+		_assets.save(aid, binary);
+	}
+
+}
+
+namespace asset {
+	auto Loader<renderer::Program_binary>::load(istream in) -> std::shared_ptr<renderer::Program_binary> {
+		auto binary = std::make_shared<renderer::Program_binary>();
+		auto bytes = in.bytes();
+		if(bytes.size()<sizeof(uint32_t))
+			throw Loading_failed("Program binary is truncated: "+in.aid().str());
+
+		std::memcpy(&binary->format, bytes.data(), sizeof(uint32_t));
+		binary->data.assign(bytes.begin()+sizeof(uint32_t), bytes.end());
+		return binary;
+	}
+
+	void Loader<renderer::Program_binary>::store(ostream out, const renderer::Program_binary& binary) {
+		out.write(reinterpret_cast<const char*>(&binary.format), sizeof(uint32_t));
+		out.write(reinterpret_cast<const char*>(binary.data.data()), binary.data.size());
+	}
+}
+}
@@ -0,0 +1,98 @@
+/**************************************************************************\
+ * shared shader programs and their binary cache                          *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "shader.hpp"
+
+#include "../asset/aid.hpp"
+#include "../utils/template_utils.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mo {
+	namespace asset {class Asset_manager;}
+
+namespace renderer {
+	class Vertex_layout;
+
+	using Shader_program_ptr = std::shared_ptr<Shader_program>;
+
+	/// linked program as returned by the driver (ARB_get_program_binary)
+	struct Program_binary {
+		uint32_t format = 0;
+		std::vector<uint8_t> data;
+	};
+
+	struct Program_cache_stats {
+		int reused = 0;  //< programs that already existed
+		int linked = 0;  //< programs compiled and linked from source
+		int loaded = 0;  //< programs loaded from a cached binary
+		float ms = 0;    //< time spent creating programs
+	};
+
+	/**
+	 * Shared shader programs, keyed by their shaders and vertex layout, so each
+	 *   program is linked at most once per process (instead of on every level change).
+	 * Users share the program object and with it the uniform values, so they
+	 *   have to set all their uniforms before they draw.
+	 * If the driver supports it, the linked programs are also stored in the
+	 *   write directory (gen:program_cache_<key>_<hash>.bin). The hash covers the
+	 *   shader sources and the driver version, so outdated binaries are ignored
+	 *   and replaced.
+	 */
+	class Program_cache : util::no_copy_move {
+		public:
+			Program_cache(asset::Asset_manager& assets, bool store_binaries);
+			~Program_cache()noexcept;
+
+			auto get(const asset::AID& vertex_shader, const asset::AID& fragment_shader,
+			         const Vertex_layout& layout) -> Shader_program_ptr;
+
+			auto stats()const noexcept -> const Program_cache_stats& {return _stats;}
+
+		private:
+			auto _load_binary(Shader_program& prog, const asset::AID& aid) -> bool;
+			void _store_binary(const Shader_program& prog, const asset::AID& aid, uint64_t key_hash);
+
+			asset::Asset_manager& _assets;
+			const bool _store_binaries;
+			uint64_t _driver_hash;
+			std::unordered_map<std::string, Shader_program_ptr> _programs;
+			Program_cache_stats _stats;
+	};
+
+	/// the cache of the graphics context; null if there is none (e.g. disabled in cfg:graphics)
+	extern auto program_cache()noexcept -> Program_cache*;
+
+	/// the shared program from the cache or a new one, if there is no cache
+	extern auto load_program(asset::Asset_manager& assets,
+	                         const asset::AID& vertex_shader, const asset::AID& fragment_shader,
+	                         const Vertex_layout& layout) -> Shader_program_ptr;
+
+}
+
+namespace asset {
+	template<>
+	struct Loader<renderer::Program_binary> {
+		static auto load(istream in) -> std::shared_ptr<renderer::Program_binary>;
+		static void store(ostream out, const renderer::Program_binary& binary);
+	};
+}
+}
@@ -7,6 +7,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "vertex_object.hpp"
+#include "gl_state.hpp"
 
 namespace mo {
 namespace renderer {
@@ -41,6 +42,15 @@ namespace renderer {
 
 			return success!=0;
 		}
+		auto fnv1a(const std::string& str) -> uint64_t {
+			auto h = uint64_t(14695981039346656037ull);
+			for(auto c : str) {
+				h ^= static_cast<uint8_t>(c);
+				h *= 1099511628211ull;
+			}
+			return h;
+		}
+
 		bool get_gl_shader_status(unsigned int handle, GLenum status_type) {
 			GLint success = 0;
 			glGetShaderiv(handle, status_type, &success);
@@ -49,11 +59,18 @@ namespace renderer {
 		}
 	}
 
-	Shader::Shader(Shader_type type, const std::string& source, const std::string name) {
-		char const * source_pointer = source.c_str();
-		int len = source.length();
+	Shader::Shader(Shader_type type, std::string source, std::string name)
+	    : _type(type), _source(std::move(source)), _name(std::move(name)),
+	      _source_hash(fnv1a(_source)) {
+	}
+	void Shader::_compile()const {
+		if(_handle!=0)
+			return;
+
+		char const * source_pointer = _source.c_str();
+		int len = _source.length();
 
-		_handle = glCreateShader(shader_type_to_GLenum(type));
+		_handle = glCreateShader(shader_type_to_GLenum(_type));
 		glShaderSource(_handle, 1, &source_pointer , &len);
 		glCompileShader(_handle);
 
@@ -61,13 +78,16 @@ namespace renderer {
 		auto log = read_gl_info_log(_handle);
 		bool success = get_gl_shader_status(_handle, GL_COMPILE_STATUS);
 
-		INFO("Compiling shader:"<<name);
+		INFO("Compiling shader:"<<_name);
 		read_gl_info_log(_handle).process([](const auto& _){
 			DEBUG("Shader compiler log: \n"<<_);
 		});
 
-		if(!success)
-			throw Shader_compiler_error("Shader compiler failed for \""+name+"\": "+log.get_or_other("NO LOG"));
+		if(!success) {
+			glDeleteShader(_handle);
+			_handle = 0;
+			throw Shader_compiler_error("Shader compiler failed for \""+_name+"\": "+log.get_or_other("NO LOG"));
+		}
 	}
 	Shader::~Shader()noexcept {
 		if(_handle!=0)
@@ -84,10 +104,16 @@ namespace renderer {
 		if(_handle!=0)
 			glDeleteShader(_handle);
 
-		_handle = s._handle;
+		_type = s._type;
+		_source = std::move(s._source);
 		_name = std::move(s._name);
+		_source_hash = s._source_hash;
+		_handle = s._handle;
 		s._handle = 0;
 
+		// report errors of the modified source now instead of on the next link
+		_compile();
+
 		for(auto prog : _attached_to)
 			prog->build();
 
@@ -100,6 +126,7 @@ namespace renderer {
 	Shader_program::~Shader_program()noexcept {
 		detach_all();
 
+		forget_program(_handle);
 		glDeleteProgram(_handle);
 	}
 
@@ -117,8 +144,15 @@ namespace renderer {
 	}
 
 	Shader_program& Shader_program::build() {
-		for(auto& s : _attached_shaders)
+		for(auto& s : _attached_shaders) {
+			s->_compile();
 			glAttachShader(_handle, s->_handle);
+		}
+
+#ifndef EMSCRIPTEN
+		if(binaries_supported())
+			glProgramParameteri(_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
 
 		glLinkProgram(_handle);
 
@@ -145,6 +179,52 @@ namespace renderer {
 		return *this;
 	}
 
+	bool Shader_program::binaries_supported() {
+#ifndef EMSCRIPTEN
+		static const bool supported = [] {
+			if(!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+				return false;
+
+			// some drivers support the extension but no format
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			return formats>0;
+		}();
+
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	bool Shader_program::load_binary(uint32_t format, const std::vector<uint8_t>& data) {
+#ifndef EMSCRIPTEN
+		glProgramBinary(_handle, format, data.data(), data.size());
+
+		_uniform_locations.clear();
+
+		return get_gl_proc_status(_handle, GL_LINK_STATUS);
+#else
+		return false;
+#endif
+	}
+
+	auto Shader_program::binary(uint32_t& format)const -> std::vector<uint8_t> {
+		auto data = std::vector<uint8_t>{};
+#ifndef EMSCRIPTEN
+		GLint length = 0;
+		glGetProgramiv(_handle, GL_PROGRAM_BINARY_LENGTH, &length);
+		if(length<=0)
+			return data;
+
+		data.resize(length);
+		GLenum gl_format = 0;
+		glGetProgramBinary(_handle, length, nullptr, &gl_format, data.data());
+		format = gl_format;
+#endif
+		return data;
+	}
+
 	Shader_program& Shader_program::bind_all_attribute_locations(const Vertex_layout& vl) {
 		vl.setup_shader(*this);
 		return *this;
@@ -156,39 +236,45 @@ namespace renderer {
 
 
 	Shader_program& Shader_program::bind() {
-		glUseProgram(_handle);
+		use_program(_handle);
 
 		return *this;
 	}
 	Shader_program& Shader_program::unbind() {
-		glUseProgram(0);
+		use_program(0);
 
 		return *this;
 	}
 
+	auto Shader_program::_uniform_location(Uniform_name name) -> int {
+		for(auto& u : _uniform_locations)
+			if(u.hash==name.hash)
+				return u.location;
+
+		auto location = glGetUniformLocation(_handle, name.str);
+		_uniform_locations.push_back(Uniform_location{name.hash, location});
+		return location;
+	}
+
 #define SHADER_SETU(TYPE,CALL) \
-	Shader_program& Shader_program::set_uniform(const std::string& name, TYPE value) {\
-		auto it = _uniform_locations.find(name);\
-		if (it == _uniform_locations.end()) {\
-			it = _uniform_locations.emplace(name,\
-			glGetUniformLocation(_handle, name.c_str())).first;\
-		}\
+	Shader_program& Shader_program::set_uniform(Uniform_name name, TYPE value) {\
+		auto location = _uniform_location(name);\
 		CALL;\
 		return *this;\
 	}
 
-    SHADER_SETU(int,                           glUniform1i(it->second, value))
-    SHADER_SETU(float,                         glUniform1f(it->second, value))
-    SHADER_SETU(const glm::vec2&,              glUniform2fv(it->second, 1, glm::value_ptr(value)))
-    SHADER_SETU(const glm::vec3&,              glUniform3fv(it->second, 1, glm::value_ptr(value)))
-    SHADER_SETU(const glm::vec4&,              glUniform4fv(it->second, 1, glm::value_ptr(value)))
-    SHADER_SETU(const glm::mat2&,              glUniformMatrix2fv(it->second, 1, GL_FALSE, glm::value_ptr(value)))
-    SHADER_SETU(const glm::mat3&,              glUniformMatrix3fv(it->second, 1, GL_FALSE, glm::value_ptr(value)))
-    SHADER_SETU(const glm::mat4&,              glUniformMatrix4fv(it->second, 1, GL_FALSE, glm::value_ptr(value)))
-    SHADER_SETU(const std::vector<float>& ,    glUniform1fv(it->second, value.size(), value.data()))
-    SHADER_SETU(const std::vector<glm::vec2>&, glUniform2fv(it->second, value.size(), reinterpret_cast<const GLfloat*>(value.data())))
-    SHADER_SETU(const std::vector<glm::vec3>&, glUniform3fv(it->second, value.size(), reinterpret_cast<const GLfloat*>(value.data())))
-    SHADER_SETU(const std::vector<glm::vec4>&, glUniform4fv(it->second, value.size(), reinterpret_cast<const GLfloat*>(value.data())))
+    SHADER_SETU(int,                           glUniform1i(location, value))
+    SHADER_SETU(float,                         glUniform1f(location, value))
+    SHADER_SETU(const glm::vec2&,              glUniform2fv(location, 1, glm::value_ptr(value)))
+    SHADER_SETU(const glm::vec3&,              glUniform3fv(location, 1, glm::value_ptr(value)))
+    SHADER_SETU(const glm::vec4&,              glUniform4fv(location, 1, glm::value_ptr(value)))
+    SHADER_SETU(const glm::mat2&,              glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value)))
+    SHADER_SETU(const glm::mat3&,              glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)))
+    SHADER_SETU(const glm::mat4&,              glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)))
+    SHADER_SETU(const std::vector<float>& ,    glUniform1fv(location, value.size(), value.data()))
+    SHADER_SETU(const std::vector<glm::vec2>&, glUniform2fv(location, value.size(), reinterpret_cast<const GLfloat*>(value.data())))
+    SHADER_SETU(const std::vector<glm::vec3>&, glUniform3fv(location, value.size(), reinterpret_cast<const GLfloat*>(value.data())))
+    SHADER_SETU(const std::vector<glm::vec4>&, glUniform4fv(location, value.size(), reinterpret_cast<const GLfloat*>(value.data())))
 
 #undef SHADER_SETU
 
@@ -19,8 +19,8 @@
 
 #include <string>
 #include <memory>
-#include <unordered_map>
 #include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "../asset/asset_manager.hpp"
 
@@ -40,23 +40,53 @@ namespace renderer {
 
 	class Shader {
 		public:
-			Shader(Shader_type type, const std::string& source, const std::string name="unnamed");
+			Shader(Shader_type type, std::string source, std::string name="unnamed");
 			~Shader()noexcept;
 
 			Shader& operator=(Shader&&);
 
+			auto name()const noexcept -> const std::string& {return _name;}
+
+			/// FNV-1a hash of the source, identifies outdated program binaries
+			auto source_hash()const noexcept {return _source_hash;}
+
 		private:
 			friend class Shader_program;
-			unsigned int _handle;
+			Shader_type _type;
+			std::string _source;
 			std::string _name;
+			uint64_t _source_hash;
+			mutable unsigned int _handle = 0;
 			mutable std::vector<Shader_program*> _attached_to;
 
+			/// compiled on first use, so programs loaded from a binary don't need to compile it at all
+			void _compile()const;
 			void _on_attach(Shader_program* prog)const;
 			void _on_detach(Shader_program* prog)const;
 	};
 
 	class Vertex_layout;
 
+	/// name of a uniform and its FNV-1a hash (computed at compile time for literals)
+	struct Uniform_name {
+		uint64_t hash;
+		const char* str;
+
+		template<std::size_t N>
+		constexpr Uniform_name(const char (&name)[N])noexcept : hash(_hash(name, N-1)), str(name) {}
+		Uniform_name(const std::string& name)noexcept : hash(_hash(name.c_str(), name.size())), str(name.c_str()) {}
+
+		private:
+			static constexpr uint64_t _hash(const char* str, std::size_t len)noexcept {
+				uint64_t h = 14695981039346656037ull;
+				for(auto i=0u; i<len; ++i) {
+					h ^= static_cast<uint8_t>(str[i]);
+					h *= 1099511628211ull;
+				}
+				return h;
+			}
+	};
+
 	class Shader_program {
 		public:
 			Shader_program();
@@ -71,27 +101,47 @@ namespace renderer {
 			Shader_program& build();
 			Shader_program& detach_all();
 
+			/// true if the driver can save and load linked programs (ARB_get_program_binary)
+			static bool binaries_supported();
+
+			/// loads a binary returned by binary(); false if the driver rejected it (e.g. after an update)
+			bool load_binary(uint32_t format, const std::vector<uint8_t>& data);
+
+			/// the linked program in a driver specific format; empty if that is not supported
+			auto binary(uint32_t& format)const -> std::vector<uint8_t>;
+
+			auto attached_shaders()const noexcept -> const std::vector<std::shared_ptr<const Shader>>& {
+				return _attached_shaders;
+			}
+
 
 			Shader_program& bind();
 			Shader_program& unbind();
 
-			Shader_program& set_uniform(const std::string& name, int value);
-			Shader_program& set_uniform(const std::string& name,float value);
-			Shader_program& set_uniform(const std::string& name,const glm::vec2& value);
-			Shader_program& set_uniform(const std::string& name,const glm::vec3& value);
-			Shader_program& set_uniform(const std::string& name,const glm::vec4& value);
-			Shader_program& set_uniform(const std::string& name,const glm::mat2& value);
-			Shader_program& set_uniform(const std::string& name,const glm::mat3& value);
-			Shader_program& set_uniform(const std::string& name,const glm::mat4& value);
-			Shader_program& set_uniform(const std::string& name,const std::vector<float>& value);
-			Shader_program& set_uniform(const std::string& name,const std::vector<glm::vec2>& value);
-			Shader_program& set_uniform(const std::string& name,const std::vector<glm::vec3>& value);
-			Shader_program& set_uniform(const std::string& name,const std::vector<glm::vec4>& value);
+			Shader_program& set_uniform(Uniform_name name, int value);
+			Shader_program& set_uniform(Uniform_name name,float value);
+			Shader_program& set_uniform(Uniform_name name,const glm::vec2& value);
+			Shader_program& set_uniform(Uniform_name name,const glm::vec3& value);
+			Shader_program& set_uniform(Uniform_name name,const glm::vec4& value);
+			Shader_program& set_uniform(Uniform_name name,const glm::mat2& value);
+			Shader_program& set_uniform(Uniform_name name,const glm::mat3& value);
+			Shader_program& set_uniform(Uniform_name name,const glm::mat4& value);
+			Shader_program& set_uniform(Uniform_name name,const std::vector<float>& value);
+			Shader_program& set_uniform(Uniform_name name,const std::vector<glm::vec2>& value);
+			Shader_program& set_uniform(Uniform_name name,const std::vector<glm::vec3>& value);
+			Shader_program& set_uniform(Uniform_name name,const std::vector<glm::vec4>& value);
 
 		private:
+			struct Uniform_location {
+				uint64_t hash;
+				int location;
+			};
+
+			auto _uniform_location(Uniform_name name) -> int;
+
 			unsigned int _handle;
 			std::vector<std::shared_ptr<const Shader>> _attached_shaders;
-			std::unordered_map<std::string,int> _uniform_locations;
+			std::vector<Uniform_location> _uniform_locations; //< few per program, so a linear search is fastest
 	};
 
 } /* namespace renderer */
@@ -1,5 +1,10 @@
 #include "sprite_batch.hpp"
 
+#include "../utils/radix_sort.hpp"
+
+#include <GL/glew.h>
+
+
 namespace mo {
 namespace renderer {
 
@@ -8,94 +13,158 @@ namespace renderer {
 	// layout description for vertices
 	Vertex_layout layout {
 		Vertex_layout::Mode::triangles,
-		vertex("position",  &Sprite_batch::Sprite_vertex::pos),
-		vertex("uv",        &Sprite_batch::Sprite_vertex::uv)
+		vertex("position",  &Sprite_batch::Sprite_vertex::position),
+		vertex("uv",        &Sprite_batch::Sprite_vertex::uv, 0, 0, true),
+		vertex("layer",     &Sprite_batch::Sprite_vertex::layer)
 	};
 
-	Sprite_batch::Sprite_batch(asset::Asset_manager& asset_manager) : _object(layout, create_dynamic_buffer<Sprite_vertex>(64)){
-		_shader.attach_shader(asset_manager.load<Shader>("vert_shader:sprite_batch"_aid))
-			   .attach_shader(asset_manager.load<Shader>("frag_shader:sprite_batch"_aid))
-		       .bind_all_attribute_locations(layout)
-		       .build();
+	namespace {
+		struct Quad_corner {
+			glm::vec2 corner;
+		};
+
+		// the quad is expanded in the vertex shader, based on the per-instance data
+		Vertex_layout instanced_layout {
+			Vertex_layout::Mode::triangle_strip,
+			vertex("corner",         &Quad_corner::corner,             0, 0),
+			vertex("position",       &Sprite_instance::position,       1, 1),
+			vertex("layer_rotation", &Sprite_instance::layer_rotation, 1, 1, true),
+			vertex("uv_rect",        &Sprite_instance::uv,             1, 1, true)
+		};
+
+		std::vector<Quad_corner> quad_corners {
+			{{-1,-1}},
+			{{ 1,-1}},
+			{{-1, 1}},
+			{{ 1, 1}}
+		};
+
+		bool instancing_supported() {
+#ifdef __EMSCRIPTEN__
+			return true; // already required by the particle renderer
+#else
+			return GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays;
+#endif
+		}
 	}
 
-	void Sprite_batch::draw(const Camera& cam, const Sprite& sprite) noexcept {
-
-		// [foe]: auto& for less ressource using?
-		auto& uv = sprite.uv;
+	Sprite_batch::Sprite_batch(asset::Asset_manager& asset_manager, bool instanced)
+	    : _instanced(instanced && instancing_supported()),
+	      _object(layout, create_dynamic_buffer<Sprite_vertex>(64)),
+	      _instanced_object(instanced_layout, create_buffer(quad_corners),
+	                        create_dynamic_buffer<Sprite_instance>(64)) {
 
-		auto x = sprite.position.x.value(), y = sprite.position.y.value();
-		auto width = (uv.z - uv.x) * sprite.texture->width() / cam.world_scale(),
-			  height = (uv.w - uv.y) * sprite.texture->height() / cam.world_scale();
+		if(_instanced) {
+			_shader = load_program(asset_manager, "vert_shader:sprite_batch_instanced"_aid,
+			                       "frag_shader:sprite_batch"_aid, instanced_layout);
 
-		// Rotation Matrix to be applied to coords of the Sprite
-		glm::mat4 rotMat = glm::translate(glm::vec3(x, y, sprite.layer)) * glm::rotate(sprite.rotation, glm::vec3(0.f, 0.f, 1.f));
+		} else {
+			INFO("Instancing is not supported. Sprites are transformed on the CPU.");
 
-//		std::cout << "Entity with Sprite Component at: " << x << "/" << y << std::endl;
-//		std::cout << "Name of attached texture: " << sprite.texture.str() << std::endl;
-//		std::cout << "rotation is: " << sprite.rotation << std::endl;
-
-		_vertices.push_back(Sprite_vertex(rotMat * glm::vec4(-width / 2.f, -height / 2.f, 0.0f, 1.0f), {uv.x, uv.y}, &*sprite.texture));
-		_vertices.push_back(Sprite_vertex(rotMat * glm::vec4(-width / 2.f, height / 2.f, 0.0f, 1.0f), {uv.x, uv.w}, &*sprite.texture));
-		_vertices.push_back(Sprite_vertex(rotMat * glm::vec4(width / 2.f, height / 2.f, 0.0f, 1.0f), {uv.z, uv.w}, &*sprite.texture));
-
-		//_vertices.push_back({{x, y}, {uv.x, uv.w}, {sprite.texture}});
-		//_vertices.push_back({{x, y+1.f}, {uv.x, uv.y}, {sprite.texture}});
-		//_vertices.push_back({{x+1.f, y+1.f}, {uv.z, uv.y}, {sprite.texture}});
-
-		_vertices.push_back(Sprite_vertex(rotMat * glm::vec4(width / 2.f, height / 2.f, 0.0f, 1.0f), {uv.z, uv.w}, &*sprite.texture));
-		_vertices.push_back(Sprite_vertex(rotMat * glm::vec4(-width / 2.f, -height / 2.f, 0.0f, 1.0f), {uv.x, uv.y}, &*sprite.texture));
-		_vertices.push_back(Sprite_vertex(rotMat * glm::vec4(width / 2.f, -height / 2.f, 0.0f, 1.0f), {uv.z, uv.y}, &*sprite.texture));
+			_shader = load_program(asset_manager, "vert_shader:sprite_batch"_aid,
+			                       "frag_shader:sprite_batch"_aid, layout);
+		}
+	}
 
-		//_vertices.push_back({{x+1.f, y+1.f}, {uv.z, uv.y}, {sprite.texture}});
-		//_vertices.push_back({{x, y}, {uv.x, uv.w}, {sprite.texture}});
-		//_vertices.push_back({{x+1.f, y}, {uv.z, uv.w}, {sprite.texture}});
+	void Sprite_batch::draw(const Camera& cam, const Sprite& sprite) noexcept {
 
-	}
+		// [foe]: auto& for less ressource using?
+		auto& uv = sprite.uv;
 
+		auto offset = glm::vec2(sprite.position.x.value(), sprite.position.y.value()) - cam.position();
+		auto size = glm::vec2((uv.z - uv.x) * sprite.texture->width(),
+		                      (uv.w - uv.y) * sprite.texture->height()) / cam.world_scale();
 
-	void Sprite_batch::draw_part(std::vector<Sprite_vertex>::const_iterator begin, std::vector<Sprite_vertex>::const_iterator end){
+		// far outside of the screen
+		if(!in_packed_range(offset, size))
+			return;
 
-		// check for nullptr and begin != end
-		// bind the appropriate texture and set the object buffer to
-		// the corresponding positions that has to be drawn
-		if(begin!=end && begin->tex){
-			begin->tex->bind();
-			_object.buffer().set<Sprite_vertex>(begin, end);
-			_object.draw();
-		}
+		auto index = static_cast<uint32_t>(_textures.size());
+		_draw_keys.push_back(Sprite_draw_key{make_draw_key(sprite.layer, sprite.texture->id()), index});
+		_textures.push_back(sprite.texture);
 
+		if(_instanced)
+			_instances.push_back(make_sprite_instance(offset, sprite.layer, sprite.rotation, uv));
+		else
+			append_sprite_vertices(_vertices, offset, sprite.layer, sprite.rotation, size, uv);
 	}
 
 
 	void Sprite_batch::drawAll(const Camera& cam) noexcept {
 
-		glm::mat4 MVP = cam.vp();
-		_shader.bind()
-			   .set_uniform("MVP", MVP)
+		_shader->bind()
+			   .set_uniform("MVP", sprite_mvp(cam.vp(), cam.position()))
 			   .set_uniform("myTextureSampler", 0);
 
-		// Sorting the vertices by used texture
+		// sorting the (small) keys instead of the vertices, by layer and texture id
 		// so that blocks of vertices are bound together
 		// where the textures match each other -> less switching in texture binding
-		std::stable_sort(_vertices.begin(), _vertices.end());
+		util::radix_sort(_draw_keys, _draw_keys_tmp, [](const Sprite_draw_key& k) {return k.key;});
 
-		auto last = _vertices.begin();
-		for(auto curIter = _vertices.begin(); curIter != _vertices.end(); ++curIter){
+		if(_instanced)
+			_draw_all_instanced(cam);
+		else
+			_draw_all_vertices();
 
-			// if texture reference at the current iterator position differs from the one before
-			// draw from the last marked iterator position to the current position
-			// and set the last marker to the current iterator position
-			if(curIter->tex != last->tex){
-				draw_part(last, curIter);
-				last = curIter;
-			}
+		_draw_keys.clear();
+		_textures.clear();
+	}
+
+	void Sprite_batch::_draw_all_vertices() {
+		_sorted_vertices.clear();
+		_sorted_vertices.reserve(_vertices.size());
+		for(auto& k : _draw_keys) {
+			auto first = _vertices.begin() + k.index*6;
+			_sorted_vertices.insert(_sorted_vertices.end(), first, first+6);
 		}
 
-		draw_part(last, _vertices.end());
+		// one draw call for each block of sprites with the same texture
+		auto begin = std::size_t(0);
+		for(auto i=std::size_t(1); i<=_draw_keys.size(); ++i) {
+			auto texture = _textures[_draw_keys[begin].index];
+
+			if(i==_draw_keys.size() || _textures[_draw_keys[i].index]!=texture) {
+				if(texture) {
+					texture->bind();
+					_object.buffer().set<Sprite_vertex>(_sorted_vertices.begin()+begin*6,
+					                                    _sorted_vertices.begin()+i*6);
+					_object.draw();
+				}
+
+				begin = i;
+			}
+		}
 
 		_vertices.clear();
+	}
+
+	void Sprite_batch::_draw_all_instanced(const Camera& cam) {
+		_sorted_instances.clear();
+		_sorted_instances.reserve(_instances.size());
+		for(auto& k : _draw_keys)
+			_sorted_instances.push_back(_instances[k.index]);
+
+		auto begin = std::size_t(0);
+		for(auto i=std::size_t(1); i<=_draw_keys.size(); ++i) {
+			auto texture = _textures[_draw_keys[begin].index];
+
+			if(i==_draw_keys.size() || _textures[_draw_keys[i].index]!=texture) {
+				if(texture) {
+					auto texture_size = glm::vec2(texture->width(), texture->height())
+					                  / cam.world_scale() * sprite_position_scale;
+					_shader->set_uniform("texture_size", texture_size);
+
+					texture->bind();
+					_instanced_object.buffer(1).set<Sprite_instance>(_sorted_instances.begin()+begin,
+					                                                 _sorted_instances.begin()+i);
+					_instanced_object.draw();
+				}
+
+				begin = i;
+			}
+		}
 
+		_instances.clear();
 	}
 
 }
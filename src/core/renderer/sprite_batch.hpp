@@ -16,7 +16,8 @@
 #pragma once
 
 #include "vertex_object.hpp"
-#include "shader.hpp"
+#include "sprite_geometry.hpp"
+#include "program_cache.hpp"
 #include "camera.hpp"
 #include "texture.hpp"
 #include "animation.hpp"
@@ -36,21 +37,7 @@ namespace renderer {
 
 	public:
 
-		struct Sprite_vertex {
-			Sprite_vertex(glm::vec4 vec, glm::vec2 uv_coords, const renderer::Texture* t) : tex(t){
-				pos = glm::vec3(vec.x, vec.y, vec.z);
-				uv = uv_coords;
-			}
-
-			bool operator<(Sprite_vertex const& other) const {
-				//std::cout << "this tex: " << this->tex << " | other tex: " << other.tex << std::endl;
-				return (this->tex < other.tex);
-			}
-
-			glm::vec3 pos;
-			glm::vec2 uv;
-			const renderer::Texture* tex;
-		};
+		using Sprite_vertex = renderer::Sprite_vertex;
 
 		struct Sprite{
 			Position position;
@@ -61,20 +48,34 @@ namespace renderer {
 		};
 
 		// Constructors
-		Sprite_batch(asset::Asset_manager& asset_manager);
+		/// uses the instanced path if it is supported, otherwise the sprites are transformed on the CPU
+		Sprite_batch(asset::Asset_manager& asset_manager, bool instanced=true);
 
 		// Methods
+		/// sprites are positioned relative to the camera; all have to be drawn with the same camera
         void draw(const renderer::Camera& cam, const Sprite& sprite) noexcept;
-		void draw_part(const std::vector<Sprite_vertex>::const_iterator begin, const std::vector<Sprite_vertex>::const_iterator end);
 		void drawAll(const renderer::Camera& cam) noexcept;
 
 
 	private:
+		void _draw_all_vertices();
+		void _draw_all_instanced(const renderer::Camera& cam);
+
+		bool _instanced;
+
+		std::vector<Sprite_draw_key> _draw_keys;
+		std::vector<Sprite_draw_key> _draw_keys_tmp;
+		std::vector<const renderer::Texture*> _textures; //< one per sprite, indexed by Sprite_draw_key::index
 
 		mutable std::vector<Sprite_vertex> _vertices;
+		std::vector<Sprite_vertex> _sorted_vertices;
+
+		std::vector<Sprite_instance> _instances;
+		std::vector<Sprite_instance> _sorted_instances;
 
 		renderer::Object _object;
-		renderer::Shader_program _shader;
+		renderer::Object _instanced_object;
+		renderer::Shader_program_ptr _shader;
 
 
 	};
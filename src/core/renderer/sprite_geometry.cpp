@@ -0,0 +1,102 @@
+#include "sprite_geometry.hpp"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace mo {
+namespace renderer {
+
+	auto make_draw_key(float layer, uint32_t texture, uint8_t shader) -> uint64_t {
+		// flip the bits of floats, so their order matches the order of the unsigned integers
+		uint32_t layer_bits;
+		std::memcpy(&layer_bits, &layer, sizeof(layer_bits));
+		layer_bits ^= (layer_bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+
+		return (static_cast<uint64_t>(layer_bits>>16) << 48)
+		     | (static_cast<uint64_t>(shader) << 40)
+		     | (static_cast<uint64_t>(texture & 0xffffff) << 16);
+	}
+
+	namespace {
+		constexpr float max_offset = 32767.f / sprite_position_scale;
+		constexpr float pi = 3.14159265358979323846f;
+
+		// std::round/floor are library calls without SSE4.1, truncation isn't.
+		//   The bias keeps the value positive, so truncation rounds (for |v|<2^16)
+		auto round(float v) {
+			return static_cast<int32_t>(v + 65536.5f) - 65536;
+		}
+
+		auto pack_position(glm::vec2 p) {
+			return glm::i16vec2(static_cast<int16_t>(round(p.x*sprite_position_scale)),
+			                    static_cast<int16_t>(round(p.y*sprite_position_scale)));
+		}
+		auto pack_snorm(float v) {
+			return static_cast<int16_t>(round(glm::clamp(v, -1.f, 1.f) * 32767.f));
+		}
+		auto pack_unorm(float v) {
+			return static_cast<uint16_t>(round(glm::clamp(v, 0.f, 1.f) * 65535.f));
+		}
+		/// to [-pi, pi]
+		auto wrap_angle(float a) {
+			return std::abs(a)<=pi ? a : a - 2.f*pi * std::floor((a+pi) / (2.f*pi));
+		}
+	}
+
+	auto in_packed_range(glm::vec2 offset, glm::vec2 size) -> bool {
+		// a rotated sprite can reach up to its diagonal from its center
+		auto reach = glm::length(size)/2.f;
+		return std::abs(offset.x)+reach < max_offset && std::abs(offset.y)+reach < max_offset;
+	}
+
+	void append_sprite_vertices(std::vector<Sprite_vertex>& out, glm::vec2 offset, float layer,
+	                            float rotation, glm::vec2 size, glm::vec4 uv) {
+		auto half = size / 2.f;
+		auto c = std::cos(rotation);
+		auto s = std::sin(rotation);
+
+		// each corner is packed once and shared by the two triangles
+		auto corner = [&](float x, float y) {
+			return pack_position(offset + glm::vec2(c*x - s*y, s*x + c*y));
+		};
+		const auto bottom_left  = corner(-half.x, -half.y);
+		const auto top_left     = corner(-half.x,  half.y);
+		const auto top_right    = corner( half.x,  half.y);
+		const auto bottom_right = corner( half.x, -half.y);
+
+		const auto u0 = pack_unorm(uv.x);
+		const auto v0 = pack_unorm(uv.y);
+		const auto u1 = pack_unorm(uv.z);
+		const auto v1 = pack_unorm(uv.w);
+
+		const Sprite_vertex vertices[] = {
+			{bottom_left,  {u0, v0}, layer},
+			{top_left,     {u0, v1}, layer},
+			{top_right,    {u1, v1}, layer},
+			{top_right,    {u1, v1}, layer},
+			{bottom_left,  {u0, v0}, layer},
+			{bottom_right, {u1, v0}, layer}
+		};
+		out.insert(out.end(), std::begin(vertices), std::end(vertices));
+	}
+
+	auto make_sprite_instance(glm::vec2 offset, float layer, float rotation,
+	                          glm::vec4 uv) -> Sprite_instance {
+		return Sprite_instance{
+			pack_position(offset),
+			{pack_snorm(layer), pack_snorm(wrap_angle(rotation) / pi)},
+			{pack_unorm(uv.x), pack_unorm(uv.y), pack_unorm(uv.z), pack_unorm(uv.w)}
+		};
+	}
+
+	auto sprite_mvp(const glm::mat4& view_proj, glm::vec2 origin) -> glm::mat4 {
+		return view_proj
+		     * glm::translate(glm::vec3(origin, 0.f))
+		     * glm::scale(glm::vec3(1.f/sprite_position_scale, 1.f/sprite_position_scale, 1.f));
+	}
+
+}
+}
@@ -0,0 +1,86 @@
+/**************************************************************************\
+ * CPU-side geometry of sprites (vertices and instance records)           *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace mo {
+namespace renderer {
+
+	/**
+	 * Sprite positions are stored as 16 bit fixed point numbers relative to
+	 *   the camera (sprite_position_scale units per world unit), which covers
+	 *   +-256 world units around it.
+	 */
+	constexpr float sprite_position_scale = 128.f;
+
+	/// one corner of a sprite, transformed on the CPU (used if instancing is not available)
+	struct Sprite_vertex {
+		glm::i16vec2 position; //< relative to the camera, fixed point
+		glm::u16vec2 uv;       //< normalized
+		float layer;
+	};
+	static_assert(sizeof(Sprite_vertex)==12, "Sprite_vertex is not packed");
+
+	/**
+	 * Everything the vertex shader needs to expand a sprite into its quad.
+	 * The size is calculated from the uv rect and the size of the texture
+	 *   (a uniform), like Sprite_batch::draw does for the vertices.
+	 */
+	struct Sprite_instance {
+		glm::i16vec2 position;       //< relative to the camera, fixed point
+		glm::i16vec2 layer_rotation; //< normalized; layer, rotation/pi
+		glm::u16vec4 uv;             //< normalized; min u, min v, max u, max v
+	};
+	static_assert(sizeof(Sprite_instance)==16, "Sprite_instance is not packed");
+
+	/// a sprite in the draw order; index refers to the vertices/instance of the sprite
+	struct Sprite_draw_key {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	/**
+	 * Sort key of a sprite: layer (16 bits), shader (8 bits), texture (24 bits).
+	 * Sprites with equal keys are drawn in the order they have been submitted.
+	 */
+	extern auto make_draw_key(float layer, uint32_t texture, uint8_t shader=0) -> uint64_t;
+
+	/// false if the sprite is too far away from the origin to be packed
+	extern auto in_packed_range(glm::vec2 offset, glm::vec2 size) -> bool;
+
+	/**
+	 * Appends the six vertices (two triangles) of a sprite
+	 * @param offset of the center relative to the camera (in world units)
+	 * @param size of the sprite in world units
+	 */
+	extern void append_sprite_vertices(std::vector<Sprite_vertex>& out, glm::vec2 offset, float layer,
+	                                   float rotation, glm::vec2 size, glm::vec4 uv);
+
+	/// @param offset of the center relative to the camera (in world units)
+	extern auto make_sprite_instance(glm::vec2 offset, float layer, float rotation,
+	                                 glm::vec4 uv) -> Sprite_instance;
+
+	/// the sprite transformation of a camera for the packed positions
+	extern auto sprite_mvp(const glm::mat4& view_proj, glm::vec2 origin) -> glm::mat4;
+
+}
+}
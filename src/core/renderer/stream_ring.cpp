@@ -0,0 +1,216 @@
+#include "stream_ring.hpp"
+
+#include "gl_state.hpp"
+#include "vertex_object.hpp"
+
+#include "../utils/log.hpp"
+#include "../utils/stopwatch.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mo {
+namespace renderer {
+
+	namespace {
+		constexpr std::size_t alignment = 16;
+
+		Stream_ring* current_ring = nullptr;
+
+		auto to_sync(void* f) {
+			return reinterpret_cast<GLsync>(f);
+		}
+	}
+
+	auto stream_ring()noexcept -> Stream_ring* {
+		return current_ring;
+	}
+
+	Stream_ring::Stream_ring(std::size_t segment_size, int frames)
+	    : _segment_size(segment_size), _frames(frames), _fences(frames, nullptr), _owners(frames) {
+
+		INVARIANT(!current_ring, "Only one stream ring is allowed per context");
+		INVARIANT(frames>=3, "The stream ring requires at least three frames");
+
+		auto size = static_cast<GLsizeiptr>(_segment_size*_frames);
+
+		glGenBuffers(1, &_id);
+		bind_array_buffer(_id);
+
+#ifdef EMSCRIPTEN
+		_mode = Mode::sub_data;
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+#else
+		if(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+			_mode = Mode::persistent;
+			auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+			_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+
+			if(!_mapped) {
+				WARN("Persistent mapping of the stream ring failed");
+				forget_buffer(_id);
+				glDeleteBuffers(1, &_id);
+				glGenBuffers(1, &_id);
+				bind_array_buffer(_id);
+			}
+		}
+
+		if(!_mapped) {
+			_mode = Mode::unsynchronized;
+			glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		}
+#endif
+
+		bind_array_buffer(0);
+
+		INFO("Created stream ring with "<<_frames<<"x"<<(_segment_size/1024)<<" KiB ("
+		     <<(_mode==Mode::persistent ? "persistent" : _mode==Mode::unsynchronized ? "unsynchronized" : "sub data")
+		     <<")");
+
+		current_ring = this;
+	}
+
+	Stream_ring::~Stream_ring()noexcept {
+		if(current_ring==this)
+			current_ring = nullptr;
+
+		for(auto f : _fences)
+			if(f)
+				glDeleteSync(to_sync(f));
+
+		if(_mapped) {
+			bind_array_buffer(_id);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			bind_array_buffer(0);
+		}
+
+		forget_buffer(_id);
+		glDeleteBuffers(1, &_id);
+	}
+
+	auto Stream_ring::upload(Buffer& owner, const void* data, std::size_t size) -> util::maybe<std::size_t> {
+		auto watch = util::Stopwatch{};
+
+		auto position = (_position + alignment-1) / alignment * alignment;
+		if(position+size > _segment_size) {
+			if(!_full_logged) {
+				WARN("Stream ring segment is full ("<<(_segment_size/1024)<<" KiB), falling back to buffer updates");
+				_full_logged = true;
+			}
+			return util::nothing();
+		}
+
+		auto offset = (_frame % _frames) * _segment_size + position;
+		_position = position + size;
+
+		switch(_mode) {
+			case Mode::persistent:
+				std::memcpy(_mapped+offset, data, size);
+				break;
+
+			case Mode::unsynchronized: {
+				bind_array_buffer(_id);
+				auto flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+				auto dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, flags);
+				if(dst) {
+					std::memcpy(dst, data, size);
+					glUnmapBuffer(GL_ARRAY_BUFFER);
+				} else {
+					glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+				}
+				break;
+			}
+
+			case Mode::sub_data:
+				bind_array_buffer(_id);
+				glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+				break;
+		}
+
+		auto& owners = _owners[_frame % _frames];
+		if(std::find(owners.begin(), owners.end(), &owner)==owners.end())
+			owners.push_back(&owner);
+
+		_stats.uploads++;
+		_stats.bytes += size;
+		_stats.ms += watch.ms();
+
+		return offset;
+	}
+
+	void Stream_ring::record_fallback(std::size_t size, float ms)noexcept {
+		_stats.uploads++;
+		_stats.fallbacks++;
+		_stats.bytes += size;
+		_stats.ms += ms;
+	}
+
+	void Stream_ring::forget(const Buffer& owner)noexcept {
+		for(auto& owners : _owners)
+			owners.erase(std::remove(owners.begin(), owners.end(), &owner), owners.end());
+	}
+	void Stream_ring::moved(const Buffer& from, Buffer& to)noexcept {
+		for(auto& owners : _owners)
+			std::replace(owners.begin(), owners.end(), const_cast<Buffer*>(&from), &to);
+	}
+
+	void Stream_ring::end_frame() {
+		// The segment that is reused after the next frame contains the data of buffers
+		//   that haven't been updated since (e.g. hidden text). It's copied into their
+		//   own buffers now, so the fence of this frame also covers the copies.
+		auto copied = false;
+		if(_frame+2 > static_cast<uint64_t>(_frames)) {
+			auto stale_frame = _frame+2 - _frames;
+			auto& owners = _owners[stale_frame % _frames];
+			for(auto b : owners) {
+				if(b->_stream_frame==stale_frame) {
+					b->_copy_back(*this);
+					copied = true;
+				}
+			}
+			owners.clear();
+		}
+
+		// glBufferSubData is ordered by the driver, fences are only required for mapped writes
+		if(_mode!=Mode::sub_data) {
+			auto& fence = _fences[_frame % _frames];
+			if(fence)
+				glDeleteSync(to_sync(fence));
+			fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+			// the stale segment may only be reused after the copies (i.e. this frame) are done
+			if(copied) {
+				auto& stale_fence = _fences[(_frame+2) % _frames];
+				if(stale_fence)
+					glDeleteSync(to_sync(stale_fence));
+				stale_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			}
+		}
+
+		_frame++;
+		_position = 0;
+
+		auto& next = _fences[_frame % _frames];
+		if(next) {
+			auto status = glClientWaitSync(to_sync(next), 0, 0);
+			if(status==GL_TIMEOUT_EXPIRED) {
+				_stats.stalls++;
+				constexpr auto timeout = GLuint64(1000*1000*1000);
+				status = glClientWaitSync(to_sync(next), GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+				if(status==GL_TIMEOUT_EXPIRED || status==GL_WAIT_FAILED)
+					WARN("Waiting for the stream ring segment failed");
+			}
+
+			glDeleteSync(to_sync(next));
+			next = nullptr;
+		}
+
+		_last_frame_stats = _stats;
+		_stats = Upload_stats{};
+	}
+
+}
+}
@@ -0,0 +1,104 @@
+/**************************************************************************\
+ * ring buffer for the data of dynamic vertex buffers                     *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include "../utils/maybe.hpp"
+#include "../utils/template_utils.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mo {
+namespace renderer {
+
+	class Buffer;
+
+	/// uploads of all dynamic buffers during one frame
+	struct Upload_stats {
+		std::size_t uploads = 0;
+		std::size_t bytes = 0;
+		std::size_t fallbacks = 0; //< uploads that didn't use the ring
+		std::size_t stalls = 0;    //< waits for the GPU to release a segment
+		float ms = 0;              //< CPU time spent in the uploads
+	};
+
+	/**
+	 * One large vertex buffer that contains the data of all dynamic buffers.
+	 * It is divided into one segment per frame in flight. The uploads of a frame
+	 *   are sub-allocated from its segment, which is guarded by a fence until
+	 *   the GPU has finished reading it.
+	 * The buffer is mapped persistently if ARB_buffer_storage is available and
+	 *   mapped unsynchronized for each upload otherwise. WebGL can't map buffers,
+	 *   so glBufferSubData is used there (but still without orphaning).
+	 * The data of buffers that haven't been updated since is copied into their
+	 *   own buffer, before the segment it has been uploaded to is reused.
+	 */
+	class Stream_ring : util::no_copy_move {
+		public:
+			/// segment_size in bytes; at least three frames, so data can be copied back
+			///   one frame before its segment is reused
+			Stream_ring(std::size_t segment_size, int frames=3);
+			~Stream_ring()noexcept;
+
+			/// copies the data of the buffer into the ring and returns its offset; nothing if the segment is full
+			auto upload(Buffer& owner, const void* data, std::size_t size) -> util::maybe<std::size_t>;
+
+			/// called by buffers that are destroyed or moved, so they are no longer copied back
+			void forget(const Buffer& owner)noexcept;
+			void moved(const Buffer& from, Buffer& to)noexcept;
+
+			/// called after the last draw of a frame; waits until the next segment can be reused
+			void end_frame();
+
+			/// true if the data uploaded in that frame hasn't been overwritten, yet
+			auto valid(uint64_t upload_frame)const noexcept {
+				return upload_frame + _frames > _frame;
+			}
+
+			auto id()const noexcept {return _id;}
+			auto frame()const noexcept {return _frame;}
+
+			/// uploads that bypassed the ring (e.g. because it was full)
+			void record_fallback(std::size_t size, float ms)noexcept;
+
+			auto last_frame_stats()const noexcept -> const Upload_stats& {return _last_frame_stats;}
+
+		private:
+			enum class Mode {persistent, unsynchronized, sub_data};
+
+			Mode _mode;
+			unsigned int _id = 0;
+			uint8_t* _mapped = nullptr;
+			const std::size_t _segment_size;
+			const int _frames;
+
+			uint64_t _frame = 1; //< serial number of the current frame
+			std::size_t _position = 0; //< in the segment of the current frame
+			std::vector<void*> _fences; //< one per segment
+			std::vector<std::vector<Buffer*>> _owners; //< buffers that uploaded into each segment
+
+			Upload_stats _stats;
+			Upload_stats _last_frame_stats;
+			bool _full_logged = false;
+	};
+
+	/// the ring used by all dynamic buffers; null if there is none (e.g. disabled in cfg:graphics)
+	extern auto stream_ring()noexcept -> Stream_ring*;
+
+}
+}
@@ -7,6 +7,10 @@
 
 #include <glm/gtx/rotate_vector.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
 
 namespace mo {
 namespace renderer {
@@ -18,6 +22,11 @@ namespace renderer {
 	};
 
 
+	namespace {
+		/// characters that have their own glyph index (the BMP)
+		constexpr Text_char max_indexed_char = 0xffff;
+	}
+
 	Font::Font(asset::Asset_manager& assets, std::istream& stream) {
 		std::string line;
 		std::getline(stream, line);
@@ -35,61 +44,112 @@ namespace renderer {
 		int symbols;
 		stream>>symbols;
 
+		// unknown characters are mapped to index 0, the first glyph
+		auto first_id = Text_char(0);
 		_glyphs.reserve(symbols);
 		for(auto i : util::range(symbols)) {
 			Text_char id = i;
 			stream>>id;
 
-			Glyph& g = _glyphs[id];
+			Glyph g;
 			stream>> g.x >> g.y >> g.width >> g.height >> g.offset_x >> g.offset_y >> g.advance;
+
+			if(id>max_indexed_char) {
+				WARN("Ignored glyph "<<id<<" outside of the BMP in font "<<line);
+				continue;
+			}
+
+			if(id>=_glyph_index.size())
+				_glyph_index.resize(id+1, 0);
+
+			if(_glyphs.empty())
+				first_id = id;
+
+			_glyph_index[id] = static_cast<uint16_t>(_glyphs.size());
+			_glyphs.push_back(g);
+			_max_advance = std::max(_max_advance, g.advance);
 		}
 
+		INVARIANT(!_glyphs.empty(), "Font "<<line<<" has no glyphs");
+
 		if(stream.good()) {
 			int kernings = 0;
 			stream>> kernings;
 
+			// (glyph index, prev, value)
+			auto pairs = std::vector<std::tuple<uint16_t, Text_char, int>>();
+			pairs.reserve(std::max(0, kernings));
+
 			for(auto i : util::range(kernings)) {
 				Text_char id=i, prev;
 				int val=0;
 				stream>> id >> prev >> val;
 
-				_glyphs[id].kerning[prev] = val;
+				if(id<_glyph_index.size() && (_glyph_index[id]!=0 || id==first_id))
+					pairs.emplace_back(_glyph_index[id], prev, val);
+			}
+
+			std::sort(pairs.begin(), pairs.end());
+
+			_kerning.reserve(pairs.size());
+			for(auto& p : pairs) {
+				auto& glyph = _glyphs[std::get<0>(p)];
+				if(glyph.kerning_begin==glyph.kerning_end)
+					glyph.kerning_begin = glyph.kerning_end = static_cast<uint32_t>(_kerning.size());
+
+				_kerning.push_back(Kerning_pair{std::get<1>(p), std::get<2>(p)});
+				glyph.kerning_end++;
 			}
 		}
 	}
+	Font::~Font()noexcept {
+		auto& stats = _cache.stats();
+		if(stats.misses>0)
+			DEBUG("Text cache: "<<stats.entries<<" texts, "<<(stats.bytes/1024.f)<<" KiB, "
+			      <<stats.hits<<" hits, "<<stats.misses<<" misses, "
+			      <<stats.evictions<<" evictions");
+	}
+
+	auto Font::kerning(const Glyph& glyph, Text_char prev)const noexcept -> int {
+		auto begin = _kerning.begin() + glyph.kerning_begin;
+		auto end = _kerning.begin() + glyph.kerning_end;
+
+		auto k = std::lower_bound(begin, end, prev, [](const Kerning_pair& p, Text_char c) {
+			return p.prev < c;
+		});
+
+		return k!=end && k->prev==prev ? k->value : 0;
+	}
 
 	using glm::vec2;
 
 	namespace {
-		void create_quad(std::vector<Font_vertex>& vertices,
+		/// writes the six vertices of a glyph
+		template<class Out>
+		void create_quad(Out out,
 		                float x, float y,
 		                float u, float v,
 		                float w, float h,
 		                float tw,float th) {
-			vertices.push_back({{x  ,y  },   {u    /tw, 1-(v  )/th}});
-			vertices.push_back({{x  ,(y+h)}, {u    /tw, 1-(v+h)/th}});
-			vertices.push_back({{x+w,y  },   {(u+w)/tw, 1-(v  )/th}});
+			*out++ = {{x  ,y  },   {u    /tw, 1-(v  )/th}};
+			*out++ = {{x  ,(y+h)}, {u    /tw, 1-(v+h)/th}};
+			*out++ = {{x+w,y  },   {(u+w)/tw, 1-(v  )/th}};
 
-			vertices.push_back({{x+w,(y+h)}, {(u+w)/tw, 1-(v+h)/th}});
-			vertices.push_back({{x+w,y  },   {(u+w)/tw, 1-(v  )/th}});
-			vertices.push_back({{x  ,(y+h)}, {u    /tw, 1-(v+h)/th}});
+			*out++ = {{x+w,(y+h)}, {(u+w)/tw, 1-(v+h)/th}};
+			*out++ = {{x+w,y  },   {(u+w)/tw, 1-(v  )/th}};
+			*out++ = {{x  ,(y+h)}, {u    /tw, 1-(v+h)/th}};
 		}
 
 		template<typename Func>
 		void parse(const std::string str, int height, int tex_width, int tex_height,
-		           const std::unordered_map<Text_char, Glyph>& glyphs, Func quad_callback, bool monospace=false) {
+		           const Font& font, int max_advance, Func quad_callback, bool monospace=false) {
 			glm::vec2 offset{0,-height};
 			Text_char prev = 0;
 
 			auto tw = tex_width;
 			auto th = tex_height;
 
-			int min_advance = 0;
-			if(monospace) {
-				for(auto& g : glyphs) {
-					min_advance = std::max(g.second.advance, min_advance);
-				}
-			}
+			int min_advance = monospace ? max_advance : 0;
 
 			auto add_glyph = [&](Text_char c) {
 				if(c=='\n') {
@@ -98,15 +158,10 @@ namespace renderer {
 					return;
 				}
 
-				auto g = glyphs.find(c);
-				if(g==glyphs.end())
-					g=glyphs.begin();
-
-				auto& glyph = g->second;
+				auto& glyph = font.glyph(c);
 
-				auto k = glyph.kerning.find(prev);
-				if(!monospace && k!=glyph.kerning.end())
-					offset.x+=k->second;
+				if(!monospace && glyph.kerning_begin!=glyph.kerning_end)
+					offset.x+=font.kerning(glyph, prev);
 
 				quad_callback(
 				            offset.x + glyph.offset_x,
@@ -172,27 +227,29 @@ namespace renderer {
 
 		vertices.reserve(str.length()*4);
 
-		parse(str, _height, _texture->width(), _texture->height(), _glyphs, [&](auto... args) {
-			create_quad(vertices, args...);
+		parse(str, _height, _texture->width(), _texture->height(), *this, _max_advance, [&](auto... args) {
+			create_quad(std::back_inserter(vertices), args...);
 		}, monospace);
 	}
 
 	auto Font::text(const std::string& str)const -> Text_ptr {
-		auto& entry =_cache[str];
-
-		if(entry)
-			return entry;
+		auto cached = _cache.find(str);
+		if(cached)
+			return cached;
 
 		std::vector<Font_vertex> vertices;
 		calculate_vertices(str, vertices);
 
-		return entry=std::make_shared<Text>(vertices);
+		auto text = std::make_shared<Text>(vertices);
+		_cache.insert(str, text, vertices.size()*sizeof(Font_vertex));
+
+		return text;
 	}
 
 	auto Font::calculate_size(const std::string& str)const -> glm::vec2 {
 		glm::vec2 top_left, bottom_right;
 
-		parse(str, _height, _texture->width(), _texture->height(), _glyphs, [&](
+		parse(str, _height, _texture->width(), _texture->height(), *this, _max_advance, [&](
 		      float x, float y,
 		      float u, float v,
               float w, float h,
@@ -241,10 +298,52 @@ namespace renderer {
 		_obj.draw();
 	}
 	void Text_dynamic::set(const std::string& str, bool monospace) {
+		_number.clear();
 		_data.clear();
 		_font->calculate_vertices(str, _data, monospace);
 		_obj.buffer().set(_data);
 
+		_update_size();
+	}
+	void Text_dynamic::set_number(int64_t value, int width) {
+		auto chars = std::to_string(value);
+		if(chars.size()<static_cast<std::size_t>(width))
+			chars.insert(0, width-chars.size(), ' ');
+
+		if(chars==_number)
+			return;
+
+		auto& font = *_font;
+		auto tw = static_cast<float>(font._texture->width());
+		auto th = static_cast<float>(font._texture->height());
+
+		// every character gets a cell of the same width, so they can be replaced independently
+		auto cell = 0;
+		for(auto c : std::string("0123456789- "))
+			cell = std::max(cell, font.glyph(static_cast<Text_char>(c)).advance);
+
+		auto relayout = chars.size()!=_number.size();
+		if(relayout)
+			_data.assign(chars.size()*6, Font_vertex{{0,0}, {0,0}});
+
+		for(auto i=0u; i<chars.size(); ++i) {
+			if(!relayout && chars[i]==_number[i])
+				continue;
+
+			auto& glyph = font.glyph(static_cast<Text_char>(chars[i]));
+			create_quad(_data.begin() + i*6,
+			            static_cast<float>(static_cast<int>(i)*cell + glyph.offset_x),
+			            static_cast<float>(-font._height + glyph.offset_y),
+			            glyph.x, glyph.y, glyph.width, glyph.height,
+			            tw, th);
+		}
+
+		_obj.buffer().set(_data);
+		_number = std::move(chars);
+
+		_update_size();
+	}
+	void Text_dynamic::_update_size() {
 		glm::vec2 top_left, bottom_right;
 		for(auto& v : _data) {
 			if(v.xy.x<top_left.x) top_left.x=v.xy.x;
@@ -19,6 +19,7 @@
 #include "texture.hpp"
 #include "vertex_object.hpp"
 #include "shader.hpp"
+#include "text_cache.hpp"
 
 namespace mo {
 namespace renderer {
@@ -28,11 +29,6 @@ namespace renderer {
 
 	using Text_char = uint32_t;
 
-	struct Font_vertex {
-		glm::vec2 xy;
-		glm::vec2 uv;
-		Font_vertex(glm::vec2 xy, glm::vec2 uv) : xy(xy), uv(uv) {}
-	};
 	extern Vertex_layout text_vertex_layout;
 
 	struct Glyph {
@@ -43,7 +39,13 @@ namespace renderer {
 		int offset_x = 0;
 		int offset_y = 0;
 		int advance = 0;
-		std::unordered_map<Text_char, int> kerning;
+		uint32_t kerning_begin = 0; //< range of the pairs in Font::_kerning that end with this glyph
+		uint32_t kerning_end = 0;
+	};
+
+	struct Kerning_pair {
+		Text_char prev;
+		int value;
 	};
 
 	/*
@@ -61,11 +63,21 @@ namespace renderer {
 	class Font {
 		public:
 			Font(asset::Asset_manager& assets, std::istream&);
+			~Font()noexcept;
 
+			/// cached; the least recently used texts are dropped if the cache exceeds its budget
 			auto text(const std::string& str)const -> Text_ptr;
 			auto calculate_size(const std::string& str)const -> glm::vec2;
 			void bind()const;
 
+			/// glyph of a character; the first glyph of the font if it has none
+			auto glyph(Text_char c)const noexcept -> const Glyph& {
+				return c<_glyph_index.size() ? _glyphs[_glyph_index[c]] : _glyphs.front();
+			}
+			auto kerning(const Glyph& glyph, Text_char prev)const noexcept -> int;
+
+			auto cache_stats()const noexcept -> const Text_cache_stats& {return _cache.stats();}
+
 		private:
 			friend class Text;
 			friend class Text_dynamic;
@@ -74,10 +86,14 @@ namespace renderer {
 
 			int _height = 0;
 			int _line_height = 0;
+			int _max_advance = 0;
 			Texture_ptr _texture;
-			std::unordered_map<Text_char, Glyph> _glyphs;
 
-			mutable std::unordered_map<std::string, Text_ptr> _cache;
+			std::vector<Glyph> _glyphs;          //< in the order of the font file
+			std::vector<uint16_t> _glyph_index;  //< characters of the BMP to _glyphs
+			std::vector<Kerning_pair> _kerning;  //< grouped by glyph, sorted by prev
+
+			mutable Text_cache<Text> _cache;
 	};
 	using Font_ptr = asset::Ptr<Font>;
 
@@ -101,13 +117,25 @@ namespace renderer {
 			void draw()const;
 			void set(const std::string& str, bool monospace=false);
 
+			/**
+			 * Right aligned in a field of width characters (like std::setw), with
+			 *   the same advance for every character. Only the characters that
+			 *   changed since the last call are updated; nothing is uploaded if
+			 *   the value is the same.
+			 */
+			void set_number(int64_t value, int width);
+
 			auto size()const noexcept {return _size;}
 
 		protected:
+			void _update_size();
+
 			Font_ptr _font;
 			std::vector<Font_vertex> _data;
 			Object _obj;
 			glm::vec2 _size;
+
+			std::string _number; //< characters of the last set_number; empty after set()
 	};
 
 
@@ -0,0 +1,106 @@
+/**************************************************************************\
+ * LRU cache of laid out texts                                            *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace mo {
+namespace renderer {
+
+	struct Font_vertex {
+		glm::vec2 xy;
+		glm::vec2 uv;
+		Font_vertex(glm::vec2 xy, glm::vec2 uv) : xy(xy), uv(uv) {}
+	};
+
+	/// vertices (and keys) of the cached texts of one font
+	constexpr std::size_t text_cache_budget = 256 * 1024;
+
+	struct Text_cache_stats {
+		std::size_t entries = 0;
+		std::size_t bytes = 0; //< vertices and keys of the cached texts
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+	};
+
+	/**
+	 * Texts by their string; the least recently used ones are dropped if the
+	 *   cache exceeds its budget (the most recent one is always kept).
+	 *   Doesn't depend on OpenGL, so it can be measured by the render_bench.
+	 */
+	template<class T>
+	class Text_cache {
+		public:
+			Text_cache(std::size_t budget=text_cache_budget) : _budget(budget) {}
+
+			/// the cached text or nullptr
+			auto find(const std::string& str) -> std::shared_ptr<const T> {
+				auto iter = _index.find(str);
+				if(iter==_index.end()) {
+					_stats.misses++;
+					return {};
+				}
+
+				_entries.splice(_entries.begin(), _entries, iter->second);
+				_stats.hits++;
+				return iter->second->text;
+			}
+
+			/// vertex_bytes: size of the vertices of the text
+			void insert(const std::string& str, std::shared_ptr<const T> text, std::size_t vertex_bytes) {
+				// the key is stored in the list and the index
+				auto bytes = vertex_bytes + 2*str.size();
+				_entries.push_front(Entry{str, std::move(text), bytes});
+				_index.emplace(str, _entries.begin());
+				_stats.entries++;
+				_stats.bytes += bytes;
+
+				while(_stats.bytes>_budget && _entries.size()>1) {
+					auto& last = _entries.back();
+					_stats.bytes -= last.bytes;
+					_stats.entries--;
+					_stats.evictions++;
+
+					_index.erase(last.str);
+					_entries.pop_back();
+				}
+			}
+
+			auto stats()const noexcept -> const Text_cache_stats& {return _stats;}
+
+		private:
+			struct Entry {
+				std::string str;
+				std::shared_ptr<const T> text;
+				std::size_t bytes;
+			};
+
+			std::size_t _budget;
+			std::list<Entry> _entries; //< most recently used first
+			std::unordered_map<std::string, typename std::list<Entry>::iterator> _index;
+			Text_cache_stats _stats;
+	};
+
+}
+}
@@ -1,9 +1,14 @@
 #include "texture.hpp"
 
+#include "gl_state.hpp"
+#include "texture_loader.hpp"
+
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <soil/SOIL.h>
 
+#include <algorithm>
+
 namespace mo {
 namespace renderer {
 
@@ -18,15 +23,18 @@ namespace renderer {
 			&_height
 		);
 
+		// SOIL binds textures behind our back
+		invalidate_gl_state();
+
 		if(!_handle)
 			throw Texture_loading_failed(SOIL_last_result());
 
-		glBindTexture(GL_TEXTURE_2D, _handle);
+		bind_texture(0, _handle);
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		bind_texture(0, 0);
 	}
 	Texture::Texture(std::vector<uint8_t> buffer) {
 		_handle = SOIL_load_OGL_texture_from_memory
@@ -40,20 +48,23 @@ namespace renderer {
 			&_height
 		);
 
+		// SOIL binds textures behind our back
+		invalidate_gl_state();
+
 		if(!_handle)
 			throw Texture_loading_failed(SOIL_last_result());
 
-		glBindTexture(GL_TEXTURE_2D, _handle);
+		bind_texture(0, _handle);
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		bind_texture(0, 0);
 	}
 
 	Texture::Texture(int width, int height) : _width(width), _height(height) {
 		glGenTextures( 1, &_handle );
-		glBindTexture( GL_TEXTURE_2D, _handle );
+		bind_texture(0, _handle);
 		glTexImage2D(GL_TEXTURE_2D, 0,GL_RGBA, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
@@ -66,7 +77,7 @@ namespace renderer {
 	Texture::Texture(int width, int height, std::vector<uint8_t> rgbaData) : _width(width), _height(height) {
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 		glGenTextures( 1, &_handle );
-		glBindTexture( GL_TEXTURE_2D, _handle );
+		bind_texture(0, _handle);
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -75,47 +86,108 @@ namespace renderer {
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
 					 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaData.data());
 	}
+	Texture::Texture(int width, int height, std::future<Texture_pixels> pixels)
+	    : _width(width), _height(height), _pending(std::move(pixels)) {
+		glGenTextures(1, &_handle);
+		bind_texture(0, _handle);
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		bind_texture(0, 0);
+	}
 	Texture::~Texture()noexcept {
-		if(_handle!=0)
+		if(_handle!=0) {
+			forget_texture(_handle);
 			glDeleteTextures(1, &_handle);
+		}
 	}
 
 	Texture::Texture(Texture&& s)noexcept
-		: _handle(s._handle), _width(s._width), _height(s._width) {
+		: _handle(s._handle), _width(s._width), _height(s._height), _pending(std::move(s._pending)) {
 		s._handle = 0;
 	}
 	Texture& Texture::operator=(Texture&& s)noexcept {
-		if(_handle!=0)
+		if(_handle!=0) {
+			forget_texture(_handle);
 			glDeleteTextures(1, &_handle);
+		}
 
 		_handle = s._handle;
 		s._handle = 0;
 
 		_width = s._width;
 		_height = s._height;
+		_pending = std::move(s._pending);
 
 		return *this;
 	}
 
 
+	bool Texture::finish_upload(bool wait)const {
+		if(!_pending.valid())
+			return true;
+
+		if(!wait && _pending.wait_for(std::chrono::seconds(0))!=std::future_status::ready)
+			return false;
+
+		auto pixels = _pending.get();
+		if(pixels.data.empty()) {
+			WARN("Couldn't decode texture "<<pixels.error<<"; using a transparent pixel instead");
+			pixels = Texture_pixels{};
+			pixels.width = pixels.height = 1;
+			pixels.data.assign(4, 0);
+		}
+
+		if(pixels.width!=_width || pixels.height!=_height)
+			WARN("Size of decoded texture doesn't match its header: "<<pixels.width<<"x"<<pixels.height
+			     <<" instead of "<<_width<<"x"<<_height);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		bind_texture(0, _handle);
+
+		auto data = pixels.data.data();
+		for(auto level=0; level<pixels.levels; ++level) {
+			auto width  = std::max(1, pixels.width>>level);
+			auto height = std::max(1, pixels.height>>level);
+			auto size   = pixels.level_size(level);
+
+			if(pixels.format==Texture_format::dxt5)
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+				                       width, height, 0, static_cast<GLsizei>(size), data);
+			else
+				glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height,
+				             0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+			data += size;
+		}
+
+		if(pixels.levels>1) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pixels.levels-1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+
+		bind_texture(0, 0);
+
+		return true;
+	}
+
 	void Texture::bind(int index)const {
-		auto tex = GL_TEXTURE0+index;
-		INVARIANT(tex<GL_TEXTURE8, "to many textures");
-		glActiveTexture(tex);
-		glBindTexture(GL_TEXTURE_2D, _handle);
+		// used before the loader uploaded it
+		if(_pending.valid())
+			finish_upload(true);
+
+		bind_texture(index, _handle);
 	}
 	void Texture::unbind(int index)const {
-		auto tex = GL_TEXTURE0+index;
-		INVARIANT(tex<GL_TEXTURE8, "to many textures");
-		glActiveTexture(tex);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		bind_texture(index, 0);
 	}
 
 	Framebuffer::Framebuffer(int width, int height, bool depth_buffer)
 		: Texture(width, height), _fb_handle(0), _db_handle(0) {
 
 		glGenFramebuffers(1, &_fb_handle);
-		glBindFramebuffer(GL_FRAMEBUFFER, _fb_handle);
+		bind_framebuffer(_fb_handle);
 
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _handle, 0);
 
@@ -129,7 +201,7 @@ namespace renderer {
 
 		INVARIANT(glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE, "Couldn't create framebuffer!");
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		bind_framebuffer(0);
 	}
 	Framebuffer::Framebuffer(Framebuffer&& rhs)noexcept
 		: Texture(std::move(rhs)), _fb_handle(rhs._fb_handle), _db_handle(rhs._db_handle) {
@@ -138,15 +210,19 @@ namespace renderer {
 		rhs._db_handle = 0;
 	}
 	Framebuffer::~Framebuffer()noexcept {
-		if(_fb_handle)
+		if(_fb_handle) {
+			forget_framebuffer(_fb_handle);
 			glDeleteFramebuffers(1, &_fb_handle);
+		}
 
 		if(_db_handle)
 			glDeleteRenderbuffers(1, &_db_handle);
 	}
 	Framebuffer& Framebuffer::operator=(Framebuffer&& rhs)noexcept {
-		if(_fb_handle)
+		if(_fb_handle) {
+			forget_framebuffer(_fb_handle);
 			glDeleteFramebuffers(1, &_fb_handle);
+		}
 
 		if(_db_handle)
 			glDeleteRenderbuffers(1, &_db_handle);
@@ -163,7 +239,7 @@ namespace renderer {
 	}
 
 	void Framebuffer::set_viewport() {
-		glViewport(0,0, width(), height());
+		renderer::set_viewport({0,0, width(), height()});
 	}
 
 	void Framebuffer::clear(glm::vec3 color) {
@@ -172,21 +248,35 @@ namespace renderer {
 	}
 
 	void Framebuffer::bind_target() {
-		glBindFramebuffer(GL_FRAMEBUFFER, _fb_handle);
-		glViewport(0,0, width(), height());
+		bind_framebuffer(_fb_handle);
+		set_viewport();
 	}
 	void Framebuffer::unbind_target() {
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		bind_framebuffer(0);
 	}
 
-	Framebuffer_binder::Framebuffer_binder(Framebuffer& fb) : fb(fb) {
-		glGetIntegerv(GL_VIEWPORT, old_viewport);
+	Framebuffer_binder::Framebuffer_binder(Framebuffer& fb)
+	    : fb(fb), old_viewport(current_viewport()) {
 		fb.bind_target();
 	}
 	Framebuffer_binder::~Framebuffer_binder()noexcept {
 		fb.unbind_target();
-		glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
+		set_viewport(old_viewport);
 	}
 
 } /* namespace renderer */
+
+namespace asset {
+	auto Loader<renderer::Texture>::load(istream in) -> RT {
+		auto data = in.bytes();
+
+		if(auto loader = renderer::texture_loader()) {
+			auto texture = loader->load(data, in.aid());
+			if(texture.is_some())
+				return texture.get_or_throw();
+		}
+
+		return std::make_shared<renderer::Texture>(std::move(data));
+	}
+}
 }
@@ -17,8 +17,12 @@
 
 #include <string>
 #include <vector>
+#include <future>
 #include <stdexcept>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "texture_cache.hpp"
 
 #include "../utils/log.hpp"
 #include "../asset/asset_manager.hpp"
@@ -35,6 +39,8 @@ namespace renderer {
 			explicit Texture(const std::string& path);
 			explicit Texture(std::vector<uint8_t> buffer);
 			Texture(int width, int height, std::vector<uint8_t> rgba_data);
+			/// the pixels are uploaded when they are ready (see Texture_loader) or on the first bind
+			Texture(int width, int height, std::future<Texture_pixels> pixels);
 			virtual ~Texture()noexcept;
 
 			Texture& operator=(Texture&&)noexcept;
@@ -46,6 +52,15 @@ namespace renderer {
 			auto width()const noexcept {return _width;}
 			auto height()const noexcept {return _height;}
 
+			/// unique while the texture exists (unlike its address, independent of the allocator)
+			auto id()const noexcept {return _handle;}
+
+			/// false until the asynchronously decoded pixels have been uploaded
+			auto ready()const noexcept {return !_pending.valid();}
+
+			/// uploads the decoded pixels; if wait is false, only if they are already available
+			bool finish_upload(bool wait=true)const;
+
 			Texture(const Texture&) = delete;
 			Texture& operator=(const Texture&) = delete;
 
@@ -54,6 +69,7 @@ namespace renderer {
 
 			unsigned int _handle;
 			int _width=1, _height=1;
+			mutable std::future<Texture_pixels> _pending;
 	};
 	using Texture_ptr = asset::Ptr<Texture>;
 
@@ -82,7 +98,7 @@ namespace renderer {
 		~Framebuffer_binder()noexcept;
 
 		Framebuffer& fb;
-		int old_viewport[4];
+		glm::ivec4 old_viewport;
 	};
 
 	struct Texture_binder {
@@ -105,9 +121,8 @@ namespace asset {
 	struct Loader<renderer::Texture> {
 		using RT = std::shared_ptr<renderer::Texture>;
 
-		static RT load(istream in) {
-			return std::make_shared<renderer::Texture>(in.bytes());
-		}
+		/// decoded by the Texture_loader if there is one
+		static RT load(istream in);
 
 		static void store(ostream out, const renderer::Texture& asset) {
 			// TODO
@@ -0,0 +1,85 @@
+#include "texture_atlas.hpp"
+
+#include "../utils/log.hpp"
+
+namespace mo {
+namespace renderer {
+
+	const asset::AID texture_atlas_aid {asset::Asset_type::cfg, "texture_atlas"};
+
+	Texture_atlas::Texture_atlas(asset::Asset_manager& assets, const Atlas_data& data)
+	    : _page_count(data.pages.size()) {
+
+		for(auto& page : data.pages) {
+			auto page_tex = assets.load<Texture>(page.texture);
+
+			for(auto& entry : page.entries) {
+				_regions[entry.texture] = Atlas_region{page_tex, atlas_uv_rect(page, entry),
+				                                       {entry.width, entry.height}};
+			}
+		}
+
+		DEBUG("Loaded texture atlas with "<<_regions.size()<<" textures on "<<_page_count<<" pages");
+	}
+
+	Texture_atlas& Texture_atlas::operator=(Texture_atlas&& rhs) {
+		// textures that have been removed keep their old region until the restart
+		for(auto& r : rhs._regions)
+			_regions[r.first] = std::move(r.second);
+
+		_page_count = rhs._page_count;
+		return *this;
+	}
+
+	auto Texture_atlas::region(const asset::AID& texture)const -> util::maybe<const Atlas_region&> {
+		auto iter = _regions.find(texture);
+		if(iter==_regions.end())
+			return util::nothing();
+
+		return util::justPtr(&iter->second);
+	}
+
+
+	Atlas_texture::Atlas_texture(asset::Asset_manager& assets, const asset::AID& texture) {
+		auto atlas = assets.load_maybe<Texture_atlas>(texture_atlas_aid);
+		if(atlas.is_some()) {
+			auto region = atlas.get_or_throw()->region(texture);
+			if(region.is_some()) {
+				_atlas = atlas.get_or_throw();
+				_region = &region.get_or_throw();
+				return;
+			}
+		}
+
+		_texture = assets.load<Texture>(texture);
+	}
+
+	auto Atlas_texture::texture()const -> const Texture& {
+		return _region ? *_region->page : *_texture;
+	}
+	auto Atlas_texture::texture_ptr()const -> Texture_ptr {
+		return _region ? _region->page : _texture;
+	}
+
+	auto Atlas_texture::uv_rect()const noexcept -> glm::vec4 {
+		return _region ? _region->uv_rect : glm::vec4{0,0,1,1};
+	}
+	auto Atlas_texture::remap(glm::vec4 uv)const noexcept -> glm::vec4 {
+		if(!_region)
+			return uv;
+
+		auto& r = _region->uv_rect;
+		auto scale = glm::vec2{r.z-r.x, r.w-r.y};
+		return glm::vec4{r.x + uv.x*scale.x, r.y + uv.y*scale.y,
+		                 r.x + uv.z*scale.x, r.y + uv.w*scale.y};
+	}
+
+	auto Atlas_texture::width()const -> int {
+		return _region ? _region->size.x : _texture->width();
+	}
+	auto Atlas_texture::height()const -> int {
+		return _region ? _region->size.y : _texture->height();
+	}
+
+}
+}
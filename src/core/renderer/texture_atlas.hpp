@@ -0,0 +1,110 @@
+/**************************************************************************\
+ * lookup of textures that have been packed into atlas pages              *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include "texture.hpp"
+#include "texture_atlas_data.hpp"
+
+#include "../asset/asset_manager.hpp"
+#include "../utils/maybe.hpp"
+
+#include <glm/glm.hpp>
+
+#include <unordered_map>
+
+namespace mo {
+namespace renderer {
+
+	/// the part of an atlas page that contains a packed texture
+	struct Atlas_region {
+		Texture_ptr page;
+		glm::vec4 uv_rect {0,0,1,1};
+		glm::ivec2 size;             //< of the original texture in pixels
+	};
+
+	/**
+	 * Mapping from the AIDs of the packed textures to their region on the atlas
+	 *   pages (generated by the atlas_builder tool).
+	 * The regions keep their addresses when the atlas is reloaded, so they can
+	 *   be referenced for the lifetime of the atlas.
+	 */
+	class Texture_atlas {
+		public:
+			Texture_atlas(asset::Asset_manager& assets, const Atlas_data& data);
+			Texture_atlas(Texture_atlas&&) = default;
+
+			/// updates the existing regions in place
+			Texture_atlas& operator=(Texture_atlas&&);
+
+			auto region(const asset::AID& texture)const -> util::maybe<const Atlas_region&>;
+
+			auto page_count()const noexcept {return _page_count;}
+
+		private:
+			std::unordered_map<asset::AID, Atlas_region> _regions;
+			std::size_t _page_count;
+	};
+
+	extern const asset::AID texture_atlas_aid;
+
+	/**
+	 * A texture that has either been packed into an atlas page or is used as is.
+	 * Texture coordinates relative to the original texture have to be passed
+	 *   through remap() before they are used with texture().
+	 */
+	class Atlas_texture {
+		public:
+			Atlas_texture() = default;
+			Atlas_texture(asset::Asset_manager& assets, const asset::AID& texture);
+
+			/// the page containing the texture or the texture itself
+			auto texture()const -> const Texture&;
+			auto texture_ptr()const -> Texture_ptr;
+
+			auto uv_rect()const noexcept -> glm::vec4;
+			auto remap(glm::vec4 uv)const noexcept -> glm::vec4;
+
+			auto width()const -> int;
+			auto height()const -> int;
+
+			auto packed()const noexcept {return _region!=nullptr;}
+			operator bool()const noexcept {return _region || _texture;}
+
+		private:
+			asset::Ptr<Texture_atlas> _atlas;
+			const Atlas_region* _region = nullptr;
+			Texture_ptr _texture;
+	};
+
+}
+
+namespace asset {
+	template<>
+	struct Loader<renderer::Texture_atlas> {
+		using RT = std::shared_ptr<renderer::Texture_atlas>;
+
+		static RT load(istream in) {
+			auto data = renderer::load_atlas_data(in);
+			return std::make_shared<renderer::Texture_atlas>(in.manager(), data);
+		}
+
+		static void store(ostream out, const renderer::Texture_atlas& asset) {
+			FAIL("NOT IMPLEMENTED! Texture atlases are generated by the atlas_builder.");
+		}
+	};
+}
+}
@@ -0,0 +1,54 @@
+#include "texture_atlas_data.hpp"
+
+#include "../utils/log.hpp"
+
+#include <sf2/sf2.hpp>
+
+namespace mo {
+namespace renderer {
+
+	sf2_structDef(Atlas_entry_data,
+		texture,
+		x,
+		y,
+		width,
+		height,
+		hash
+	)
+
+	sf2_structDef(Atlas_page_data,
+		texture,
+		width,
+		height,
+		entries
+	)
+
+	sf2_structDef(Atlas_data,
+		pages
+	)
+
+	auto load_atlas_data(std::istream& in) -> Atlas_data {
+		auto data = Atlas_data{};
+		sf2::deserialize_json(in, [&](auto& msg, uint32_t row, uint32_t column) {
+			ERROR("Error parsing texture atlas at "<<row<<":"<<column<<": "<<msg);
+		}, data);
+
+		return data;
+	}
+
+	void store_atlas_data(std::ostream& out, const Atlas_data& data) {
+		sf2::serialize_json(out, data);
+	}
+
+	auto atlas_uv_rect(const Atlas_page_data& page, const Atlas_entry_data& entry)noexcept -> glm::vec4 {
+		auto w = static_cast<float>(page.width);
+		auto h = static_cast<float>(page.height);
+
+		return glm::vec4{entry.x / w,
+		                 (page.height - entry.y - entry.height) / h,
+		                 (entry.x + entry.width) / w,
+		                 (page.height - entry.y) / h};
+	}
+
+}
+}
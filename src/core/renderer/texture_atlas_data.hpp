@@ -0,0 +1,56 @@
+/**************************************************************************\
+ * layout of the texture atlas pages (shared with the atlas_builder)      *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace mo {
+namespace renderer {
+
+	/// position of a packed texture on its page, in pixels from the top-left corner of the page
+	struct Atlas_entry_data {
+		std::string texture; //< AID of the original texture
+		int x=0, y=0;
+		int width=0, height=0;
+		std::string hash;    //< of the decoded pixels, to detect changed textures
+	};
+
+	struct Atlas_page_data {
+		std::string texture; //< AID of the page
+		int width=0, height=0;
+		std::vector<Atlas_entry_data> entries;
+	};
+
+	struct Atlas_data {
+		std::vector<Atlas_page_data> pages;
+	};
+
+	extern auto load_atlas_data(std::istream& in) -> Atlas_data;
+	extern void store_atlas_data(std::ostream& out, const Atlas_data& data);
+
+	/**
+	 * Texture coordinates of the entry on its page (min u, min v, max u, max v).
+	 * Like all our textures the page is flipped on load, so v grows from the bottom.
+	 */
+	extern auto atlas_uv_rect(const Atlas_page_data& page, const Atlas_entry_data& entry)noexcept -> glm::vec4;
+
+}
+}
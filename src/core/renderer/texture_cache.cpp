@@ -0,0 +1,216 @@
+#include "texture_cache.hpp"
+
+#include "../utils/log.hpp"
+
+#include <soil/stb_image_aug.h>
+extern "C" {
+	#include <soil/image_DXT.h>
+}
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace mo {
+namespace renderer {
+
+	namespace {
+		/// bumped when the file format or the decoding changes
+		constexpr uint32_t cache_version = 1;
+		constexpr uint32_t cache_magic = 0x58544f4d; // "MOTX"
+
+		struct Cache_header {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t source_hash;
+			uint32_t format;
+			int32_t width;
+			int32_t height;
+			int32_t levels;
+		};
+
+		class Fnv1a {
+			public:
+				void add(const uint8_t* data, std::size_t size)noexcept {
+					for(auto i=0u; i<size; ++i) {
+						_hash ^= data[i];
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				void add(uint64_t v)noexcept {
+					for(auto i=0; i<8; ++i, v>>=8) {
+						_hash ^= v & 0xff;
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				auto value()const noexcept {return _hash;}
+
+			private:
+				uint64_t _hash = 0xcbf29ce484222325ull;
+		};
+
+		auto levels_size(const Texture_pixels& pixels) {
+			auto size = std::size_t(0);
+			for(auto level=0; level<pixels.levels; ++level)
+				size += pixels.level_size(level);
+
+			return size;
+		}
+	}
+
+	auto Texture_pixels::level_size(int level)const noexcept -> std::size_t {
+		auto w = static_cast<std::size_t>(std::max(1, width>>level));
+		auto h = static_cast<std::size_t>(std::max(1, height>>level));
+
+		switch(format) {
+			case Texture_format::rgba: return w*h*4;
+			case Texture_format::dxt5: return ((w+3)/4) * ((h+3)/4) * 16;
+		}
+
+		return 0;
+	}
+
+	auto texture_cache_hash(const std::vector<uint8_t>& data,
+	                        const Texture_cache_settings& settings) -> uint64_t {
+		auto hash = Fnv1a{};
+		hash.add(cache_version);
+		hash.add(uint64_t(settings.mipmaps));
+		hash.add(uint64_t(settings.compression));
+		hash.add(data.data(), data.size());
+		return hash.value();
+	}
+
+	auto decode_texture(const std::vector<uint8_t>& data, const std::string& name) -> Texture_pixels {
+		auto pixels = Texture_pixels{};
+
+		auto channels = 0;
+		auto img = stbi_load_from_memory(data.data(), static_cast<int>(data.size()),
+		                                 &pixels.width, &pixels.height, &channels, 4);
+		if(!img) {
+			// stbi_failure_reason() is shared by all threads
+			pixels.error = name;
+			return pixels;
+		}
+
+		auto row_size = static_cast<std::size_t>(pixels.width) * 4;
+		pixels.data.resize(row_size * pixels.height);
+
+		for(auto y=0; y<pixels.height; ++y) {
+			auto src = img + row_size*(pixels.height-1-y);
+			auto dst = pixels.data.data() + row_size*y;
+
+			for(auto x=0u; x<row_size; x+=4) {
+				auto a = src[x+3];
+				dst[x  ] = static_cast<uint8_t>((src[x  ]*a + 128) >> 8);
+				dst[x+1] = static_cast<uint8_t>((src[x+1]*a + 128) >> 8);
+				dst[x+2] = static_cast<uint8_t>((src[x+2]*a + 128) >> 8);
+				dst[x+3] = a;
+			}
+		}
+
+		stbi_image_free(img);
+
+		return pixels;
+	}
+
+	// the pixels are premultiplied, so box filtering them is correct
+	void generate_mipmaps(Texture_pixels& pixels) {
+		auto w = pixels.width;
+		auto h = pixels.height;
+		auto offset = std::size_t(0);
+
+		while(w>1 || h>1) {
+			auto nw = std::max(1, w/2);
+			auto nh = std::max(1, h/2);
+
+			auto next_offset = pixels.data.size();
+			pixels.data.resize(next_offset + std::size_t(nw)*nh*4);
+
+			auto src = pixels.data.data() + offset;
+			auto dst = pixels.data.data() + next_offset;
+
+			for(auto y=0; y<nh; ++y) {
+				auto y0 = std::min(y*2, h-1);
+				auto y1 = std::min(y*2+1, h-1);
+
+				for(auto x=0; x<nw; ++x) {
+					auto x0 = std::min(x*2, w-1);
+					auto x1 = std::min(x*2+1, w-1);
+
+					for(auto c=0; c<4; ++c) {
+						auto sum = src[(y0*w+x0)*4+c] + src[(y0*w+x1)*4+c]
+						         + src[(y1*w+x0)*4+c] + src[(y1*w+x1)*4+c];
+						dst[(y*nw+x)*4+c] = static_cast<uint8_t>((sum+2) / 4);
+					}
+				}
+			}
+
+			offset = next_offset;
+			w = nw;
+			h = nh;
+			pixels.levels++;
+		}
+	}
+
+	void compress_texture(Texture_pixels& pixels) {
+		auto compressed = std::vector<uint8_t>();
+		auto src = pixels.data.data();
+
+		for(auto level=0; level<pixels.levels; ++level) {
+			auto w = std::max(1, pixels.width>>level);
+			auto h = std::max(1, pixels.height>>level);
+
+			auto size = 0;
+			auto blocks = convert_image_to_DXT5(src, w, h, 4, &size);
+			if(!blocks) {
+				WARN("DXT5 compression failed for "<<w<<"x"<<h<<" level; keeping RGBA");
+				return;
+			}
+
+			compressed.insert(compressed.end(), blocks, blocks+size);
+			std::free(blocks);
+
+			src += pixels.level_size(level);
+		}
+
+		pixels.format = Texture_format::dxt5;
+		pixels.data = std::move(compressed);
+	}
+
+	auto read_texture_cache(const uint8_t* data, std::size_t size, uint64_t hash,
+	                        Texture_pixels& pixels) -> bool {
+		if(size<sizeof(Cache_header))
+			return false;
+
+		auto header = Cache_header{};
+		std::memcpy(&header, data, sizeof(header));
+		if(header.magic!=cache_magic || header.version!=cache_version || header.source_hash!=hash
+		        || header.format>static_cast<uint32_t>(Texture_format::dxt5)
+		        || header.width<=0 || header.height<=0 || header.levels<=0 || header.levels>32)
+			return false;
+
+		pixels.width = header.width;
+		pixels.height = header.height;
+		pixels.levels = header.levels;
+		pixels.format = static_cast<Texture_format>(header.format);
+
+		if(size!=sizeof(header)+levels_size(pixels))
+			return false;
+
+		pixels.data.assign(data+sizeof(header), data+size);
+		return true;
+	}
+
+	auto write_texture_cache(uint64_t hash, const Texture_pixels& pixels) -> std::vector<uint8_t> {
+		auto header = Cache_header{cache_magic, cache_version, hash,
+		                           static_cast<uint32_t>(pixels.format),
+		                           pixels.width, pixels.height, pixels.levels};
+
+		auto entry = std::vector<uint8_t>(sizeof(header) + pixels.data.size());
+		std::memcpy(entry.data(), &header, sizeof(header));
+		std::memcpy(entry.data()+sizeof(header), pixels.data.data(), pixels.data.size());
+		return entry;
+	}
+
+}
+}
@@ -0,0 +1,69 @@
+/**************************************************************************\
+ * CPU-side decoding and cache format of textures                         *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mo {
+namespace renderer {
+
+	enum class Texture_format : uint32_t {
+		rgba, //< 4 bytes per pixel
+		dxt5  //< 16 bytes per 4x4 block (EXT_texture_compression_s3tc)
+	};
+
+	/// decoded pixels (premultiplied alpha, bottom row first); empty if decoding failed
+	struct Texture_pixels {
+		std::vector<uint8_t> data; //< all mip levels, largest first
+		int width = 0;
+		int height = 0;
+		int levels = 1;
+		Texture_format format = Texture_format::rgba;
+		std::string error; //< set if decoding failed
+
+		/// in bytes
+		auto level_size(int level)const noexcept -> std::size_t;
+	};
+
+	struct Texture_cache_settings {
+		bool enabled = true;      //< store decoded textures in the write directory
+		bool mipmaps = false;     //< store (and use) a full mip chain
+		bool compression = false; //< store DXT5 blocks instead of RGBA, if supported
+	};
+
+	/// decodes a PNG; same result as SOIL_FLAG_INVERT_Y | SOIL_FLAG_MULTIPLY_ALPHA
+	extern auto decode_texture(const std::vector<uint8_t>& png, const std::string& name) -> Texture_pixels;
+
+	/// appends 2x2 box filtered levels down to 1x1
+	extern void generate_mipmaps(Texture_pixels& pixels);
+
+	/// replaces all levels by their DXT5 blocks
+	extern void compress_texture(Texture_pixels& pixels);
+
+	/// identifies the cache entry of the PNG, decoded with the given settings
+	extern auto texture_cache_hash(const std::vector<uint8_t>& png,
+	                               const Texture_cache_settings& settings) -> uint64_t;
+
+	/// false if the entry is damaged or was written for a different hash
+	extern auto read_texture_cache(const uint8_t* data, std::size_t size, uint64_t hash,
+	                               Texture_pixels& pixels) -> bool;
+
+	extern auto write_texture_cache(uint64_t hash, const Texture_pixels& pixels) -> std::vector<uint8_t>;
+
+}
+}
@@ -0,0 +1,248 @@
+#include "texture_loader.hpp"
+
+#include "../asset/asset_manager.hpp"
+#include "../utils/log.hpp"
+#include "../utils/mapped_file.hpp"
+#include "../utils/stopwatch.hpp"
+#include "../utils/thread_pool.hpp"
+
+#include <GL/glew.h>
+#include <glm/vec2.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace mo {
+namespace renderer {
+
+	namespace {
+		constexpr auto cache_prefix = "texture_cache_";
+		constexpr auto cache_suffix = ".bin";
+
+		Texture_loader* current_loader = nullptr;
+
+		class Fnv1a {
+			public:
+				void add(const uint8_t* data, std::size_t size)noexcept {
+					for(auto i=0u; i<size; ++i) {
+						_hash ^= data[i];
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				void add(const std::string& str)noexcept {
+					add(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+				}
+				auto value()const noexcept {return _hash;}
+
+			private:
+				uint64_t _hash = 0xcbf29ce484222325ull;
+		};
+
+		constexpr uint8_t png_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+		auto read_be32(const uint8_t* p) -> int {
+			return static_cast<int>((uint32_t(p[0])<<24) | (uint32_t(p[1])<<16)
+			                        | (uint32_t(p[2])<<8) | uint32_t(p[3]));
+		}
+
+		/// size from the IHDR chunk, which has to be the first one
+		auto png_size(const std::vector<uint8_t>& data) -> util::maybe<glm::ivec2> {
+			if(data.size()<24 || std::memcmp(data.data(), png_signature, sizeof(png_signature))!=0
+			        || std::memcmp(data.data()+12, "IHDR", 4)!=0)
+				return util::nothing();
+
+			auto size = glm::ivec2{read_be32(data.data()+16), read_be32(data.data()+20)};
+			if(size.x<=0 || size.y<=0)
+				return util::nothing();
+
+			return size;
+		}
+
+		auto read_cache(const std::string& path, uint64_t hash, Texture_pixels& pixels) -> bool {
+			auto file = util::Mapped_file{path};
+			return file.valid() && read_texture_cache(file.data(), file.size(), hash, pixels);
+		}
+
+		auto cache_aid(const asset::AID& texture) {
+			auto name = Fnv1a{};
+			name.add(texture.str());
+
+			std::stringstream s;
+			s<<cache_prefix<<std::hex<<name.value()<<cache_suffix;
+			return asset::AID{asset::Asset_type::gen, s.str()};
+		}
+
+	}
+
+	auto texture_loader()noexcept -> Texture_loader* {
+		return current_loader;
+	}
+
+	Texture_loader::Texture_loader(asset::Asset_manager& assets, util::Thread_pool& pool,
+	                               Texture_cache_settings settings, float upload_budget_ms)
+	    : _assets(assets), _pool(pool), _settings(settings), _upload_budget_ms(upload_budget_ms) {
+
+		INVARIANT(!current_loader, "Only one texture loader is allowed");
+
+#ifdef EMSCRIPTEN
+		_settings.compression = false;
+#else
+		if(_settings.compression && !GLEW_EXT_texture_compression_s3tc) {
+			INFO("Texture compression is not supported by the driver");
+			_settings.compression = false;
+		}
+#endif
+
+		current_loader = this;
+	}
+	Texture_loader::~Texture_loader()noexcept {
+		// the workers update our counters until their cache entry is ready
+		for(auto& s : _stores)
+			s.entry.wait();
+
+		current_loader = nullptr;
+	}
+
+	auto Texture_loader::load(const std::vector<uint8_t>& data, const asset::AID& aid)
+	        -> util::maybe<std::shared_ptr<Texture>> {
+
+		auto size = png_size(data);
+		if(size.is_nothing())
+			return util::nothing();
+
+		auto s = size.get_or_throw();
+
+		auto entry_aid = cache_aid(aid);
+		auto cache_path = std::string(); // empty if the entry is not a native file
+		auto cache_bytes = std::shared_ptr<const Texture_cache_entry>();
+		if(_settings.enabled) {
+			// mapped by the worker if possible, otherwise read here because the
+			//   Asset_manager is not thread-safe. Not loaded as an asset, because the
+			//   manager would keep the bytes alive until the next shrink_to_fit().
+			cache_path = _assets.physical_location(entry_aid).get_or_other("");
+			if(cache_path.empty()) {
+				_assets.open(entry_aid).process([&](asset::istream& in) {
+					cache_bytes = asset::Loader<Texture_cache_entry>::load(std::move(in));
+				});
+			}
+		}
+
+		auto entry = std::promise<Texture_cache_entry>();
+		_stores.push_back(Store_request{entry_aid, entry.get_future()});
+
+		auto pixels = _pool.async([this, data, name=aid.str(), settings=_settings, cache_path,
+		                           cache_bytes, entry=std::move(entry)]() mutable {
+			auto watch = util::Stopwatch{};
+			auto hash = texture_cache_hash(data, settings);
+
+			auto pixels = Texture_pixels{};
+			auto new_entry = Texture_cache_entry{};
+
+			auto cached = !cache_path.empty() ? read_cache(cache_path, hash, pixels)
+			            : cache_bytes && read_texture_cache(cache_bytes->data.data(), cache_bytes->data.size(),
+			                                                hash, pixels);
+
+			if(cached) {
+				_cached++;
+
+			} else {
+				pixels = decode_texture(data, name);
+				if(!pixels.data.empty()) {
+					if(settings.mipmaps)
+						generate_mipmaps(pixels);
+					if(settings.compression)
+						compress_texture(pixels);
+					if(settings.enabled)
+						new_entry.data = write_texture_cache(hash, pixels);
+				}
+				_decoded++;
+			}
+
+			_worker_us += static_cast<int64_t>(watch.ms()*1000.f);
+			entry.set_value(std::move(new_entry));
+			return pixels;
+		});
+
+		auto texture = std::make_shared<Texture>(s.x, s.y, std::move(pixels));
+		_queue.emplace_back(texture);
+
+		return texture;
+	}
+
+	void Texture_loader::update() {
+		if(_queue.empty() && _stores.empty())
+			return;
+
+		auto watch = util::Stopwatch{};
+
+		auto uploaded = [&](const std::weak_ptr<Texture>& t) {
+			auto texture = t.lock();
+			if(!texture || texture->ready())
+				return true;
+
+			return watch.ms()<_upload_budget_ms && texture->finish_upload(false);
+		};
+		_queue.erase(std::remove_if(_queue.begin(), _queue.end(), uploaded), _queue.end());
+
+		auto stored = [&](Store_request& s) {
+			if(watch.ms()>=_upload_budget_ms
+			        || s.entry.wait_for(std::chrono::seconds(0))!=std::future_status::ready)
+				return false;
+
+			_store(s);
+			return true;
+		};
+		_stores.erase(std::remove_if(_stores.begin(), _stores.end(), stored), _stores.end());
+	}
+
+	void Texture_loader::wait_all() {
+		if(_queue.empty() && _stores.empty())
+			return;
+
+		auto watch = util::Stopwatch{};
+		auto count = _queue.size();
+
+		for(auto& t : _queue) {
+			if(auto texture = t.lock())
+				texture->finish_upload(true);
+		}
+		_queue.clear();
+
+		for(auto& s : _stores)
+			_store(s);
+		_stores.clear();
+
+		auto s = stats();
+		DEBUG("Waited "<<watch.ms()<<"ms for "<<count<<" textures (so far "<<s.decoded<<" decoded, "
+		      <<s.cached<<" loaded from cache, "<<s.ms<<"ms on the workers)");
+	}
+
+	auto Texture_loader::stats()const noexcept -> Texture_loader_stats {
+		auto s = Texture_loader_stats{};
+		s.decoded = _decoded;
+		s.cached = _cached;
+		s.ms = _worker_us / 1000.f;
+		return s;
+	}
+
+	void Texture_loader::_store(Store_request& request) {
+		auto entry = request.entry.get();
+		if(!entry.data.empty())
+			_assets.save(request.aid, entry);
+	}
+
+}
+
+namespace asset {
+	auto Loader<renderer::Texture_cache_entry>::load(istream in) -> std::shared_ptr<renderer::Texture_cache_entry> {
+		auto entry = std::make_shared<renderer::Texture_cache_entry>();
+		entry->data = in.bytes();
+		return entry;
+	}
+
+	void Loader<renderer::Texture_cache_entry>::store(ostream out, const renderer::Texture_cache_entry& entry) {
+		out.write(reinterpret_cast<const char*>(entry.data.data()), entry.data.size());
+	}
+}
+}
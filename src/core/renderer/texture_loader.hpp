@@ -0,0 +1,110 @@
+/**************************************************************************\
+ * loads textures asynchronously                                          *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "texture.hpp"
+
+#include "../asset/aid.hpp"
+#include "../utils/maybe.hpp"
+#include "../utils/template_utils.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mo {
+	namespace asset {class Asset_manager;}
+	namespace util {class Thread_pool;}
+
+namespace renderer {
+
+	/// decoded texture as stored in the cache (see Texture_loader)
+	struct Texture_cache_entry {
+		std::vector<uint8_t> data; //< header + pixels
+	};
+
+	struct Texture_loader_stats {
+		int decoded = 0; //< textures decoded from their PNG
+		int cached = 0;  //< textures loaded from the cache
+		float ms = 0;    //< time spent on the workers
+	};
+
+	/**
+	 * Decodes PNG textures on the thread pool and uploads them on the main
+	 *   thread. The size is read from the PNG header, so the Texture can be
+	 *   returned immediately. Pending textures are uploaded in update() until
+	 *   the budget of the frame is used up (or on their first bind).
+	 * The decoded (flipped and premultiplied) pixels are stored in the write
+	 *   directory (gen:texture_cache_<name>.bin), together with a hash of the
+	 *   PNG and the settings. Changed sources or settings are decoded again and
+	 *   replace the old entry.
+	 */
+	class Texture_loader : util::no_copy_move {
+		public:
+			Texture_loader(asset::Asset_manager& assets, util::Thread_pool& pool,
+			               Texture_cache_settings settings, float upload_budget_ms=2.f);
+			~Texture_loader()noexcept;
+
+			/// nothing if the data can't be decoded asynchronously (e.g. not a PNG)
+			auto load(const std::vector<uint8_t>& data, const asset::AID& aid)
+			        -> util::maybe<std::shared_ptr<Texture>>;
+
+			/// uploads finished textures and stores new cache entries; called once per frame
+			void update();
+
+			/// blocks until all queued textures have been uploaded (e.g. at the end of a loading screen)
+			void wait_all();
+
+			auto pending()const noexcept {return _queue.size();}
+
+			auto stats()const noexcept -> Texture_loader_stats;
+
+		private:
+			struct Store_request {
+				asset::AID aid;
+				std::future<Texture_cache_entry> entry; //< empty if there is nothing to store
+			};
+
+			void _store(Store_request& request);
+
+			asset::Asset_manager& _assets;
+			util::Thread_pool& _pool;
+			Texture_cache_settings _settings;
+			const float _upload_budget_ms;
+			std::vector<std::weak_ptr<Texture>> _queue;
+			std::vector<Store_request> _stores;
+
+			// written by the workers
+			std::atomic<int> _decoded{0};
+			std::atomic<int> _cached{0};
+			std::atomic<int64_t> _worker_us{0};
+	};
+
+	/// the loader used by the asset manager; null if there is none
+	extern auto texture_loader()noexcept -> Texture_loader*;
+
+}
+
+namespace asset {
+	template<>
+	struct Loader<renderer::Texture_cache_entry> {
+		static auto load(istream in) -> std::shared_ptr<renderer::Texture_cache_entry>;
+		static void store(ostream out, const renderer::Texture_cache_entry& entry);
+	};
+}
+}
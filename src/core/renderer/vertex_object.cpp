@@ -4,6 +4,10 @@
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "stream_ring.hpp"
+#include "gl_state.hpp"
+
+#include "../utils/stopwatch.hpp"
 
 namespace mo {
 namespace renderer {
@@ -46,32 +50,53 @@ namespace renderer {
 	      _max_elements(elements),
 	      _dynamic(dynamic) {
 		glGenBuffers(1, &_id);
-		glBindBuffer(GL_ARRAY_BUFFER, _id);
+		bind_array_buffer(_id);
 		glBufferData(GL_ARRAY_BUFFER, _elements*_element_size, data,
 		             _dynamic ? GL_STREAM_DRAW : GL_STATIC_DRAW);
 	}
 	Buffer::Buffer(Buffer&& b)noexcept
 	    : _id(b._id), _element_size(b._element_size),
-	      _elements(b._elements), _max_elements(b._elements), _dynamic(b._dynamic) {
+	      _elements(b._elements), _max_elements(b._max_elements), _dynamic(b._dynamic),
+	      _stream_frame(b._stream_frame), _stream_offset(b._stream_offset),
+	      _last_set_frame(b._last_set_frame) {
 		b._id = 0;
+
+		if(auto ring = stream_ring())
+			ring->moved(b, *this);
 	}
 
 	Buffer::~Buffer()noexcept {
-		if(_id)
+		if(auto ring = stream_ring())
+			ring->forget(*this);
+
+		if(_id) {
+			forget_buffer(_id);
 			glDeleteBuffers(1, &_id);
+		}
 	}
 
 	Buffer& Buffer::operator=(Buffer&& b)noexcept {
 		INVARIANT(this!=&b, "move to self");
 
-		if(_id)
+		if(auto ring = stream_ring()) {
+			ring->forget(*this);
+			ring->moved(b, *this);
+		}
+
+		if(_id) {
+			forget_buffer(_id);
 			glDeleteBuffers(1, &_id);
+		}
 
 		_id = b._id;
 		b._id = 0;
 		_element_size = b._element_size;
 		_elements = b._elements;
+		_max_elements = b._max_elements;
 		_dynamic = b._dynamic;
+		_stream_frame = b._stream_frame;
+		_stream_offset = b._stream_offset;
+		_last_set_frame = b._last_set_frame;
 
 		return *this;
 	}
@@ -81,10 +106,35 @@ namespace renderer {
 		INVARIANT(_dynamic, "set(...) is only allowed for dynamic buffers!");
 		INVARIANT(_id!=0, "Can't access invalid buffer!");
 
-		glBindBuffer(GL_ARRAY_BUFFER, _id);
+		auto ring = stream_ring();
+		auto size = elements*_element_size;
+
+		// only buffers that are updated (nearly) every frame are streamed,
+		//   everything else would just be copied back on the next draw
+		if(ring) {
+			auto frame = ring->frame();
+			auto hot = _last_set_frame!=0 && _last_set_frame+1 >= frame;
+			_last_set_frame = frame;
+
+			if(hot && size>0) {
+				auto offset = ring->upload(*this, data, size);
+				if(offset.is_some()) {
+					_elements = elements;
+					_stream_frame = frame;
+					_stream_offset = offset.get_or_throw();
+					return;
+				}
+			}
+		}
 
+		auto watch = util::Stopwatch{};
+
+		_stream_frame = 0;
+		_stream_offset = 0;
 		_elements = elements;
 
+		bind_array_buffer(_id);
+
 		if(_max_elements>=elements) {
 			glBufferData(GL_ARRAY_BUFFER, _max_elements*_element_size, nullptr,
 						 GL_STREAM_DRAW);
@@ -97,10 +147,57 @@ namespace renderer {
 			glBufferData(GL_ARRAY_BUFFER, elements*_element_size, data,
 			             GL_STREAM_DRAW);
 		}
+
+		if(ring)
+			ring->record_fallback(size, watch.ms());
 	}
 
 	void Buffer::_bind()const {
-		glBindBuffer(GL_ARRAY_BUFFER, _id);
+		bind_array_buffer(_gl_id());
+	}
+	auto Buffer::_gl_id()const noexcept -> unsigned int {
+		return _stream_frame!=0 ? stream_ring()->id() : _id;
+	}
+	auto Buffer::_offset()const noexcept -> std::size_t {
+		return _stream_frame!=0 ? _stream_offset : 0;
+	}
+
+	void Buffer::_prepare_draw() {
+		if(_stream_frame==0)
+			return;
+
+		auto ring = stream_ring();
+		if(ring && _stream_frame==ring->frame())
+			return;
+
+		// the data is from an older frame and will be overwritten soon
+		//   (stale data is copied back by the ring, before its segment is reused)
+		if(!ring || !ring->valid(_stream_frame)) {
+			WARN("Streamed vertex data has been overwritten before it was drawn");
+			_stream_frame = 0;
+			_elements = 0;
+			return;
+		}
+
+		_copy_back(*ring);
+	}
+
+	void Buffer::_copy_back(const Stream_ring& ring) {
+		_stream_frame = 0;
+
+		auto size = _elements*_element_size;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, _id);
+		if(_max_elements<_elements) {
+			_max_elements = _elements;
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		}
+
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.id());
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, _stream_offset, 0, size);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 	}
 
 
@@ -111,7 +208,7 @@ namespace renderer {
 			shader.bind_attribute_location(e.name, index++);
 		}
 	}
-	bool Vertex_layout::_build(const std::vector<Buffer>& buffers)const {
+	bool Vertex_layout::_build(const std::vector<Buffer>& buffers, std::size_t first_instance)const {
 		bool instanced = false;
 
 		std::size_t bound_buffer =-1;
@@ -124,8 +221,12 @@ namespace renderer {
 				buffer->_bind();
 			}
 
+			auto offset = static_cast<const char*>(e.offset) + buffer->_offset();
+			if(e.divisor>0)
+				offset += first_instance/e.divisor * buffer->_element_size;
+
 			glEnableVertexAttribArray(index);
-			glVertexAttribPointer(index,e.size,to_gl(e.type),e.normalized, buffer->_element_size, e.offset);
+			glVertexAttribPointer(index,e.size,to_gl(e.type),e.normalized, buffer->_element_size, offset);
 			glVertexAttribDivisor(index, e.divisor);
 			instanced |= e.divisor>0;
 
@@ -142,9 +243,15 @@ namespace renderer {
 		glBindVertexArray(_vao_id);
 		_instanced = layout._build(_data);
 		glBindVertexArray(0);
+
+		_bindings.reserve(_data.size());
+		for(auto& b : _data)
+			_bindings.emplace_back(b._gl_id(), b._offset());
 	}
 	Object::Object(Object&& o)noexcept
-	    : _data(std::move(o._data)), _vao_id(o._vao_id) {
+	    : _layout(std::move(o._layout)), _mode(o._mode), _data(std::move(o._data)), _vao_id(o._vao_id),
+	      _instanced(o._instanced), _bindings(std::move(o._bindings)),
+	      _first_instance(o._first_instance) {
 		o._vao_id = 0;
 	}
 	Object::~Object()noexcept {
@@ -152,13 +259,48 @@ namespace renderer {
 			glDeleteVertexArrays(1, &_vao_id);
 	}
 
-	void Object::draw()const {
+	void Object::_bind(std::size_t first_instance)const {
 		glBindVertexArray(_vao_id);
-		if(!_instanced)
-			glDrawArrays(to_gl(_mode), 0, _data.at(0).size());
-		else
-			glDrawArraysInstanced(to_gl(_mode), 0, _data.at(0).size(), _data.at(1).size());
 
+		auto changed = first_instance!=_first_instance;
+		for(auto i=0u; i<_data.size(); ++i) {
+			auto& b = _data[i];
+			b._prepare_draw();
+
+			auto binding = std::make_pair(b._gl_id(), b._offset());
+			if(_bindings[i]!=binding) {
+				_bindings[i] = binding;
+				changed = true;
+			}
+		}
+
+		if(changed) {
+			_first_instance = first_instance;
+			_layout._build(_data, first_instance);
+		}
+	}
+
+	void Object::draw()const {
+		if(_instanced) {
+			draw_instances(0, _data.at(1).size());
+			return;
+		}
+
+		_bind(0);
+		glDrawArrays(to_gl(_mode), 0, _data.at(0).size());
+		glBindVertexArray(0);
+	}
+
+	void Object::draw_instances(std::size_t first, std::size_t count)const {
+		INVARIANT(_instanced, "draw_instances(...) is only allowed for instanced objects!");
+		INVARIANT(first+count<=_data.at(1).size(), "Instance range out of bounds");
+
+		if(count==0)
+			return;
+
+		// there is no base instance in GL 3.3/ES 3, so we move the attribute pointers instead
+		_bind(first);
+		glDrawArraysInstanced(to_gl(_mode), 0, _data.at(0).size(), count);
 		glBindVertexArray(0);
 	}
 
@@ -168,7 +310,13 @@ namespace renderer {
 		if(_vao_id)
 			glDeleteVertexArrays(1, &_vao_id);
 
+		_layout = std::move(o._layout);
+		_mode = o._mode;
+		_data = std::move(o._data);
 		_vao_id = o._vao_id;
+		_instanced = o._instanced;
+		_bindings = std::move(o._bindings);
+		_first_instance = o._first_instance;
 		o._vao_id = 0;
 		return *this;
 	}
@@ -19,7 +19,9 @@
 #include <vector>
 #include <iterator>
 #include <string>
+#include <utility>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include "../utils/template_utils.hpp"
 
@@ -61,11 +63,13 @@ namespace renderer {
 
 	class Object;
 	class Shader_program;
+	class Stream_ring;
 
 
 	class Buffer : util::no_copy {
 		friend class Object;
 		friend class Vertex_layout;
+		friend class Stream_ring;
 		public:
 			Buffer(std::size_t element_size, std::size_t elements,
 			       bool dynamic, const void* data=nullptr);
@@ -89,8 +93,20 @@ namespace renderer {
 			std::size_t _max_elements;
 			bool _dynamic;
 
+			// data of buffers that are updated every frame lives in the stream ring
+			uint64_t _stream_frame = 0; //< frame of the current data in the ring; 0 if not streamed
+			std::size_t _stream_offset = 0;
+			uint64_t _last_set_frame = 0; //< 0 if it has never been set while there was a ring
+
 			void _set_raw(std::size_t element_size, std::size_t size, const void* data);
 			void _bind()const;
+			auto _gl_id()const noexcept -> unsigned int;
+			auto _offset()const noexcept -> std::size_t;
+
+			/// moves streamed data from older frames into the own buffer before it's overwritten
+			void _prepare_draw();
+			/// copies the streamed data into the own buffer and stops using the ring
+			void _copy_back(const Stream_ring& ring);
 	};
 	template<class T>
 	Buffer create_dynamic_buffer(std::size_t elements);
@@ -133,13 +149,14 @@ namespace renderer {
 
 			void setup_shader(Shader_program& shader)const;
 
+			auto elements()const noexcept -> const std::vector<Element>& {return _elements;}
 
 		private:
-			const Mode _mode;
-			const std::vector<Element> _elements;
+			Mode _mode;
+			std::vector<Element> _elements;
 
-			/// returns ture for instanced rendering
-			bool _build(const std::vector<Buffer>& buffers)const;
+			/// sets the attribute pointers of the bound VAO; returns ture for instanced rendering
+			bool _build(const std::vector<Buffer>& buffers, std::size_t first_instance=0)const;
 	};
 	template<class Base> Vertex_layout::Element vertex(const std::string& name, int8_t    Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
 	template<class Base> Vertex_layout::Element vertex(const std::string& name, uint8_t   Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
@@ -152,6 +169,11 @@ namespace renderer {
 	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::vec2 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
 	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::vec3 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
 	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::vec4 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
+	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::i16vec2 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
+	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::i16vec4 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
+	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::u16vec2 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
+	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::u16vec4 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
+	template<class Base> Vertex_layout::Element vertex(const std::string& name, glm::u8vec4 Base::* value, std::size_t buffer=0, uint8_t divisor=0, bool normalized=false);
 
 
 	class Object : util::no_copy {
@@ -163,17 +185,26 @@ namespace renderer {
 
 			void draw()const;
 
+			/// draws the instances [first, first+count) of an instanced object
+			void draw_instances(std::size_t first, std::size_t count)const;
+
 			Buffer& buffer(std::size_t i=0){return _data.at(i);}
 
 			Object& operator=(Object&&)noexcept;
 
 		private:
 			void _init(const Vertex_layout& layout);
+			void _bind(std::size_t first_instance)const;
 
+			Vertex_layout _layout; //< a copy, so the object can be built from temporary layouts
 			Vertex_layout::Mode _mode;
-			std::vector<Buffer> _data;
+			mutable std::vector<Buffer> _data; //< streamed buffers may be moved by draw()
 			unsigned int _vao_id;
 			bool _instanced;
+
+			/// (buffer id, offset) of each buffer as currently set in the VAO
+			mutable std::vector<std::pair<unsigned int, std::size_t>> _bindings;
+			mutable std::size_t _first_instance = 0;
 	};
 
 }
@@ -51,13 +51,18 @@ namespace renderer {
 	VERTEX_FACTORY(glm::vec2, float_t,  2)
 	VERTEX_FACTORY(glm::vec3, float_t,  3)
 	VERTEX_FACTORY(glm::vec4, float_t,  4)
+	VERTEX_FACTORY(glm::i16vec2, short_t,  2)
+	VERTEX_FACTORY(glm::i16vec4, short_t,  4)
+	VERTEX_FACTORY(glm::u16vec2, ushort_t, 2)
+	VERTEX_FACTORY(glm::u16vec4, ushort_t, 4)
+	VERTEX_FACTORY(glm::u8vec4,  ubyte_t,  4)
 
 #undef VERTEX_FACTORY
 
 
 	template<class... B>
 	Object::Object(const Vertex_layout& layout, B&&... d)
-		: _mode(layout._mode), _data(), _vao_id(0) {
+		: _layout(layout), _mode(layout._mode), _data(), _vao_id(0) {
 		_data.reserve(sizeof...(d));
 		auto ignored = {(_data.emplace_back(std::forward<B>(d)), 0)...};
 		(void)ignored;
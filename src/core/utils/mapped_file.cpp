@@ -0,0 +1,93 @@
+#include "mapped_file.hpp"
+
+#include "log.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#if !defined(WIN) && !defined(__EMSCRIPTEN__)
+	#define MO_HAS_MMAP
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace mo {
+namespace util {
+
+	Mapped_file::Mapped_file(const std::string& path) {
+#ifdef MO_HAS_MMAP
+		auto fd = ::open(path.c_str(), O_RDONLY);
+		if(fd>=0) {
+			struct stat st;
+			if(::fstat(fd, &st)==0 && st.st_size>0) {
+				auto addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if(addr!=MAP_FAILED) {
+					_data = static_cast<const uint8_t*>(addr);
+					_size = static_cast<std::size_t>(st.st_size);
+					_mapped = true;
+				}
+			}
+			::close(fd);
+
+			if(_mapped)
+				return;
+		}
+
+		DEBUG("Unable to map \""<<path<<"\". Falling back to read.");
+#endif
+
+		std::ifstream in(path, std::ios::binary);
+		if(!in)
+			return;
+
+		_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		if(!_buffer.empty()) {
+			_data = _buffer.data();
+			_size = _buffer.size();
+		}
+	}
+
+	Mapped_file::Mapped_file(Mapped_file&& o)noexcept
+	    : _data(o._data), _size(o._size), _mapped(o._mapped), _buffer(std::move(o._buffer)) {
+		o._data = nullptr;
+		o._size = 0;
+		o._mapped = false;
+	}
+
+	Mapped_file::~Mapped_file()noexcept {
+		_release();
+	}
+
+	Mapped_file& Mapped_file::operator=(Mapped_file&& o)noexcept {
+		if(this!=&o) {
+			_release();
+
+			_data = o._data;
+			_size = o._size;
+			_mapped = o._mapped;
+			_buffer = std::move(o._buffer);
+
+			o._data = nullptr;
+			o._size = 0;
+			o._mapped = false;
+		}
+
+		return *this;
+	}
+
+	void Mapped_file::_release()noexcept {
+#ifdef MO_HAS_MMAP
+		if(_mapped)
+			::munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+
+		_data = nullptr;
+		_size = 0;
+		_mapped = false;
+		_buffer.clear();
+	}
+
+}
+}
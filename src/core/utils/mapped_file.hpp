@@ -0,0 +1,56 @@
+/**************************************************************************\
+ * read-only memory mapped files                                          *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include "template_utils.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace mo {
+namespace util {
+
+	/**
+	 * Read-only view of the content of a file.
+	 * The file is memory mapped if the platform supports it, otherwise its
+	 *   content is read into memory.
+	 */
+	class Mapped_file : no_copy {
+		public:
+			/// check valid() to see whether the file could be opened
+			explicit Mapped_file(const std::string& path);
+			Mapped_file(Mapped_file&&)noexcept;
+			~Mapped_file()noexcept;
+
+			Mapped_file& operator=(Mapped_file&&)noexcept;
+
+			auto valid()const noexcept {return _data!=nullptr;}
+			auto data()const noexcept {return _data;}
+			auto size()const noexcept {return _size;}
+
+		private:
+			void _release()noexcept;
+
+			const uint8_t* _data = nullptr;
+			std::size_t _size = 0;
+			bool _mapped = false;
+			std::vector<uint8_t> _buffer; //< only used if the file couldn't be mapped
+	};
+
+}
+}
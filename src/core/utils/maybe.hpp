@@ -40,9 +40,17 @@ namespace util {
 		public:
 			/*implicit*/ maybe(T&& data)noexcept : _valid(true), _data(std::move(data)) {}
 			/*implicit*/ maybe(const T& data)noexcept : _valid(true), _data(data) {}
-			maybe(const maybe& o)noexcept : _valid(o._valid), _data(o._data) {}
-			maybe(maybe&& o)noexcept : _valid(o._valid), _data(std::move(o._data)) {
-				o._valid = false;
+			// _data is only constructed if _valid, so a nothing must never be copied from
+			maybe(const maybe& o)noexcept : _valid(o._valid) {
+				if(_valid)
+					_construct(o._data);
+			}
+			maybe(maybe&& o)noexcept : _valid(o._valid) {
+				if(_valid) {
+					_construct(std::move(o._data));
+					o._data.~T();
+					o._valid = false;
+				}
 			}
 			~maybe()noexcept {
 				if(is_some())
@@ -54,21 +62,35 @@ namespace util {
 			}
 
 			maybe& operator=(const maybe& o)noexcept {
+				if(this==&o)
+					return *this;
+
+				if(_valid && o._valid)
+					_data = o._data;
+				else if(o._valid)
+					_construct(o._data);
+				else if(_valid)
+					_data.~T();
+
 				_valid = o._valid;
-				_data = o._data;
 				return *this;
 			}
 			maybe& operator=(maybe&& o)noexcept {
+				if(this==&o)
+					return *this;
+
+				if(_valid && o._valid)
+					_data = std::move(o._data);
+				else if(o._valid)
+					_construct(std::move(o._data));
+				else if(_valid)
+					_data.~T();
+
 				_valid = o._valid;
 				if(o._valid) {
-					if(_valid)
-						_data = std::move(o._data);
-					else
-						new(&_data) T(std::move(o._data));
+					o._data.~T();
+					o._valid = false;
 				}
-
-				o._valid = false;
-				o._data.~T();
 				return *this;
 			}
 
@@ -131,6 +153,11 @@ namespace util {
 		private:
 			maybe() : _valid(false) {}
 
+			template<typename... Args>
+			void _construct(Args&&... args) {
+				::new(const_cast<void*>(static_cast<const void*>(&_data))) T(std::forward<Args>(args)...);
+			}
+
 			bool _valid;
 			union {
 				T _data;
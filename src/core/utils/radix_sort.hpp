@@ -0,0 +1,76 @@
+/**************************************************************************\
+ * stable LSD radix sort                                                  *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace mo {
+namespace util {
+
+	/**
+	 * Stable LSD radix sort by an unsigned integer key, one byte per pass.
+	 * Bytes that are the same in all keys (e.g. unused bits) are skipped.
+	 * @param tmp scratch memory, that can be reused between calls to avoid allocations
+	 * @param key returns the key of an element
+	 */
+	template<class T, class Key_func>
+	void radix_sort(std::vector<T>& data, std::vector<T>& tmp, Key_func&& key) {
+		using Key = std::decay_t<decltype(key(data.front()))>;
+		static_assert(std::is_unsigned<Key>::value, "radix_sort requires unsigned keys");
+		constexpr auto passes = sizeof(Key);
+
+		if(data.size()<2)
+			return;
+
+		auto counts = std::array<std::array<std::size_t, 256>, passes>{};
+		for(auto& e : data) {
+			auto k = key(e);
+			for(auto p=0u; p<passes; ++p)
+				counts[p][(k>>(p*8)) & 0xff]++;
+		}
+
+		tmp.resize(data.size());
+		auto src = &data;
+		auto dst = &tmp;
+
+		for(auto p=0u; p<passes; ++p) {
+			auto& count = counts[p];
+			if(count[(key(src->front())>>(p*8)) & 0xff]==data.size())
+				continue;
+
+			auto offsets = std::array<std::size_t, 256>{};
+			auto sum = std::size_t(0);
+			for(auto i=0u; i<256; ++i) {
+				offsets[i] = sum;
+				sum += count[i];
+			}
+
+			for(auto& e : *src)
+				(*dst)[offsets[(key(e)>>(p*8)) & 0xff]++] = e;
+
+			std::swap(src, dst);
+		}
+
+		if(src!=&data)
+			data.swap(tmp);
+	}
+
+}
+}
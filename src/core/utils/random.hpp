@@ -17,6 +17,8 @@
 
 #include <random>
 #include <ctime>
+#include <cstdint>
+#include <limits>
 
 namespace mo {
 namespace util {
@@ -66,6 +68,30 @@ namespace util {
 
 	using random_generator = std::mt19937_64;
 
+	/**
+	 * SplitMix64; cheap to seed and copy. Used for per-entity streams that
+	 *   have to be independent of the order they are processed in.
+	 */
+	class split_mix_generator {
+		public:
+			using result_type = uint64_t;
+
+			explicit split_mix_generator(uint64_t seed=0) noexcept : _state(seed) {}
+
+			static constexpr result_type min() noexcept {return 0;}
+			static constexpr result_type max() noexcept {return std::numeric_limits<result_type>::max();}
+
+			result_type operator()() noexcept {
+				auto z = (_state += 0x9E3779B97F4A7C15ull);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				return z ^ (z >> 31);
+			}
+
+		private:
+			uint64_t _state;
+	};
+
 	inline auto create_random_generator() -> random_generator {
 		//static std::random_device rd;
 		return random_generator(std::time(0));
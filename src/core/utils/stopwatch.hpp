@@ -0,0 +1,49 @@
+/**************************************************************************\
+ * measures elapsed (wall clock) time, e.g. for load-time statistics      *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include <chrono>
+
+namespace mo {
+namespace util {
+
+	class Stopwatch {
+		public:
+			using clock = std::chrono::steady_clock;
+
+			Stopwatch()noexcept : _start(clock::now()) {}
+
+			void reset()noexcept {_start = clock::now();}
+
+			/// elapsed time in milliseconds
+			auto ms()const noexcept -> float {
+				return std::chrono::duration<float, std::milli>(clock::now()-_start).count();
+			}
+
+			/// elapsed time in milliseconds; restarts the measurement
+			auto lap_ms()noexcept -> float {
+				auto now = clock::now();
+				auto r = std::chrono::duration<float, std::milli>(now-_start).count();
+				_start = now;
+				return r;
+			}
+
+		private:
+			clock::time_point _start;
+	};
+
+}
+}
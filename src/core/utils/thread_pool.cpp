@@ -0,0 +1,77 @@
+#include "thread_pool.hpp"
+
+#include "log.hpp"
+
+namespace mo {
+namespace util {
+
+#ifndef __EMSCRIPTEN__
+	Thread_pool::Thread_pool(int threads) {
+		if(threads<0)
+			threads = std::max(0, static_cast<int>(std::thread::hardware_concurrency())-1);
+
+		_workers.reserve(threads);
+		for(auto i=0; i<threads; ++i)
+			_workers.emplace_back([this]{_run_worker();});
+
+		INFO("Started thread pool with "<<threads<<" worker threads");
+	}
+
+	Thread_pool::~Thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(_tasks_mutex);
+			_quit = true;
+		}
+		_tasks_cv.notify_all();
+
+		for(auto& w : _workers)
+			w.join();
+	}
+
+	void Thread_pool::_post(std::function<void()> task) {
+		{
+			std::lock_guard<std::mutex> lock(_tasks_mutex);
+			_tasks.emplace_back(std::move(task));
+		}
+		_tasks_cv.notify_one();
+	}
+
+	void Thread_pool::_run_worker() {
+		while(true) {
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(_tasks_mutex);
+				_tasks_cv.wait(lock, [&]{return _quit || !_tasks.empty();});
+
+				if(_tasks.empty())
+					return; // _quit
+
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+#else
+	Thread_pool::Thread_pool(int) {
+		INFO("No thread support. All tasks will be executed on the main thread.");
+	}
+	Thread_pool::~Thread_pool() {
+		while(!_tasks.empty()) {
+			_tasks.front()();
+			_tasks.pop_front();
+		}
+	}
+
+	void Thread_pool::_post(std::function<void()> task) {
+		task();
+	}
+	void Thread_pool::_run_worker() {
+	}
+#endif
+
+}
+}
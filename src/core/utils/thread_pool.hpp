@@ -0,0 +1,185 @@
+/**************************************************************************\
+ * a simple pool of worker threads                                        *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "template_utils.hpp"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#ifndef __EMSCRIPTEN__
+	#include <thread>
+#endif
+
+namespace mo {
+namespace util {
+
+	/**
+	 * Executes tasks on a fixed number of worker threads.
+	 * Without thread support (emscripten) all tasks are executed directly
+	 *   by the calling thread.
+	 */
+	class Thread_pool : no_copy_move {
+		public:
+			/// threads<0: one less than the number of hardware threads
+			explicit Thread_pool(int threads=-1);
+			~Thread_pool();
+
+			/// number of threads working on a parallel_for (including the caller)
+			auto concurrency()const noexcept -> std::size_t {return _workers.size()+1;}
+
+			/// number of chunks a parallel_for(count, min_chunk_size, ...) is split into
+			auto chunks(std::size_t count, std::size_t min_chunk_size)const noexcept -> std::size_t;
+
+			/**
+			 * Calls f(begin, end, chunk_index) for disjunct ranges covering [0,count)
+			 *   and blocks until all of them are processed.
+			 * The chunks are contiguous and ordered by their index, so per-chunk
+			 *   results concatenated by chunk index don't depend on the scheduling.
+			 */
+			template<class F>
+			void parallel_for(std::size_t count, std::size_t min_chunk_size, F&& f);
+
+			/// executes f on a worker thread
+			template<class F>
+			auto async(F&& f) -> std::future<decltype(f())>;
+
+		private:
+			void _post(std::function<void()> task);
+			void _run_worker();
+
+#ifndef __EMSCRIPTEN__
+			std::vector<std::thread> _workers;
+#else
+			std::vector<int> _workers;
+#endif
+			std::deque<std::function<void()>> _tasks;
+			std::mutex _tasks_mutex;
+			std::condition_variable _tasks_cv;
+			bool _quit = false;
+	};
+
+
+	inline auto Thread_pool::chunks(std::size_t count, std::size_t min_chunk_size)const noexcept -> std::size_t {
+		if(count==0)
+			return 0;
+
+		min_chunk_size = std::max<std::size_t>(1, min_chunk_size);
+		auto max_chunks = (count + min_chunk_size-1) / min_chunk_size;
+
+		return std::min(max_chunks, concurrency()*4);
+	}
+
+	template<class F>
+	void Thread_pool::parallel_for(std::size_t count, std::size_t min_chunk_size, F&& f) {
+		const auto chunk_count = chunks(count, min_chunk_size);
+		if(chunk_count==0)
+			return;
+
+		const auto chunk_size = (count + chunk_count-1) / chunk_count;
+
+		auto exec_chunk = [&](std::size_t c) {
+			auto begin = c*chunk_size;
+			auto end = std::min(count, begin+chunk_size);
+			if(begin<end)
+				f(begin, end, c);
+		};
+
+		if(chunk_count==1 || _workers.empty()) {
+			for(auto c=0u; c<chunk_count; ++c)
+				exec_chunk(c);
+			return;
+		}
+
+		// helpers that start after all chunks have been claimed return without touching
+		//   the stack of this function, so we only have to wait for the chunks themselves
+		//   (also allows nested calls from worker threads)
+		struct State {
+			std::atomic<std::size_t> next{0};
+			std::size_t chunk_count;
+			std::size_t done = 0;
+			std::exception_ptr error;
+			std::mutex mutex;
+			std::condition_variable cv;
+		};
+		auto state = std::make_shared<State>();
+		state->chunk_count = chunk_count;
+
+		auto work = [](State& state, const std::function<void(std::size_t)>& exec) {
+			std::size_t processed = 0;
+			std::exception_ptr error;
+
+			for(auto c=state.next++; c<state.chunk_count; c=state.next++) {
+				try {
+					exec(c);
+				} catch(...) {
+					error = std::current_exception();
+				}
+				processed++;
+			}
+
+			if(processed>0) {
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.done+=processed;
+				if(error && !state.error)
+					state.error = error;
+				if(state.done==state.chunk_count)
+					state.cv.notify_all();
+			}
+		};
+
+		const std::function<void(std::size_t)> exec = exec_chunk;
+
+		auto helpers = std::min(_workers.size(), chunk_count-1);
+		for(auto i=0u; i<helpers; ++i) {
+			_post([state, work, exec_ptr = &exec] {
+				work(*state, *exec_ptr);
+			});
+		}
+
+		work(*state, exec);
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->cv.wait(lock, [&]{return state->done==chunk_count;});
+
+		if(state->error)
+			std::rethrow_exception(state->error);
+	}
+
+	template<class F>
+	auto Thread_pool::async(F&& f) -> std::future<decltype(f())> {
+		using R = decltype(f());
+
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+		auto future = task->get_future();
+
+		if(_workers.empty())
+			(*task)();
+		else
+			_post([task]{(*task)();});
+
+		return future;
+	}
+
+}
+}
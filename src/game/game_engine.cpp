@@ -14,7 +14,8 @@ namespace mo {
 
 	Game_engine::Game_engine(const std::string& title, int argc, char** argv, char** env, bool start_game)
 		: Engine(title, argc, argv, env),
-		  _controllers(assets(), input()) {
+		  _controllers(assets(), input()),
+		  _level_pregenerator(assets(), thread_pool()) {
 
 		auto args = std::vector<std::string>();
 		args.reserve(argc);
@@ -19,6 +19,7 @@
 #include <core/configuration.hpp>
 
 #include <game/sys/controller/controller_system.hpp>
+#include <game/level/level_pregenerator.hpp>
 
 namespace mo {
 
@@ -43,12 +44,17 @@ namespace mo {
 				return _controllers;
 			}
 
+			auto level_pregenerator()noexcept -> level::Level_pregenerator& {
+				return _level_pregenerator;
+			}
+
 		protected:
 			void _on_frame(float dt) override;
 			auto _on_reload() -> std::tuple<bool, std::string> override;
 
 		private:
 			sys::controller::Controller_manager _controllers;
+			level::Level_pregenerator _level_pregenerator;
 	};
 
 }
@@ -10,7 +10,10 @@
 
 #include <core/renderer/texture.hpp>
 #include <core/renderer/primitives.hpp>
+#include <core/renderer/program_cache.hpp>
+#include <core/renderer/texture_loader.hpp>
 #include <core/asset/aid.hpp>
+#include <core/utils/stopwatch.hpp>
 
 #include "sys/physics/transform_comp.hpp"
 #include "sys/graphic/sprite_comp.hpp"
@@ -96,20 +99,17 @@ namespace mo {
 		_join_slot.connect(engine.controllers().join_events);
 		_unjoin_slot.connect(engine.controllers().unjoin_events);
 
-		_post_effects.attach_shader(engine.assets().load<renderer::Shader>("vert_shader:poste"_aid))
-					 .attach_shader(engine.assets().load<renderer::Shader>("frag_shader:poste"_aid))
-					 .bind_all_attribute_locations(renderer::simple_vertex_layout)
-					 .build();
+		_post_effects = load_program(engine.assets(), "vert_shader:poste"_aid, "frag_shader:poste"_aid,
+		                             renderer::simple_vertex_layout);
 
-		_lightmap_filter.attach_shader(engine.assets().load<renderer::Shader>("vert_shader:poste"_aid))
-		                .attach_shader(engine.assets().load<renderer::Shader>("frag_shader:lmf"_aid))
-		                .bind_all_attribute_locations(renderer::simple_vertex_layout)
-		                .build();
+		_lightmap_filter = load_program(engine.assets(), "vert_shader:poste"_aid, "frag_shader:lmf"_aid,
+		                                renderer::simple_vertex_layout);
 
-		_blur_filter.attach_shader(engine.assets().load<renderer::Shader>("vert_shader:poste"_aid))
-		            .attach_shader(engine.assets().load<renderer::Shader>("frag_shader:blur"_aid))
-		            .bind_all_attribute_locations(renderer::simple_vertex_layout)
-		            .build();
+		_blur_filter = load_program(engine.assets(), "vert_shader:poste"_aid, "frag_shader:blur"_aid,
+		                            renderer::simple_vertex_layout);
+
+		// the level is loaded now, so everything it needs should be on the GPU before the first frame
+		engine.texture_loader().wait_all();
 
 		_fadein_left = fade_time;
 	}
@@ -137,20 +137,17 @@ namespace mo {
 		_join_slot.connect(engine.controllers().join_events);
 		_unjoin_slot.connect(engine.controllers().unjoin_events);
 
-		_post_effects.attach_shader(engine.assets().load<renderer::Shader>("vert_shader:poste"_aid))
-		             .attach_shader(engine.assets().load<renderer::Shader>("frag_shader:poste"_aid))
-		             .bind_all_attribute_locations(renderer::simple_vertex_layout)
-		             .build();
+		_post_effects = load_program(engine.assets(), "vert_shader:poste"_aid, "frag_shader:poste"_aid,
+		                             renderer::simple_vertex_layout);
+
+		_lightmap_filter = load_program(engine.assets(), "vert_shader:poste"_aid, "frag_shader:lmf"_aid,
+		                                renderer::simple_vertex_layout);
 
-		_lightmap_filter.attach_shader(engine.assets().load<renderer::Shader>("vert_shader:poste"_aid))
-		                .attach_shader(engine.assets().load<renderer::Shader>("frag_shader:lmf"_aid))
-		                .bind_all_attribute_locations(renderer::simple_vertex_layout)
-		                .build();
+		_blur_filter = load_program(engine.assets(), "vert_shader:poste"_aid, "frag_shader:blur"_aid,
+		                            renderer::simple_vertex_layout);
 
-		_blur_filter.attach_shader(engine.assets().load<renderer::Shader>("vert_shader:poste"_aid))
-		            .attach_shader(engine.assets().load<renderer::Shader>("frag_shader:blur"_aid))
-		            .bind_all_attribute_locations(renderer::simple_vertex_layout)
-		            .build();
+		// the level is loaded now, so everything it needs should be on the GPU before the first frame
+		engine.texture_loader().wait_all();
 
 		_fadein_left = fade_time;
 	}
@@ -203,10 +200,23 @@ namespace mo {
 				players.push_back(ecs::save_entity(state.em, *p));
 			}
 
+			auto watch = Stopwatch{};
+			auto depth = state.profile.depth+offset;
+
+			// the current state is destroyed by enter_screen
 			state.engine.enter_screen<Game_screen>(
 			            state.profile,
 			            players,
-			            state.profile.depth+offset);
+			            depth);
+
+			if(auto programs = program_cache()) {
+				auto& stats = programs->stats();
+				INFO("Switched to level "<<depth<<" in "<<watch.ms()<<"ms (shader programs: "
+				     <<stats.linked<<" linked, "<<stats.loaded<<" loaded from cache, "
+				     <<stats.reused<<" reused so far)");
+			} else {
+				INFO("Switched to level "<<depth<<" in "<<watch.ms()<<"ms (shader program cache disabled)");
+			}
 		}
 	}
 
@@ -270,7 +280,7 @@ namespace mo {
 		for(auto& screen : vscreens) {
 			glm::mat4 vp = glm::ortho(0.f,1.f,1.f,0.f,-1.f,1.f);
 
-			_lightmap_filter.bind()
+			_lightmap_filter->bind()
 			                .set_uniform("VP", vp)
 			                .set_uniform("texture", 0);
 			screen.vscreen.bind();
@@ -287,14 +297,14 @@ namespace mo {
 #else
 			constexpr int blur_iterations = 9;
 #endif
-			_blur_filter.bind().set_uniform("VP", vp)
+			_blur_filter->bind().set_uniform("VP", vp)
 					.set_uniform("texture", 0);
 
 			int lidx = 0;
 			for(int i=0; i<blur_iterations; ++i) {
 				lidx = lidx==1 ? 0 : 1;
 
-				_blur_filter.bind().set_uniform("horiz", lidx==0);
+				_blur_filter->bind().set_uniform("horiz", lidx==0);
 
 				_lightmap[lidx].bind_target();
 				_lightmap[lidx].set_viewport();
@@ -311,7 +321,7 @@ namespace mo {
 			if(_moving_down || _dying)
 				fade = 1.f-fade;
 
-			_post_effects.bind().set_uniform("VP", vp)
+			_post_effects->bind().set_uniform("VP", vp)
 			        .set_uniform("fade", fade)
 			        .set_uniform("texture", 0)
 			        .set_uniform("saturate", _state->saturation())
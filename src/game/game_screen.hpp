@@ -18,7 +18,7 @@
 #include "game_engine.hpp"
 
 #include <core/ecs/serializer.hpp>
-#include <core/renderer/shader.hpp>
+#include <core/renderer/program_cache.hpp>
 #include <core/renderer/vertex_object.hpp>
 #include "sys/state/state_system.hpp"
 
@@ -81,9 +81,9 @@ namespace mo {
 			util::slot<sys::controller::Controller_added_event> _join_slot;
 			util::slot<sys::controller::Controller_removed_event> _unjoin_slot;
 
-			renderer::Shader_program _post_effects;
-			renderer::Shader_program _lightmap_filter;
-			renderer::Shader_program _blur_filter;
+			renderer::Shader_program_ptr _post_effects;
+			renderer::Shader_program_ptr _lightmap_filter;
+			renderer::Shader_program_ptr _blur_filter;
 			renderer::Object _post_effect_obj;
 			renderer::Framebuffer _lightmap[2];
 
@@ -14,7 +14,7 @@
 
 #include "sys/physics/transform_comp.hpp"
 
-#include "level/level_generator.hpp"
+#include "level/level_pregenerator.hpp"
 
 #include "sys/physics/transform_comp.hpp"
 
@@ -31,8 +31,7 @@ namespace mo {
 		constexpr auto MinEntitySize = 0.05_m;
 		constexpr auto MaxEntitySize = 5_m;
 		constexpr auto MaxEntityVelocity = 90_km/hour;
-
-		auto rng = util::create_random_generator();
+		constexpr auto LevelStreamRadius = 96; //< in tiles; only used for streamed levels
 
 		static Profile_data im_a_savegame{"default", 42,0,0};
 
@@ -42,9 +41,14 @@ namespace mo {
 
 			const level::Level& level;
 
-			bool check_collision(int x, int y)noexcept override {
+			bool check_collision(int x, int y)const noexcept override {
 				return level.solid(x, y);
 			}
+			void collision_map(int left, int top, int width, int height, uint8_t* out)const noexcept override {
+				for(auto y=top; y<top+height; ++y)
+					for(auto x=left; x<left+width; ++x)
+						*out++ = level.solid(x, y) ? 1 : 0;
+			}
 		};
 
 		void set_controller(ecs::Entity& p, sys::controller::Controller& controller) {
@@ -76,7 +80,10 @@ namespace mo {
 
 		profile.depth = depth;
 
-		auto state = std::unique_ptr<Game_state>(new Game_state(engine, profile));
+		auto generated = engine.level_pregenerator().take(profile.seed, depth, profile.difficulty);
+		auto population = std::move(generated.population);
+
+		auto state = std::unique_ptr<Game_state>(new Game_state(engine, profile, std::move(generated.level)));
 
 
 		auto room_m = state->level.find_room(up ? level::Room_type::end :
@@ -120,88 +127,16 @@ namespace mo {
 		}
 
 
-		//spawn:
-
-		state->level.foreach_room([&](const auto& room){
-			auto w = room.width();
-			auto h = room.height();
-			auto center = room.center();
-
-			auto rand_pos = [center,w,h](){
-				return center + glm::vec2{
-					util::random_int(rng,-w/2+2,w/2-2),
-					util::random_int(rng,-h/2+2,h/2-2)
-				};
-			};
-
-			auto spawn = [&](const asset::AID& aid) {
-				ecs::Entity_ptr e = state->em.emplace(aid);
-				e->get<sys::physics::Transform_comp>().get_or_throw().position(rand_pos());
-			};
-
-
-			auto box_count = util::random_int(rng, 0, 2);
-			for(int i=0; i<box_count; i++) {
-				spawn("blueprint:box"_aid);
-			}
-
-			auto barrel_count = util::random_int(rng, 0, 2);
-			for(int i=0; i<barrel_count; i++) {
-				spawn("blueprint:barrel"_aid);
-			}
-
-			if(room.type==level::Room_type::start) {
-				spawn("blueprint:box"_aid);
-
-			} else {
-				auto zombie_count = util::random_int(rng, 2, 5);
-				auto crow_count   = util::random_int(rng, 0, 10);
-
-				for(int i=0; i<zombie_count; i++) {
-					spawn("blueprint:zombie"_aid);
-				}
-				for(int i=0; i<crow_count; i++) {
-					spawn("blueprint:crow"_aid);
-				}
-
-				if(room.type==level::Room_type::end) {
-					auto enemy_count = depth>0 ? util::random_int(rng, 1, 2) : 1;
-
-					auto min_type = 0;
-					auto max_type = 2;
-					if(depth==0)
-						min_type = 2;
-					else if(depth==1)
-						max_type = 1;
-
-					switch(util::random_int(rng, min_type, max_type)) {
-						case 0:
-							for(int i=0; i<enemy_count; i++)
-								spawn("blueprint:pyro"_aid);
-							break;
-
-						case 1:
-							for(int i=0; i<enemy_count; i++)
-								spawn("blueprint:vomit_zombie"_aid);
-							break;
-
-						case 2:
-						default:
-							for(int i=0; i<enemy_count; i++)
-								spawn("blueprint:turret_ice"_aid);
-							break;
-					}
-
-				} else if(depth>0) {
-					if(util::random_bool(rng, 0.3f)) {
-						spawn("blueprint:turret_ice"_aid);
-					}
-				}
-			}
-		});
+		for(auto& spawn : population) {
+			ecs::Entity_ptr e = state->em.emplace(spawn.blueprint);
+			e->get<sys::physics::Transform_comp>().get_or_throw().position(spawn.position * 1_m);
+		}
 
 		state->save();
 
+		// the player will most likely go down next
+		engine.level_pregenerator().request(profile.seed, depth+1, profile.difficulty);
+
 		return state;
 	}
 
@@ -227,7 +162,8 @@ namespace mo {
 		Profile_data profile = Profile_data{};
 		sf2::deserialize_json(stream, profile);
 
-		auto state = std::unique_ptr<Game_state>(new Game_state(engine, profile));
+		auto generated = engine.level_pregenerator().take(profile.seed, profile.depth, profile.difficulty);
+		auto state = std::unique_ptr<Game_state>(new Game_state(engine, profile, std::move(generated.level)));
 
 		state->em.read(stream);
 
@@ -254,6 +190,7 @@ namespace mo {
 			throw util::Error("Load failed: Corrupted savefile!");
 		}
 
+		engine.level_pregenerator().request(profile.seed, profile.depth+1, profile.difficulty);
 
 		return state;
 	}
@@ -262,23 +199,21 @@ namespace mo {
 		return Saveable_state{em, profile};
 	}
 
-	Game_state::Game_state(Game_engine& engine, Profile_data profile)
+	Game_state::Game_state(Game_engine& engine, Profile_data profile, level::Level&& generated_level)
 		: engine(engine),
 	      profile(profile),
-	      level(level::generate_level(engine.assets(),
-									  profile.seed,
-									  profile.depth,
-									  profile.difficulty)),
+	      level(std::move(generated_level)),
 	      em(engine.assets()),
 	      tilemap(engine, level),
 	      transform(em, MaxEntitySize, level.width(), level.height(), level),
-	      particle_renderer(engine.assets(), std::make_unique<My_environment_callback>(level)),
+	      particle_renderer(engine.assets(), engine.thread_pool(), profile.seed*37 + profile.depth,
+	                        std::make_unique<My_environment_callback>(level)),
 	      forcefeedback_handler(&Game_state::forcefeedback, this),
 	      camera(em, engine),
 		  physics(em, transform, MinEntitySize, MaxEntityVelocity, level),
 		  state(em),
 		  controller(em),
-		  ai(em, transform, level),
+		  ai(em, level, engine.thread_pool(), profile.seed*31 + profile.depth),
 		  graphics(em, transform, engine.assets(), particle_renderer, state),
 		  combat(engine.assets(), em, transform, physics, state, effect_bus, forcefeedback_bus),
 	      items(engine.assets(), engine.audio_ctx(), em, physics, transform, state, particle_renderer),
@@ -371,6 +306,14 @@ namespace mo {
 				return dt/10.f;
 		});
 
+		if(main_player) {
+			main_player->get<sys::physics::Transform_comp>().process([&](auto& transform) {
+				level.stream(static_cast<int>(transform.position().x.value()+0.5f),
+				             static_cast<int>(transform.position().y.value()+0.5f),
+				             LevelStreamRadius);
+			});
+		}
+
 		ai.update(wdt);
 		controller.update(dt);
 		transform.update(dt);
@@ -123,7 +123,7 @@ namespace mo {
 		static bool save_exists(Game_engine& engine);
 
 		private:
-			Game_state(Game_engine& engine, Profile_data profile);
+			Game_state(Game_engine& engine, Profile_data profile, level::Level&& generated_level);
 
 			float _screen_saturation=1.f;
 	};
@@ -4,6 +4,10 @@
 #include "../../core/utils/string_utils.hpp"
 
 #include "tiled.hpp"
+#include "level_file.hpp"
+
+#include <iterator>
+#include <stdexcept>
 
 namespace mo {
 namespace level {
@@ -60,9 +64,11 @@ namespace level {
 		return false;
 	}
 	auto Tile::solid(float x, float y)const -> bool {
-		if(solid())
-			return x>=dimensions().x && x<dimensions().z &&
-			       y>=dimensions().y && y<dimensions().w;
+		if(solid()) {
+			auto dim = dimensions();
+			return x>=dim.x && x<dim.z &&
+			       y>=dim.y && y<dim.w;
+		}
 
 		return false;
 	}
@@ -87,16 +93,241 @@ namespace level {
 	float Tile::friction()const {
 		return 1.0f;
 	}
+	void Tile::toggle() {
+		switch(type) {
+			case Tile_type::door_open_ns:   type = Tile_type::door_closed_ns; break;
+			case Tile_type::door_closed_ns: type = Tile_type::door_open_ns;   break;
+			case Tile_type::door_open_we:   type = Tile_type::door_closed_we; break;
+			case Tile_type::door_closed_we: type = Tile_type::door_open_we;   break;
+			default: break;
+		}
+	}
+
+	namespace {
+		struct Tile_type_heights {
+			float heights[tile_type_count];
+
+			Tile_type_heights() {
+				for(auto i=0u; i<tile_type_count; ++i)
+					heights[i] = Tile{static_cast<Tile_type>(i), Elements{}}.height();
+			}
+		};
+		const Tile_type_heights tile_type_heights;
+	}
+
+	Level_chunk::Level_chunk(Tile_type fill) {
+		for(auto& t : tiles)
+			t = Tile{fill, Elements{}};
+
+		update_layers();
+	}
+
+	void Level_chunk::set(int lx, int ly, Tile tile) {
+		tiles[ly*level_chunk_size + lx] = tile;
+		types[ly*level_chunk_size + lx] = static_cast<uint8_t>(tile.type);
+
+		auto bit = uint64_t(1) << lx;
+		if(tile.solid())
+			solid[ly] |= bit;
+		else
+			solid[ly] &= ~bit;
+
+		modified = true;
+	}
+
+	void Level_chunk::update_layers() {
+		for(auto ly=0; ly<level_chunk_size; ++ly) {
+			auto row = uint64_t(0);
+			for(auto lx=0; lx<level_chunk_size; ++lx) {
+				auto& tile = tiles[ly*level_chunk_size + lx];
+				types[ly*level_chunk_size + lx] = static_cast<uint8_t>(tile.type);
+				if(tile.solid())
+					row |= uint64_t(1) << lx;
+			}
+			solid[ly] = row;
+		}
+	}
+
+	namespace {
+		/// shared by all chunks that are currently not loaded
+		auto wall_chunk() -> const std::shared_ptr<Level_chunk>& {
+			static const auto chunk = std::make_shared<Level_chunk>(Tile_type::indestructible_wall);
+			return chunk;
+		}
+	}
 
 	Level::Level(Tile_type default_type, int width, int height, std::vector<Room> rooms)
-		: _width(width), _height(height), _tiles(width*height, Tile{default_type, Elements{}}), _rooms(rooms) {
+		: _rooms(rooms) {
+		_reset(width, height, default_type);
 	}
 
 	Level::Level(int width, int height, std::vector<Tile> data, std::vector<Room> rooms)
-		: _width(width), _height(height), _tiles(data), _rooms(rooms) {
+		: _rooms(rooms) {
+		INVARIANT(data.size()==static_cast<std::size_t>(width*height), "Size of tile data doesn't match the level");
+
+		_reset(width, height, Tile_type::indestructible_wall);
+		for(auto y=0; y<height; ++y)
+			for(auto x=0; x<width; ++x)
+				_set(x, y, data[y*width + x]);
+	}
+
+	Level::Level() {
+		_reset(0, 0, Tile_type::indestructible_wall);
+	}
+
+	auto Level::get(int x, int y)const -> const Tile& {
+		if(x<0 || y<0 || x>=_width || y>=_height)
+			throw std::out_of_range("Tile "+to_string(x)+"/"+to_string(y)+" is outside of the level");
+
+		return _tile(x,y);
+	}
+
+	void Level::set(int x, int y, Tile_type type) {
+		auto tile = get(x,y);
+		tile.type = type;
+		_set(x, y, tile);
+	}
+
+	auto Level::height(int x, int y)const noexcept -> float {
+		return tile_type_heights.heights[static_cast<std::size_t>(tile_type(x,y))];
+	}
+
+	auto Level::resident_chunks()const noexcept -> std::size_t {
+		return static_cast<std::size_t>(std::count_if(_chunks.begin(), _chunks.end(), [](auto& c) {
+			return c.use_count()==1;
+		}));
+	}
+
+	void Level::_reset(int width, int height, Tile_type fill) {
+		_width = width;
+		_height = height;
+		_chunks_x = (width +2*chunk_border + level_chunk_size-1) / level_chunk_size;
+		_chunks_y = (height+2*chunk_border + level_chunk_size-1) / level_chunk_size;
+
+		_chunk_source.reset();
+		_streamed_chunks.clear();
+
+		_modifications.clear();
+		_modifications_since = _revision;
+
+		// all chunks share the same content until they are modified
+		auto fill_chunk = fill==Tile_type::indestructible_wall ? wall_chunk()
+		                                                       : std::make_shared<Level_chunk>(fill);
+		_chunks.assign(static_cast<std::size_t>(_chunks_x*_chunks_y), fill_chunk);
+
+		if(fill!=Tile_type::indestructible_wall) {
+			for(auto i=0; i<_chunks_x*_chunks_y; ++i) {
+				auto cx = i % _chunks_x;
+				auto cy = i / _chunks_x;
+				auto edge = cx==0 || cy==0 || cx==_chunks_x-1 || cy==_chunks_y-1;
+				if(edge) {
+					_chunks[i] = std::make_shared<Level_chunk>(*fill_chunk);
+					_seal_chunk(i, *_chunks[i]);
+				}
+			}
+		}
+	}
+
+	auto Level::_mutable_chunk(int x, int y) -> Level_chunk& {
+		auto& chunk = _chunks[_chunk_index(x,y)];
+		if(chunk.use_count()>1)
+			chunk = std::make_shared<Level_chunk>(*chunk);
+
+		return *chunk;
+	}
+
+	void Level::_set(int x, int y, Tile tile) {
+		_mutable_chunk(x,y).set(_local(x), _local(y), tile);
+	}
+
+	void Level::_seal_chunk(int chunk_index, Level_chunk& chunk) {
+		auto origin_x = chunk_index%_chunks_x * level_chunk_size - chunk_border;
+		auto origin_y = chunk_index/_chunks_x * level_chunk_size - chunk_border;
+
+		for(auto ly=0; ly<level_chunk_size; ++ly) {
+			for(auto lx=0; lx<level_chunk_size; ++lx) {
+				auto x = origin_x+lx;
+				auto y = origin_y+ly;
+				if(x<0 || y<0 || x>=_width || y>=_height)
+					chunk.set(lx, ly, Tile{Tile_type::indestructible_wall, Elements{}});
+			}
+		}
+	}
+
+	void Level::load(std::shared_ptr<Level_chunk_source> source, int width, int height,
+	                 std::vector<Room> rooms) {
+		_revision++;
+		_content_revision++;
+		_reset(width, height, Tile_type::indestructible_wall);
+		_rooms = std::move(rooms);
+		_chunk_source = std::move(source);
 	}
 
-	Level::Level() : _width(0), _height(0) {
+	void Level::stream(int x, int y, int radius) {
+		if(!_chunk_source)
+			return;
+
+		auto min_cx = std::max(0, (x-radius+chunk_border) / level_chunk_size);
+		auto min_cy = std::max(0, (y-radius+chunk_border) / level_chunk_size);
+		auto max_cx = std::min(_chunks_x-1, (x+radius+chunk_border) / level_chunk_size);
+		auto max_cy = std::min(_chunks_y-1, (y+radius+chunk_border) / level_chunk_size);
+
+		auto in_range = [&](int i) {
+			auto cx = i % _chunks_x;
+			auto cy = i / _chunks_x;
+			return cx>=min_cx && cx<=max_cx && cy>=min_cy && cy<=max_cy;
+		};
+
+		auto changed = false;
+		auto modified = std::vector<int>{};
+
+		// evict chunks that are out of range
+		auto evicted = std::remove_if(_streamed_chunks.begin(), _streamed_chunks.end(), [&](int i) {
+			if(in_range(i))
+				return false;
+
+			auto& chunk = *_chunks[i];
+			if(chunk.modified)
+				_chunk_source->store(i%_chunks_x * level_chunk_size - chunk_border,
+				                     i/_chunks_x * level_chunk_size - chunk_border, chunk);
+
+			_chunks[i] = wall_chunk();
+			modified.push_back(i);
+			changed = true;
+			return true;
+		});
+		_streamed_chunks.erase(evicted, _streamed_chunks.end());
+
+		// load missing chunks
+		for(auto cy=min_cy; cy<=max_cy; ++cy) {
+			for(auto cx=min_cx; cx<=max_cx; ++cx) {
+				auto i = cy*_chunks_x + cx;
+				if(_chunks[i]!=wall_chunk())
+					continue;
+
+				auto chunk = std::make_shared<Level_chunk>();
+				_chunk_source->load(cx*level_chunk_size - chunk_border,
+				                    cy*level_chunk_size - chunk_border, *chunk);
+				chunk->update_layers();
+				_seal_chunk(i, *chunk);
+				chunk->modified = false;
+
+				_chunks[i] = std::move(chunk);
+				_streamed_chunks.push_back(i);
+				modified.push_back(i);
+				changed = true;
+			}
+		}
+
+		// same content, so only _revision changes and the chunks are logged as modified
+		if(changed) {
+			_revision++;
+			for(auto i : modified)
+				_log_modification(i%_chunks_x * level_chunk_size - chunk_border,
+				                  i/_chunks_x * level_chunk_size - chunk_border,
+				                  (i%_chunks_x+1) * level_chunk_size - chunk_border - 1,
+				                  (i/_chunks_x+1) * level_chunk_size - chunk_border - 1);
+		}
 	}
 
 	auto Level::find_room(Room_type type)const -> maybe<const Room&> {
@@ -105,36 +336,128 @@ namespace level {
 		return found!=_rooms.end() ? just(*found) : nothing();
 	}
 
+	auto Level::room_at(int x, int y)const -> maybe<const Room&> {
+		auto found = std::find_if(_rooms.begin(), _rooms.end(), [x,y](auto& r){
+			return x>=r.left && x<r.right && y>=r.top && y<r.bottom;
+		});
+
+		return found!=_rooms.end() ? just(*found) : nothing();
+	}
+
+	void Level::toggle(int x, int y) {
+		auto tile = get(x,y);
+		tile.toggle();
+		_set(x, y, tile);
+		_revision++;
+		_content_revision++;
+		_log_modification(x, y, x, y);
+	}
+
+	void Level::_log_modification(int min_x, int min_y, int max_x, int max_y) {
+		constexpr auto max_modifications = std::size_t(256);
+
+		if(_modifications.size()>=max_modifications) {
+			auto drop = _modifications.begin() + max_modifications/2;
+			_modifications_since = std::prev(drop)->revision;
+			_modifications.erase(_modifications.begin(), drop);
+		}
+
+		_modifications.push_back(Modification{_revision, min_x, min_y, max_x, max_y});
+	}
+
 	void Level::load(std::istream& stream) {
+		auto magic = uint32_t(0);
+		stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		auto binary = stream.gcount()==sizeof(magic) && is_level_file(&magic, sizeof(magic));
+
+		stream.clear();
+		stream.seekg(0);
+
+		if(!binary) {
+			import_tiled(stream);
+			return;
+		}
+
+		auto data = std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		load(Level_file_view{data.data(), data.size()});
+	}
+
+	void Level::load(const Level_file_view& file) {
+		_revision++;
+		_content_revision++;
+		_reset(file.width(), file.height(), Tile_type::indestructible_wall);
+
+		auto types = file.types();
+		auto elements = file.elements();
+		for(auto y=0; y<_height; ++y) {
+			for(auto x=0; x<_width; ++x) {
+				auto i = y*_width + x;
+				_set(x, y, Tile{static_cast<Tile_type>(types[i]), Elements{elements[i]}});
+			}
+		}
+
+		_rooms.clear();
+		_rooms.reserve(file.room_count());
+		for(auto i=0u; i<file.room_count(); ++i) {
+			auto& r = file.rooms()[i];
+			_rooms.emplace_back(r.top, r.left, r.right, r.bottom, static_cast<Room_type>(r.type), i);
+		}
+
+		_load(file);
+	}
+
+	void Level::store(std::ostream& stream)const {
+		auto objects = std::vector<Level_file_object>{};
+		_store(objects);
+
+		write_level_file(stream, *this, objects);
+	}
+
+	void Level::import_tiled(std::istream& stream) {
 		const TiledLevel level_data = parse_level(stream);
 
-		_width = level_data.width;
-		_height = level_data.height;
-		_tiles.reserve(_width*_height);
+		_revision++;
+		_content_revision++;
 
 		auto layer = std::find_if(begin(level_data.layers), end(level_data.layers),
 		                          [](const TiledLayer& l){return l.name=="main";} );
 
 		INVARIANT(layer!=level_data.layers.end(), "No 'main'-Layer in file.");
+		INVARIANT(layer->data.size()==static_cast<std::size_t>(level_data.width*level_data.height),
+		          "Size of the 'main'-Layer doesn't match the level");
 
+		auto tiles = std::vector<Tile>();
+		tiles.reserve(layer->data.size());
+
+		// tiled uses 1-based tile ids (0 = no tile)
 		for(const auto& d : layer->data) {
-			INVARIANT(d>=0 && static_cast<std::size_t>(d)<tile_type_count, "Invalid tile_type");
-			_tiles.push_back(Tile{static_cast<Tile_type>(d), Elements{}});
+			INVARIANT(d>=0 && static_cast<std::size_t>(d)<=tile_type_count, "Invalid tile_type");
+			auto type = d>0 ? static_cast<Tile_type>(d-1) : Tile_type::indestructible_wall;
+			tiles.push_back(Tile{type, Elements{}});
 		}
 
 		for(auto& l : level_data.layers) {
 			if(l.type=="tilelayer" && starts_with(l.name, "element")) {
-				int i=0;
+				auto i = 0u;
 				for(const auto& d : l.data) {
+					if(i>=tiles.size())
+						break;
+
 					if(d>0 && static_cast<std::size_t>(d)<element_count)
-						_tiles[i++].elements |= static_cast<Element>(d);
+						tiles[i].elements |= static_cast<Element>(d);
+					i++;
 				}
 			}
 		}
 
+		_reset(level_data.width, level_data.height, Tile_type::indestructible_wall);
+		for(auto y=0; y<_height; ++y)
+			for(auto x=0; x<_width; ++x)
+				_set(x, y, tiles[y*_width + x]);
+
 		_load(level_data);
 	}
-	void Level::store(std::ostream& stream)const {
+	void Level::export_tiled(std::ostream& stream)const {
 		TiledLevel level_data;
 		level_data.width = _width;
 		level_data.height = _height;
@@ -144,15 +467,20 @@ namespace level {
 		auto& tile_layer = level_data.add_layer("main", "tilelayer");
 
 		auto max_elements = 0ul;
-		for(auto& t : _tiles) {
-			tile_layer.data.push_back(static_cast<int>(t.type));
-			max_elements = std::max(max_elements, static_cast<unsigned long>(t.elements.size()));
+		for(auto y=0; y<_height; ++y) {
+			for(auto x=0; x<_width; ++x) {
+				auto& t = _tile(x,y);
+				tile_layer.data.push_back(static_cast<int>(t.type)+1);
+				max_elements = std::max(max_elements, static_cast<unsigned long>(t.elements.size()));
+			}
 		}
 
 		for(auto i : range(max_elements)) {
 			auto& element_layer = level_data.add_layer("element-" + to_string(i), "tilelayer");
-			for(auto& t : _tiles) {
-				element_layer.data.push_back(static_cast<int>(t.elements[i]));
+			for(auto y=0; y<_height; ++y) {
+				for(auto x=0; x<_width; ++x) {
+					element_layer.data.push_back(static_cast<int>(_tile(x,y).elements[i]));
+				}
 			}
 		}
 
@@ -162,4 +490,16 @@ namespace level {
 	}
 
 }
+
+namespace asset {
+	auto Loader<level::Level>::load(istream in) -> std::shared_ptr<level::Level> {
+		auto l = std::make_shared<level::Level>();
+		level::load_level_asset(*l, in);
+		return l;
+	}
+
+	void Loader<level::Level>::store(ostream out, const level::Level& level) {
+		level.store(out);
+	}
+}
 }
@@ -16,7 +16,9 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <iostream>
+#include <cstdint>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 
@@ -27,6 +29,8 @@
 namespace mo {
 namespace level {
 	struct TiledLevel;
+	class Level_file_view;
+	struct Level_file_object;
 
 	enum class Tile_type {
 		indestructible_wall,
@@ -88,45 +92,207 @@ namespace level {
 		}
 	};
 
+	/// number of tiles per side of a chunk; has to match the bits of a row in Level_chunk::solid
+	constexpr int level_chunk_size = 64;
+
+	/**
+	 * A square block of tiles with its derived layers.
+	 * Chunk-local coordinates are relative to the chunk origin.
+	 */
+	struct Level_chunk {
+		Tile     tiles[level_chunk_size*level_chunk_size];
+		uint64_t solid[level_chunk_size]; //< one bit per tile, one word per row
+		uint8_t  types[level_chunk_size*level_chunk_size]; //< Tile_type of each tile
+		bool modified = false; //< changed since it has been created or loaded
+
+		explicit Level_chunk(Tile_type fill=Tile_type::indestructible_wall);
+
+		auto tile(int lx, int ly)const noexcept -> const Tile& {
+			return tiles[ly*level_chunk_size + lx];
+		}
+		auto is_solid(int lx, int ly)const noexcept -> bool {
+			return (solid[ly] >> lx) & 1u;
+		}
+
+		void set(int lx, int ly, Tile tile);
+
+		/// rebuilds the layers after the tiles have been written directly
+		void update_layers();
+	};
+
+	/**
+	 * Provides the content of the chunks of a streamed level (see Level::stream()).
+	 * The methods are only called from the thread calling Level::stream().
+	 */
+	class Level_chunk_source {
+		public:
+			virtual ~Level_chunk_source() = default;
+
+			/// fills chunk.tiles with the tiles starting at (x,y); layers are updated by the caller
+			virtual void load(int x, int y, Level_chunk& chunk) = 0;
+
+			/// called before a modified chunk is evicted, so the modifications can be kept
+			virtual void store(int x, int y, const Level_chunk& chunk) {}
+	};
+
 	class Level {
 		public:
 			Level(Tile_type default_type, int width, int height, std::vector<Room> rooms=std::vector<Room>());
 			Level(int width, int height, std::vector<Tile> data, std::vector<Room> rooms=std::vector<Room>());
 			Level();
 
+			/// writes the binary level format (see level_file.hpp)
 			void store(std::ostream& stream)const;
+			/// reads a binary level or a Tiled JSON map
 			void load(std::istream& stream);
+			void load(const Level_file_view& file);
+
+			/**
+			 * Replaces the content of the level with chunks provided by the source.
+			 * Only the chunks around the positions passed to stream() are resident,
+			 *   all other tiles are indestructible walls.
+			 */
+			void load(std::shared_ptr<Level_chunk_source> source, int width, int height,
+			          std::vector<Room> rooms);
 
-			auto& get(int x, int y)      {return _tiles.at(y*_width + x);}
-			auto& get(int x, int y)const {return _tiles.at(y*_width + x);}
+			/**
+			 * Loads all chunks within radius (in tiles) of (x,y) and evicts all others.
+			 * Does nothing if the level has no chunk source.
+			 * Not thread-safe; must not be called while the level is being read.
+			 */
+			void stream(int x, int y, int radius);
+
+			/// importer/exporter for the Tiled JSON format, used to edit levels
+			void import_tiled(std::istream& stream);
+			void export_tiled(std::ostream& stream)const;
+
+			auto get(int x, int y)const -> const Tile&;
+
+			/// changes the type of a tile (keeps the derived layers up to date)
+			void set(int x, int y, Tile_type type);
 
 			// handler = void(int x, int y, const Tile& tile)
 			template<typename F>
 			void foreach_tile(int min_x, int min_y, int max_x, int max_y, F handler)const;
 
-			auto solid     (int x, int y)const {return x>=0 && y>=0 && x<_width && y<_height ? get(x,y).solid() : true;}
+			/// everything outside of the level is solid
+			auto solid(int x, int y)const noexcept -> bool {
+				return _in_chunks(x,y) ? solid_unchecked(x,y) : true;
+			}
+			/// only valid for -1<=x<=width and -1<=y<=height
+			auto solid_unchecked(int x, int y)const noexcept -> bool {
+				return _chunk(x,y).is_solid(_local(x), _local(y));
+			}
 			auto solid_real(float rx, float ry)const {
 				auto x = static_cast<int>(rx+0.5f);
 				auto y = static_cast<int>(ry+0.5f);
-				return x>=0 && y>=0 && x<_width && y<_height ? get(x,y).solid(rx-x, ry-y) : true;
+				if(!solid(x,y))
+					return false;
+
+				return x>=0 && y>=0 && x<_width && y<_height ? _tile(x,y).solid(rx-x, ry-y) : true;
+			}
+			auto tile_type(int x, int y)const noexcept -> Tile_type {
+				return static_cast<Tile_type>(_in_chunks(x,y) ? _chunk(x,y).types[_local(y)*level_chunk_size + _local(x)]
+				                                              : static_cast<uint8_t>(Tile_type::indestructible_wall));
 			}
-			auto friction  (int x, int y)const {return x>=0 && y>=0 && x<_width && y<_height ? get(x,y).friction() : 1.f;}
+			auto height(int x, int y)const noexcept -> float;
+			auto friction  (int x, int y)const {return x>=0 && y>=0 && x<_width && y<_height ? _tile(x,y).friction() : 1.f;}
 
 			auto width()  const noexcept     {return _width;}
 			auto height() const noexcept     {return _height;}
 
+			/// number of chunks that are not shared with other chunks or levels
+			auto resident_chunks()const noexcept -> std::size_t;
+
+			/// toggles the tile (e.g. opens/closes a door) and updates the revision
+			void toggle(int x, int y);
+
+			/// incremented on every change of the resident tiles (incl. streamed chunks)
+			auto revision()const noexcept {return _revision;}
+
+			/**
+			 * Incremented when the content of the level changes (load, toggle), but not
+			 *   when chunks are streamed in or out, because they contain the same tiles
+			 *   as before. Data derived from the whole level only has to be rebuilt if
+			 *   this changes; streamed chunks are reported by foreach_modification().
+			 */
+			auto content_revision()const noexcept {return _content_revision;}
+
+			/**
+			 * Calls handler(min_x, min_y, max_x, max_y) (inclusive, in tiles) for the
+			 *   areas that have been modified after the given revision.
+			 * Returns false if these are not known (e.g. the level has been reloaded
+			 *   or there have been too many modifications), so everything has to be updated.
+			 */
+			template<typename F>
+			auto foreach_modification(uint32_t since_revision, F handler)const -> bool;
+
 			auto find_room(Room_type type)const -> util::maybe<const Room&>;
+			auto room_at(int x, int y)const -> util::maybe<const Room&>;
+			auto room(std::size_t id)const -> const Room& {return _rooms.at(id);} //< ids are the indices
+			auto room_count()const noexcept {return _rooms.size();}
 			template<typename F>
 			void foreach_room(F handler);
 
 		protected:
 			virtual void _store(TiledLevel&)const {}
 			virtual void _load(const TiledLevel&) {}
+			virtual void _store(std::vector<Level_file_object>&)const {}
+			virtual void _load(const Level_file_view&) {}
 
 			int _width;
 			int _height;
-			std::vector<Tile> _tiles;
 			std::vector<Room> _rooms;
+			uint32_t _revision = 0;
+			uint32_t _content_revision = 0;
+
+		private:
+			// chunk coordinates are shifted by a solid border of one tile, so queries
+			//   directly next to the level need no bounds checks
+			static constexpr int chunk_border = 1;
+
+			auto _in_chunks(int x, int y)const noexcept -> bool {
+				return static_cast<unsigned>(x+chunk_border) < static_cast<unsigned>(_width +2*chunk_border)
+				    && static_cast<unsigned>(y+chunk_border) < static_cast<unsigned>(_height+2*chunk_border);
+			}
+			static auto _local(int v)noexcept -> int {
+				return static_cast<int>(static_cast<unsigned>(v+chunk_border) % level_chunk_size);
+			}
+			auto _chunk_index(int x, int y)const noexcept -> int {
+				return static_cast<int>(static_cast<unsigned>(y+chunk_border) / level_chunk_size) * _chunks_x
+				     + static_cast<int>(static_cast<unsigned>(x+chunk_border) / level_chunk_size);
+			}
+			auto _chunk(int x, int y)const noexcept -> const Level_chunk& {
+				return *_chunks[_chunk_index(x,y)];
+			}
+			auto _tile(int x, int y)const noexcept -> const Tile& {
+				return _chunk(x,y).tile(_local(x), _local(y));
+			}
+
+			/// resets the level to the given size, filled with the given type
+			void _reset(int width, int height, Tile_type fill);
+			/// copies the chunk if it's shared (copy-on-write)
+			auto _mutable_chunk(int x, int y) -> Level_chunk&;
+			void _set(int x, int y, Tile tile);
+			/// overwrites all tiles of the chunk outside of the level with indestructible walls
+			void _seal_chunk(int chunk_index, Level_chunk& chunk);
+
+			int _chunks_x = 0;
+			int _chunks_y = 0;
+			std::vector<std::shared_ptr<Level_chunk>> _chunks; //< never null; unchanged chunks are shared
+
+			std::shared_ptr<Level_chunk_source> _chunk_source;
+			std::vector<int> _streamed_chunks; //< indices of the chunks loaded from _chunk_source
+
+			struct Modification {
+				uint32_t revision;
+				int min_x, min_y, max_x, max_y;
+			};
+			std::vector<Modification> _modifications; //< oldest first
+			uint32_t _modifications_since = 0; //< all modifications after this revision are known
+
+			/// has to be called after _revision has been incremented
+			void _log_modification(int min_x, int min_y, int max_x, int max_y);
 	};
 
 	template<typename F>
@@ -140,11 +306,22 @@ namespace level {
 
 		for(auto y : range(min_y, max_y)) {
 			for(auto x : range(min_x, max_x)) {
-				handler(x,y, _tiles[y*_width + x]);
+				handler(x,y, _tile(x,y));
 			}
 		}
 	}
 	template<typename F>
+	auto Level::foreach_modification(uint32_t since_revision, F handler)const -> bool {
+		if(since_revision<_modifications_since)
+			return false;
+
+		for(auto& m : _modifications)
+			if(m.revision>since_revision)
+				handler(m.min_x, m.min_y, m.max_x, m.max_y);
+
+		return true;
+	}
+	template<typename F>
 	void Level::foreach_room(F handler) {
 		for(auto& r : _rooms)
 			handler(r);
@@ -155,17 +332,8 @@ namespace level {
 namespace asset {
 	template<>
 	struct Loader<level::Level> {
-		using RT = std::shared_ptr<const level::Level>;
-
-		RT operator()(istream in) {
-			auto l = std::make_shared<level::Level>();
-			l->load(in);
-			return l;
-		}
-
-		void operator()(ostream out, const level::Level& level) {
-			level.store(out);
-		}
+		static auto load(istream in) -> std::shared_ptr<level::Level>;
+		static void store(ostream out, const level::Level& level);
 	};
 }
 }
@@ -0,0 +1,139 @@
+#include "level_cache.hpp"
+
+#include "level_file.hpp"
+#include "level_generator.hpp"
+
+#include "../../core/asset/asset_manager.hpp"
+#include "../../core/utils/log.hpp"
+#include "../../core/utils/mapped_file.hpp"
+#include "../../core/utils/stopwatch.hpp"
+
+#include <cstring>
+#include <sstream>
+
+namespace mo {
+namespace level {
+
+	namespace {
+		constexpr auto cache_prefix = "level_cache_";
+		constexpr auto cache_suffix = ".mlvl";
+
+		class Fnv1a {
+			public:
+				void add(uint64_t v)noexcept {
+					for(auto i=0; i<8; ++i, v>>=8) {
+						_hash ^= v & 0xff;
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				void add(float v)noexcept {
+					uint32_t bits;
+					std::memcpy(&bits, &v, sizeof(bits));
+					add(static_cast<uint64_t>(bits));
+				}
+				auto value()const noexcept {return _hash;}
+
+			private:
+				uint64_t _hash = 0xcbf29ce484222325ull;
+		};
+
+		auto config_hash(const Dungeon_cfg& cfg) {
+			auto h = Fnv1a{};
+			h.add(static_cast<uint64_t>(generator_version));
+			h.add(static_cast<uint64_t>(cfg.room_size.min));
+			h.add(static_cast<uint64_t>(cfg.room_size.max));
+			h.add(static_cast<uint64_t>(cfg.rooms.min));
+			h.add(static_cast<uint64_t>(cfg.rooms.max));
+			h.add(static_cast<uint64_t>(cfg.max_width));
+			h.add(static_cast<uint64_t>(cfg.max_height));
+			h.add(cfg.split_prop_factor);
+			return h.value();
+		}
+
+		auto seed_prefix(uint64_t seed) {
+			std::stringstream s;
+			s<<cache_prefix<<std::hex<<seed<<"_";
+			return s.str();
+		}
+		auto slot_prefix(uint64_t seed, int depth, int difficulty) {
+			std::stringstream s;
+			s<<seed_prefix(seed)<<depth<<"_"<<difficulty<<"_";
+			return s.str();
+		}
+
+		/// e.g. gen:level_cache_<seed>_<depth>_<difficulty>_<config-hash>.mlvl
+		auto entry_aid(const Dungeon_cfg& cfg, uint64_t seed, int depth, int difficulty) {
+			std::stringstream s;
+			s<<slot_prefix(seed, depth, difficulty)<<std::hex<<config_hash(cfg)<<cache_suffix;
+			return asset::AID{asset::Asset_type::gen, s.str()};
+		}
+
+		auto starts_with(const std::string& str, const std::string& prefix) {
+			return str.compare(0, prefix.size(), prefix)==0;
+		}
+		auto ends_with(const std::string& str, const std::string& suffix) {
+			return str.size()>=suffix.size() && str.compare(str.size()-suffix.size(), suffix.size(), suffix)==0;
+		}
+	}
+
+	Level_cache::Level_cache(asset::Asset_manager& assets) : _assets(assets) {
+	}
+
+	auto Level_cache::contains(const Dungeon_cfg& cfg, uint64_t seed, int depth, int difficulty)const -> bool {
+		// load() maps the file directly, so an entry it can't open doesn't count
+		return _assets.physical_location(entry_aid(cfg, seed, depth, difficulty)).is_some();
+	}
+
+	auto Level_cache::load(const Dungeon_cfg& cfg, uint64_t seed,
+	                       int depth, int difficulty) -> util::maybe<Level> {
+		auto aid = entry_aid(cfg, seed, depth, difficulty);
+
+		auto path = _assets.physical_location(aid);
+		if(path.is_nothing())
+			return util::nothing();
+
+		auto watch = util::Stopwatch{};
+
+		try {
+			auto file = util::Mapped_file{path.get_or_throw()};
+			if(!file.valid())
+				throw asset::Loading_failed("Unable to open \""+path.get_or_throw()+"\"");
+
+			auto level = Level{};
+			load_level_file(level, Level_file_view{file.data(), file.size()}, path.get_or_throw());
+
+			INFO("Loaded cached level "<<depth<<" in "<<watch.ms()<<"ms");
+			return level;
+
+		} catch(asset::Loading_failed& e) {
+			WARN("Discarding corrupted level cache entry "<<aid.str()<<": "<<e.what());
+			_assets.erase(aid);
+			return util::nothing();
+		}
+	}
+
+	void Level_cache::store(const Dungeon_cfg& cfg, uint64_t seed, int depth,
+	                        int difficulty, const Level& level) {
+		auto aid = entry_aid(cfg, seed, depth, difficulty);
+
+		// entries of other playthroughs and outdated entries of this slot will never be used again
+		auto seed_entries = seed_prefix(seed);
+		auto slot_entries = slot_prefix(seed, depth, difficulty);
+		for(auto& entry : _assets.list(asset::Asset_type::gen, cache_prefix)) {
+			auto name = entry.name();
+			if(!ends_with(name, cache_suffix))
+				continue;
+
+			if(!starts_with(name, seed_entries) || (starts_with(name, slot_entries) && entry!=aid)) {
+				DEBUG("Removing stale level cache entry "<<entry.str());
+				_assets.erase(entry);
+			}
+		}
+
+		auto watch = util::Stopwatch{};
+		_assets.save(aid, level);
+		DEBUG("Stored level "<<depth<<" in cache ("<<watch.ms()<<"ms)");
+	}
+
+}
+}
@@ -0,0 +1,57 @@
+/**************************************************************************\
+ * caches generated levels in the write directory                         *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include "level.hpp"
+
+#include "../../core/asset/aid.hpp"
+#include "../../core/utils/maybe.hpp"
+
+#include <cstdint>
+
+namespace mo {
+	namespace asset {class Asset_manager;}
+
+namespace level {
+	struct Dungeon_cfg;
+
+	/**
+	 * Stores generated levels in the binary level format, so loading a savegame
+	 *   or reentering a depth doesn't have to generate them again.
+	 * The entries are keyed by seed, depth and difficulty and contain a hash
+	 *   of the generator version and the config in their name. Entries with an
+	 *   outdated hash and entries of other seeds (i.e. finished playthroughs)
+	 *   are deleted when a new level is stored.
+	 * Levels larger than level_stream_min_tiles are streamed from their entry.
+	 * Not thread-safe, like the Asset_manager it uses.
+	 */
+	class Level_cache {
+		public:
+			Level_cache(asset::Asset_manager& assets);
+
+			auto contains(const Dungeon_cfg& cfg, uint64_t seed, int depth, int difficulty)const -> bool;
+
+			auto load(const Dungeon_cfg& cfg, uint64_t seed, int depth, int difficulty) -> util::maybe<Level>;
+
+			void store(const Dungeon_cfg& cfg, uint64_t seed, int depth, int difficulty, const Level& level);
+
+		private:
+			asset::Asset_manager& _assets;
+	};
+
+}
+}
@@ -0,0 +1,196 @@
+#include "level_file.hpp"
+
+#include "../../core/asset/stream.hpp"
+#include "../../core/utils/mapped_file.hpp"
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace mo {
+namespace level {
+
+	using std::to_string;
+
+	namespace {
+		constexpr auto section_alignment = uint32_t(4);
+
+		auto chunk_key(int x, int y) {
+			return (static_cast<uint64_t>(static_cast<uint32_t>(x))<<32) | static_cast<uint32_t>(y);
+		}
+
+		auto open_mapped(const std::string& path) {
+			auto file = util::Mapped_file{path};
+			if(!file.valid())
+				throw asset::Loading_failed("Unable to open binary level \""+path+"\"");
+
+			return file;
+		}
+
+		auto align(std::size_t offset) -> uint32_t {
+			return static_cast<uint32_t>((offset + section_alignment-1) / section_alignment * section_alignment);
+		}
+
+		void check_section(const Level_file_header& h, uint32_t offset, std::size_t size, const char* name) {
+			if(offset%section_alignment!=0 || offset<h.header_size
+			   || offset>h.file_size || size>h.file_size-offset)
+				throw asset::Loading_failed(std::string("Invalid ")+name+" section in binary level");
+		}
+	}
+
+	bool is_level_file(const void* data, std::size_t size)noexcept {
+		if(size<sizeof(uint32_t))
+			return false;
+
+		uint32_t magic;
+		std::memcpy(&magic, data, sizeof(magic));
+		return magic==level_file_magic;
+	}
+
+	Level_file_view::Level_file_view(const uint8_t* data, std::size_t size) : _data(data) {
+		if(size<sizeof(Level_file_header) || !is_level_file(data, size))
+			throw asset::Loading_failed("Not a binary level");
+
+		std::memcpy(&_header, data, sizeof(_header));
+
+		if(_header.version!=level_file_version)
+			throw asset::Loading_failed("Unsupported version of binary level: "+to_string(_header.version));
+
+		if(_header.header_size<sizeof(Level_file_header) || _header.file_size>size)
+			throw asset::Loading_failed("Truncated binary level");
+
+		if(_header.width<0 || _header.height<0)
+			throw asset::Loading_failed("Invalid size of binary level");
+
+		auto tiles = static_cast<std::size_t>(_header.width) * static_cast<std::size_t>(_header.height);
+		check_section(_header, _header.types_offset,    tiles, "types");
+		check_section(_header, _header.elements_offset, tiles*sizeof(uint16_t), "elements");
+		check_section(_header, _header.rooms_offset,    _header.room_count*sizeof(Level_file_room), "rooms");
+		check_section(_header, _header.objects_offset,  _header.object_count*sizeof(Level_file_object), "objects");
+
+		// types is the only unchecked plane that could contain garbage
+		for(auto i=0u; i<tiles; ++i)
+			if(types()[i]>=tile_type_count)
+				throw asset::Loading_failed("Invalid tile_type in binary level");
+	}
+
+	void write_level_file(std::ostream& out, const Level& level,
+	                      const std::vector<Level_file_object>& objects) {
+		auto tiles = static_cast<std::size_t>(level.width()) * static_cast<std::size_t>(level.height());
+
+		auto h = Level_file_header{};
+		h.magic           = level_file_magic;
+		h.version         = level_file_version;
+		h.header_size     = sizeof(Level_file_header);
+		h.width           = level.width();
+		h.height          = level.height();
+		h.room_count      = static_cast<uint32_t>(level.room_count());
+		h.object_count    = static_cast<uint32_t>(objects.size());
+		h.types_offset    = align(h.header_size);
+		h.elements_offset = align(h.types_offset + tiles);
+		h.rooms_offset    = align(h.elements_offset + tiles*sizeof(uint16_t));
+		h.objects_offset  = align(h.rooms_offset + h.room_count*sizeof(Level_file_room));
+		h.file_size       = align(h.objects_offset + h.object_count*sizeof(Level_file_object));
+
+		auto data = std::vector<uint8_t>(h.file_size, 0);
+		std::memcpy(data.data(), &h, sizeof(h));
+
+		auto types = data.data() + h.types_offset;
+		auto elements = data.data() + h.elements_offset;
+		for(auto y=0; y<level.height(); ++y) {
+			for(auto x=0; x<level.width(); ++x) {
+				auto i = static_cast<std::size_t>(y*level.width() + x);
+				auto& tile = level.get(x,y);
+				types[i] = static_cast<uint8_t>(tile.type);
+				std::memcpy(elements + i*sizeof(uint16_t), &tile.elements.value, sizeof(uint16_t));
+			}
+		}
+
+		for(auto i=0u; i<h.room_count; ++i) {
+			auto& r = level.room(i);
+			auto fr = Level_file_room{r.top, r.left, r.right, r.bottom, static_cast<uint32_t>(r.type)};
+			std::memcpy(data.data() + h.rooms_offset + i*sizeof(Level_file_room), &fr, sizeof(fr));
+		}
+
+		if(!objects.empty())
+			std::memcpy(data.data() + h.objects_offset, objects.data(), objects.size()*sizeof(Level_file_object));
+
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	}
+
+	void load_level_asset(Level& level, asset::istream& in) {
+		auto path = in.physical_location();
+		if(path.is_some()) {
+			auto file = util::Mapped_file{path.get_or_throw()};
+			if(file.valid() && is_level_file(file.data(), file.size())) {
+				load_level_file(level, Level_file_view{file.data(), file.size()}, path.get_or_throw());
+				return;
+			}
+		}
+
+		level.load(in);
+	}
+
+	Level_file_chunk_source::Level_file_chunk_source(const std::string& path)
+	    : _file(open_mapped(path)), _view(_file.data(), _file.size()) {
+	}
+
+	void Level_file_chunk_source::load(int x, int y, Level_chunk& chunk) {
+		auto modified = _modified.find(chunk_key(x,y));
+		if(modified!=_modified.end()) {
+			chunk = *modified->second;
+			return;
+		}
+
+		auto types = _view.types();
+		auto elements = _view.elements();
+
+		for(auto ly=0; ly<level_chunk_size; ++ly) {
+			for(auto lx=0; lx<level_chunk_size; ++lx) {
+				auto tx = x+lx;
+				auto ty = y+ly;
+				auto& tile = chunk.tiles[ly*level_chunk_size + lx];
+
+				if(tx>=0 && ty>=0 && tx<_view.width() && ty<_view.height()) {
+					auto i = ty*_view.width() + tx;
+					tile = Tile{static_cast<Tile_type>(types[i]), Elements{elements[i]}};
+				} else {
+					tile = Tile{Tile_type::indestructible_wall, Elements{}};
+				}
+			}
+		}
+	}
+
+	void Level_file_chunk_source::store(int x, int y, const Level_chunk& chunk) {
+		auto& stored = _modified[chunk_key(x,y)];
+		if(stored)
+			*stored = chunk;
+		else
+			stored = std::make_unique<Level_chunk>(chunk);
+	}
+
+	void stream_level_file(Level& level, const std::string& path) {
+		auto source = std::make_shared<Level_file_chunk_source>(path);
+		auto& view = source->view();
+
+		auto rooms = std::vector<Room>();
+		rooms.reserve(view.room_count());
+		for(auto i=0u; i<view.room_count(); ++i) {
+			auto& r = view.rooms()[i];
+			rooms.emplace_back(r.top, r.left, r.right, r.bottom, static_cast<Room_type>(r.type), i);
+		}
+
+		auto width = view.width();
+		auto height = view.height();
+		level.load(std::move(source), width, height, std::move(rooms));
+	}
+
+	void load_level_file(Level& level, const Level_file_view& view, const std::string& path) {
+		if(static_cast<int64_t>(view.width())*view.height() > level_stream_min_tiles)
+			stream_level_file(level, path);
+		else
+			level.load(view);
+	}
+
+}
+}
@@ -0,0 +1,151 @@
+/**************************************************************************\
+ * binary level container, readable in-place (e.g. memory mapped)         *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+#pragma once
+
+#include "level.hpp"
+
+#include "../../core/utils/mapped_file.hpp"
+
+#include <iosfwd>
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace mo {
+namespace asset {
+	class istream;
+}
+namespace level {
+
+	/*
+	 * Layout (little endian, all sections aligned to 4 bytes):
+	 *   Level_file_header
+	 *   uint8_t  types[width*height]     (Tile_type)
+	 *   uint16_t elements[width*height]  (Elements bitmask)
+	 *   Level_file_room   rooms[room_count]
+	 *   Level_file_object objects[object_count]
+	 */
+	constexpr uint32_t level_file_magic   = 0x564c4f4d; // "MOLV"
+	constexpr uint16_t level_file_version = 1;
+
+	struct Level_file_header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t header_size;
+		int32_t  width;
+		int32_t  height;
+		uint32_t room_count;
+		uint32_t object_count;
+		uint32_t types_offset;
+		uint32_t elements_offset;
+		uint32_t rooms_offset;
+		uint32_t objects_offset;
+		uint32_t file_size;
+	};
+
+	struct Level_file_room {
+		int32_t top, left, right, bottom;
+		uint32_t type;
+	};
+
+	struct Level_file_object {
+		float x, y;
+		uint32_t type;
+	};
+
+	/// true if the data starts with the magic number of a binary level
+	extern bool is_level_file(const void* data, std::size_t size)noexcept;
+
+	/**
+	 * Non-owning view of a binary level.
+	 * Only the header is validated, the planes are used in-place.
+	 */
+	class Level_file_view {
+		public:
+			/// throws asset::Loading_failed if the data is not a valid binary level
+			Level_file_view(const uint8_t* data, std::size_t size);
+
+			auto width()const noexcept        {return _header.width;}
+			auto height()const noexcept       {return _header.height;}
+			auto room_count()const noexcept   {return _header.room_count;}
+			auto object_count()const noexcept {return _header.object_count;}
+
+			auto types()const noexcept -> const uint8_t* {
+				return _data + _header.types_offset;
+			}
+			auto elements()const noexcept -> const uint16_t* {
+				return reinterpret_cast<const uint16_t*>(_data + _header.elements_offset);
+			}
+			auto rooms()const noexcept -> const Level_file_room* {
+				return reinterpret_cast<const Level_file_room*>(_data + _header.rooms_offset);
+			}
+			auto objects()const noexcept -> const Level_file_object* {
+				return reinterpret_cast<const Level_file_object*>(_data + _header.objects_offset);
+			}
+
+		private:
+			const uint8_t* _data;
+			Level_file_header _header;
+	};
+
+	extern void write_level_file(std::ostream& out, const Level& level,
+	                             const std::vector<Level_file_object>& objects={});
+
+	/**
+	 * Loads a level asset. Binary levels are memory mapped if the asset is a
+	 *   plain file (i.e. not part of an archive). Tiled JSON maps are imported.
+	 */
+	extern void load_level_asset(Level& level, asset::istream& in);
+
+	/**
+	 * Streams the chunks of a memory mapped binary level (see Level::stream()).
+	 * Modified chunks are kept in memory after they have been evicted.
+	 */
+	class Level_file_chunk_source : public Level_chunk_source {
+		public:
+			/// throws asset::Loading_failed if the file is not a valid binary level
+			explicit Level_file_chunk_source(const std::string& path);
+
+			auto& view()const noexcept {return _view;}
+
+			void load(int x, int y, Level_chunk& chunk)override;
+			void store(int x, int y, const Level_chunk& chunk)override;
+
+		private:
+			util::Mapped_file _file;
+			Level_file_view _view;
+			std::unordered_map<uint64_t, std::unique_ptr<Level_chunk>> _modified;
+	};
+
+	/// replaces the content of the level with the streamed content of a binary level file
+	extern void stream_level_file(Level& level, const std::string& path);
+
+	/// levels with more tiles are streamed instead of being loaded completely
+	constexpr auto level_stream_min_tiles = 1024*1024;
+
+	/**
+	 * Loads the level from the mapped file or, if it is larger than
+	 *   level_stream_min_tiles, streams it from path (see Level::stream()).
+	 * Used by load_level_asset and the Level_cache.
+	 */
+	extern void load_level_file(Level& level, const Level_file_view& view, const std::string& path);
+
+}
+}
@@ -5,6 +5,7 @@
 #include "../../core/utils/astar.hpp"
 #include "../../core/utils/string_utils.hpp"
 #include <core/utils/random.hpp>
+#include <core/utils/stopwatch.hpp>
 
 #include <sf2/sf2.hpp>
 
@@ -12,69 +13,51 @@
 #include <random>
 #include <glm/glm.hpp>
 #include <map>
+#include <queue>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
 
 using namespace mo::util;
 
 namespace mo {
 namespace level {
-	namespace {
-		template<typename T>
-		struct Range {
-			T min;
-			T max;
-		};
-		using IntRange = Range<int>;
-		sf2_structDef(IntRange, min, max)
-
-
-		struct Dungeon_cfg {
-			IntRange room_size;
-			IntRange rooms;
-			int max_width, max_height;
-			float split_prop_factor;
-		};
-		sf2_structDef(Dungeon_cfg,
-			room_size,
-			rooms,
-			max_width,
-			max_height,
-			split_prop_factor
-		)
+	sf2_structDef(IntRange, min, max)
+	sf2_structDef(Dungeon_cfg,
+		room_size,
+		rooms,
+		max_width,
+		max_height,
+		split_prop_factor
+	)
 
+	namespace {
 		struct Dungeon_cfg_map {
 			std::map<int, Dungeon_cfg> levels;
 		};
 		sf2_structDef(Dungeon_cfg_map, levels)
 
 
-		auto nodoycares_rng = mo::util::create_random_generator();
-
-		auto rand_wall() {
-			if(random_bool(nodoycares_rng, 0.1f))
-				return Tile_type(int(Tile_type::wall_tile) + random_int(nodoycares_rng, 1, 2));
+		// separate stream for the purely visual variations, so they don't influence the layout
+		auto rand_wall(random_generator& deco_rng) {
+			if(random_bool(deco_rng, 0.1f))
+				return Tile_type(int(Tile_type::wall_tile) + random_int(deco_rng, 1, 2));
 			else
 				return Tile_type::wall_tile;
 		}
-		auto rand_floor() {
-			if(random_bool(nodoycares_rng, 0.1f))
-				return Tile_type(int(Tile_type::floor_tile) + random_int(nodoycares_rng, 1, 3));
+		auto rand_floor(random_generator& deco_rng) {
+			if(random_bool(deco_rng, 0.1f))
+				return Tile_type(int(Tile_type::floor_tile) + random_int(deco_rng, 1, 3));
 			else
 				return Tile_type::floor_tile;
 		}
 
-		Dungeon_cfg load_cfg(asset::Asset_manager& assets, int depth) {
-			auto opts = assets.load<Dungeon_cfg_map>("cfg:dungeons"_aid);
-			auto cfg_iter = opts->levels.find(depth);
-			if(cfg_iter==opts->levels.end())
-				return opts->levels.rbegin()->second;
-
-			// INVARIANT(cfg_iter!=opts->levels.end(), "You delved too greedily and too deep. Level="+to_string(depth));
-
-			return cfg_iter->second;
-		}
+		/// rock between the rooms and the edge of the level
+		constexpr int level_border = 5;
 
 		struct Room_blueprint : public Room {
 			std::vector<std::size_t> connections;
+			std::vector<util::path> corridors; //< one for each connection
 			asset::Ptr<Room_template> room_template;
 
 			Room_blueprint(int top, int left, int right, int bottom)
@@ -111,40 +94,67 @@ namespace level {
 		                  random_generator& rng, const Dungeon_cfg& cfg) -> Room_list;
 		auto filter_rooms(Room_list rooms, random_generator& rng, const Dungeon_cfg& cfg) -> Room_list;
 		void connect_rooms(Room_list& rooms, random_generator& rng, const Dungeon_cfg& cfg);
-		auto build_level(Room_list& rooms, int width, int height) -> Level;
-		void dig_corridors(Level& level, const Room_list& rooms);
+		auto build_level(Room_list& rooms, int width, int height, random_generator& deco_rng) -> Level;
+		void dig_corridors(Level& level, const Room_list& rooms, random_generator& deco_rng);
 		void decorate_rooms(Level& level, const Room_list& rooms);
 	}
 
+	Dungeon_cfg load_dungeon_cfg(asset::Asset_manager& assets, int depth) {
+		auto opts = assets.load<Dungeon_cfg_map>("cfg:dungeons"_aid);
+		auto cfg_iter = opts->levels.find(depth);
+		if(cfg_iter==opts->levels.end())
+			return opts->levels.rbegin()->second;
+
+		// INVARIANT(cfg_iter!=opts->levels.end(), "You delved too greedily and too deep. Level="+to_string(depth));
+
+		return cfg_iter->second;
+	}
+
 	Level generate_level(asset::Asset_manager& assets, uint64_t seed,
 	                     int depth, int difficulty) {
-		const auto cfg = load_cfg(assets, depth);
+		return generate_level(load_dungeon_cfg(assets, depth), seed, depth, difficulty);
+	}
 
+	Level generate_level(const Dungeon_cfg& cfg, uint64_t seed,
+	                     int depth, int difficulty, Generator_stats* stats) {
 		auto rng = random_generator{seed+depth*7+difficulty*31};
+		auto deco_rng = random_generator{(seed+depth*7+difficulty*31) ^ 0x5DEECE66Dull};
+
+		auto watch = util::Stopwatch{};
+		auto lap = [&](float Generator_stats::* stage) {
+			if(stats)
+				stats->*stage += watch.lap_ms();
+		};
 
 
 		// 1. map zufällig an größter Achse trennen (rekursiv für die beiden neuen Zellen wiederholen)
 		auto rooms = process_room(1, Room_blueprint{0,0, cfg.max_width, cfg.max_height}, rng, cfg);
+		lap(&Generator_stats::process_room);
 
 
 		// 2. zufällig Zellen verwerfen bis nur noch N übrig
 		rooms = filter_rooms(rooms, rng, cfg);
+		lap(&Generator_stats::filter_rooms);
 
-		// 3. Graph/ Pfad aus den Zellen bauen (minimum-spanning tree)
+		// 3. Graph/ Pfad aus den Zellen bauen (minimum-spanning tree) und Tunnel planen
 		connect_rooms(rooms, rng, cfg);
+		lap(&Generator_stats::connect_rooms);
 
 		// 4. Rollenzuweisung anhand des Pfades
 
 		// 5. Templates anhand der Rollen zuweisen
 
 		// 6. Räume in Level konvertieren
-		Level level = build_level(rooms, cfg.max_width, cfg.max_height);
+		Level level = build_level(rooms, cfg.max_width, cfg.max_height, deco_rng);
+		lap(&Generator_stats::build_level);
 
-		// 7. Tunnel für vorgesehene Pfade graben
-		dig_corridors(level, rooms);
+		// 7. Tunnel für geplante Pfade graben
+		dig_corridors(level, rooms, deco_rng);
+		lap(&Generator_stats::dig_corridors);
 
 		// 8. Räume "befüllen"
 		decorate_rooms(level, rooms);
+		lap(&Generator_stats::decorate_rooms);
 
 		// 9. Objekte erstellen
 
@@ -198,73 +208,262 @@ namespace level {
 		}
 
 
-		template<class T, class Func>
-		std::size_t find_min(std::vector<T>& c, Func weight_func) {
-			assert(!c.empty());
+		constexpr uint32_t floor_cost = 1;
+		constexpr uint32_t rock_cost  = 6;
+		constexpr uint32_t wall_cost  = 20;
+		constexpr uint32_t turn_cost  = 4;
+		constexpr float extra_connection_prop = 0.1f;
+
+		class Disjoint_sets {
+			public:
+				Disjoint_sets(std::size_t size) : _parents(size) {
+					std::iota(_parents.begin(), _parents.end(), 0);
+				}
+
+				auto find(std::size_t i) -> std::size_t {
+					while(_parents[i]!=i)
+						i = _parents[i] = _parents[_parents[i]];
+
+					return i;
+				}
 
-			if(c.size()==1)
-				return 0;
+				/// returns false if a and b already were in the same set
+				auto join(std::size_t a, std::size_t b) -> bool {
+					a = find(a);
+					b = find(b);
+					if(a==b)
+						return false;
 
-			std::size_t min = 0;
-			auto weight = weight_func(c[0]);
-			for(std::size_t i=1; i<c.size(); ++i) {
-				auto nw = weight_func(c[i]);
-				if(nw<weight) {
-					min = i;
-					weight = nw;
+					_parents[std::max(a,b)] = std::min(a,b);
+					return true;
 				}
+
+			private:
+				std::vector<std::size_t> _parents;
+		};
+
+		/*
+		 * Plans the corridors between all rooms with a single Dijkstra search,
+		 *   that is started from the centers of all rooms at once.
+		 * Each tile is claimed by the room that reaches it first, so the borders
+		 *   between the claimed regions (like in a Voronoi diagram) are the
+		 *   candidates for corridors and their cheapest crossing is the route.
+		 * A minimum spanning tree of these candidates (+ a few extra loops) is dug
+		 *   later by dig_corridors.
+		 */
+		void connect_rooms(Room_list& rooms, random_generator& rng, const Dungeon_cfg&) {
+			if(rooms.empty())
+				return;
+
+			// the cost grid covers all rooms and the rock around them
+			constexpr int margin = level_border-1;
+			int min_x = std::numeric_limits<int>::max();
+			int min_y = std::numeric_limits<int>::max();
+			int max_x = std::numeric_limits<int>::min();
+			int max_y = std::numeric_limits<int>::min();
+
+			for(Room& r : rooms) {
+				min_y = std::min(min_y, r.top);
+				max_y = std::max(max_y, r.bottom);
+				min_x = std::min(min_x, r.left);
+				max_x = std::max(max_x, r.right);
 			}
 
-			return min;
-		}
-		template<class T>
-		T fast_erase(std::vector<T>& c, std::size_t i) {
-			T tmp = c[i];
-			c[i] = c.back();
-			c.pop_back();
-			return tmp;
-		}
+			const int origin_x = min_x - margin;
+			const int origin_y = min_y - margin;
+			const int width  = max_x-min_x + margin*2;
+			const int height = max_y-min_y + margin*2;
+			const int tiles  = width*height;
 
-		template<class T, class Func>
-		T pop_min(std::vector<T>& c, Func weight_func) {
-			return fast_erase(c, find_min(c, weight_func));
-		}
-		template<class T>
-		T pop_random(std::vector<T>& c, random_generator& rng) {
-			return fast_erase(c, random_int<std::size_t>(rng, 0, c.size()-1));
-		}
+			auto costs = std::vector<uint8_t>(tiles, rock_cost);
+			for(auto& r : rooms) {
+				for(int y=r.top; y<r.bottom; ++y) {
+					for(int x=r.left; x<r.right; ++x) {
+						auto wall = x==r.left || x==r.right-1 || y==r.top || y==r.bottom-1;
+						costs[(y-origin_y)*width + x-origin_x] = wall ? wall_cost : floor_cost;
+					}
+				}
+			}
 
-		void connect_rooms(Room_list& rooms, random_generator& rng, const Dungeon_cfg& cfg) {
-			std::vector<std::size_t> open_list(rooms.size());
-			std::iota(open_list.begin(), open_list.end(), 0);
 
-			auto last_room = pop_random(open_list, rng);
-			rooms.at(last_room).type = Room_type::start;
+			// search states are (tile, direction we came from), so turns can be penalized
+			constexpr auto unreached = std::numeric_limits<uint32_t>::max();
+			const int offsets[4] = {1, -1, width, -width};
 
+			auto dist   = std::vector<uint32_t>(tiles*4, unreached);
+			auto parent = std::vector<int32_t>(tiles*4, -1);
+			auto owner  = std::vector<int32_t>(tiles, -1);
+			auto best   = std::vector<int32_t>(tiles, -1); //< cheapest state of each tile
 
-			const auto closest_room_w = [&last_room, &rooms](std::size_t rIdx){
-				auto dist_x = std::abs(rooms.at(rIdx).center().x-rooms.at(last_room).center().x);
-				auto dist_y = std::abs(rooms.at(rIdx).center().y-rooms.at(last_room).center().y);
+			// all costs are small integers, so a ring of buckets (one for each
+			//   distance) replaces the priority queue
+			constexpr auto bucket_count = wall_cost + turn_cost + 1;
+			auto buckets = std::vector<std::vector<int32_t>>(bucket_count);
+			auto queued = std::size_t(0);
 
-				if( std::abs(dist_x-dist_y)<10 ) // TODO: impl better heuristic
-					return std::min(dist_x, dist_y);
-				else
-					return dist_x + dist_y;
+			auto tile_of = [&](Room& r) {
+				auto c = r.center();
+				auto p = util::position{c.x, c.y};
+				return (p.y-origin_y)*width + p.x-origin_x;
 			};
 
-			while(!open_list.empty()) {
-				auto closest = pop_min(open_list, closest_room_w);
+			for(auto i=0u; i<rooms.size(); ++i) {
+				auto tile = tile_of(rooms[i]);
+				owner[tile] = static_cast<int32_t>(i);
+				for(auto d=0; d<4; ++d) {
+					dist[tile*4+d] = 0;
+					buckets[0].push_back(tile*4+d);
+					queued++;
+				}
+			}
+
+			for(auto current=uint32_t(0); queued>0; ++current) {
+				auto& bucket = buckets[current % bucket_count];
+				queued -= bucket.size();
 
-				rooms.at(last_room).connections.push_back(closest);
+				for(auto state : bucket) {
+					if(dist[state]!=current)
+						continue;
 
-				last_room = closest;
+					auto tile = state/4;
+					auto dir = state%4;
+					if(best[tile]<0) {
+						best[tile] = state;
+						if(owner[tile]<0)
+							owner[tile] = owner[parent[state]/4];
+					}
+
+					auto x = tile%width;
+					auto y = tile/width;
+					for(auto d=0; d<4; ++d) {
+						if((d==0 && x==width-1) || (d==1 && x==0) || (d==2 && y==height-1) || (d==3 && y==0))
+							continue;
+
+						auto next_tile = tile + offsets[d];
+						auto next_state = next_tile*4+d;
+						auto next_dist = current + costs[next_tile] + (d!=dir ? turn_cost : 0);
+
+						if(next_dist<dist[next_state]) {
+							dist[next_state] = next_dist;
+							parent[next_state] = state;
+							buckets[next_dist % bucket_count].push_back(next_state);
+							queued++;
+						}
+					}
+				}
+
+				bucket.clear();
+			}
+
+
+			// cheapest crossing between each pair of neighbouring regions
+			struct Edge {
+				uint32_t weight;
+				uint64_t rooms; //< lower id in the high bits
+				int32_t from, to;
+			};
+			auto edges = std::unordered_map<uint64_t, Edge>{};
+
+			auto add_candidate = [&](int32_t a, int32_t b) {
+				auto oa = owner[a];
+				auto ob = owner[b];
+				if(oa==ob)
+					return;
+
+				if(oa>ob) {
+					std::swap(a,b);
+					std::swap(oa,ob);
+				}
+
+				auto key = (static_cast<uint64_t>(oa)<<32) | static_cast<uint64_t>(ob);
+				auto weight = dist[best[a]] + dist[best[b]] + costs[b];
+
+				auto iter = edges.find(key);
+				if(iter==edges.end())
+					edges.emplace(key, Edge{weight, key, a, b});
+				else if(weight<iter->second.weight)
+					iter->second = Edge{weight, key, a, b};
+			};
+
+			for(int y=0; y<height; ++y) {
+				for(int x=0; x<width; ++x) {
+					auto tile = y*width + x;
+					if(x<width-1)  add_candidate(tile, tile+1);
+					if(y<height-1) add_candidate(tile, tile+width);
+				}
 			}
 
-			rooms.at(last_room).type = Room_type::end;
+			auto sorted_edges = std::vector<Edge>();
+			sorted_edges.reserve(edges.size());
+			for(auto& e : edges)
+				sorted_edges.push_back(e.second);
+
+			std::sort(sorted_edges.begin(), sorted_edges.end(), [](auto& a, auto& b) {
+				return a.weight!=b.weight ? a.weight<b.weight : a.rooms<b.rooms;
+			});
+
+
+			auto trace = [&](int32_t tile, util::path& path) {
+				for(auto state=best[tile]; state>=0; state=parent[state]) {
+					auto t = state/4;
+					path.emplace_back(t%width + origin_x, t/width + origin_y);
+				}
+			};
+
+			auto graph = std::vector<std::vector<std::pair<std::size_t, uint32_t>>>(rooms.size());
+			auto sets = Disjoint_sets{rooms.size()};
+			for(auto& e : sorted_edges) {
+				auto a = static_cast<std::size_t>(e.rooms>>32);
+				auto b = static_cast<std::size_t>(e.rooms & 0xffffffff);
+
+				if(!sets.join(a,b) && !random_bool(rng, extra_connection_prop))
+					continue;
+
+				auto path = util::path{};
+				trace(e.from, path);
+				std::reverse(path.begin(), path.end());
+				trace(e.to, path);
+
+				rooms[a].connections.push_back(b);
+				rooms[a].corridors.emplace_back(std::move(path));
+				graph[a].emplace_back(b, e.weight);
+				graph[b].emplace_back(a, e.weight);
+			}
+
+
+			// the exit is the room that is the farthest away from the entrance
+			auto start = random_int<std::size_t>(rng, 0, rooms.size()-1);
+
+			auto room_dist = std::vector<uint32_t>(rooms.size(), unreached);
+			using Room_node = std::pair<uint32_t, std::size_t>;
+			auto open_rooms = std::priority_queue<Room_node, std::vector<Room_node>, std::greater<Room_node>>{};
+			room_dist[start] = 0;
+			open_rooms.emplace(0, start);
+			while(!open_rooms.empty()) {
+				auto node = open_rooms.top();
+				open_rooms.pop();
+				if(node.first!=room_dist[node.second])
+					continue;
+
+				for(auto& n : graph[node.second]) {
+					if(node.first+n.second < room_dist[n.first]) {
+						room_dist[n.first] = node.first+n.second;
+						open_rooms.emplace(room_dist[n.first], n.first);
+					}
+				}
+			}
+
+			auto end = start;
+			for(auto i=0u; i<rooms.size(); ++i)
+				if(room_dist[i]!=unreached && room_dist[i]>room_dist[end])
+					end = i;
+
+			rooms[start].type = Room_type::start;
+			rooms[end].type = Room_type::end;
 		}
 
-		Level build_level(Room_list& rooms, int width, int height) {
-			constexpr int border = 5;
+		Level build_level(Room_list& rooms, int width, int height, random_generator& deco_rng) {
+			constexpr int border = level_border;
 			int min_x = std::numeric_limits<int>::max();
 			int min_y = std::numeric_limits<int>::max();
 			int max_x = std::numeric_limits<int>::min();
@@ -300,68 +499,53 @@ namespace level {
 				for(int x=0; x<r.width(); ++x) {
 					auto ex = border+x+r.left-min_x;
 
-					level.get(ex, border+r.top-min_y).type = rand_wall();
-					level.get(ex, border+r.top-min_y+r.height()-1).type = rand_wall();
+					level.set(ex, border+r.top-min_y, rand_wall(deco_rng));
+					level.set(ex, border+r.top-min_y+r.height()-1, rand_wall(deco_rng));
 
 					for(int y=1; y<r.height()-1; ++y) {
 						if(x==0 || x==r.width()-1)
-							level.get(ex, border+y +r.top-min_y).type = rand_wall();
+							level.set(ex, border+y +r.top-min_y, rand_wall(deco_rng));
 						else
-							level.get(ex, border+y +r.top-min_y).type = rand_floor();
+							level.set(ex, border+y +r.top-min_y, rand_floor(deco_rng));
 					}
 				}
 				r.left-=min_x-border;
 				r.top-=min_y-border;
 				r.right-=min_x-border;
 				r.bottom-=min_y-border;
+
+				for(auto& corridor : r.corridors) {
+					for(auto& node : corridor) {
+						node.x-=min_x-border;
+						node.y-=min_y-border;
+					}
+				}
 			}
 
 			return level;
 		}
 
-		void dig_path(Level& level, util::path&& path) {
+		void dig_path(Level& level, const util::path& path, random_generator& deco_rng) {
 			for(const auto& node : path) {
-				auto& tile = level.get(node.x, node.y);
-
-				if(tile.solid())
-					tile.type = rand_floor(); // TODO: use doors, etc. from template
+				if(level.solid_unchecked(node.x, node.y))
+					level.set(node.x, node.y, rand_floor(deco_rng)); // TODO: use doors, etc. from template
 
 				for(int y=std::max(node.y-1, 0); y<=std::min(node.y+1, level.height()-1); ++y)
 					for(int x=std::max(node.x-1, 0); x<=std::min(node.x+1, level.width()-1); ++x) {
-						auto& btile = level.get(x, y);
-						if(   btile.type==Tile_type::indestructible_wall
-						   || btile.type==Tile_type::wall_dirt
-						   || btile.type==Tile_type::wall_stone
-						   || btile.type==Tile_type::wall_tile )
-							btile.type = rand_wall();
+						auto type = level.tile_type(x, y);
+						if(   type==Tile_type::indestructible_wall
+						   || type==Tile_type::wall_dirt
+						   || type==Tile_type::wall_stone
+						   || type==Tile_type::wall_tile )
+							level.set(x, y, rand_wall(deco_rng));
 					}
 			}
 		}
 
-		void dig_corridors(Level& level, const Room_list& rooms) {
-			using namespace util;
-
-			auto path_scorer = [&](position pprev, position prev, position node, position goal) {
-				auto costs = std::sqrt((node.x-goal.x)*(node.x-goal.x) + (node.y-goal.y)*(node.y-goal.y));
-
-				if(pprev.x!=node.x && pprev.y!=node.y)
-					costs+=5;
-
-				if(level.get(node.x, node.y).solid())
-					costs+=100;
-
-				return costs;
-			};
-
-			auto path_finder = create_path_finder({level.width(), level.height()}, path_scorer);
-
-			for(auto& room : rooms) {
-				for(auto c : room.connections) {
-					dig_path(level, path_finder.search(
-							{room.center().x, room.center().y},
-							{rooms[c].center().x, rooms[c].center().y} ));
-				}
-			}
+		void dig_corridors(Level& level, const Room_list& rooms, random_generator& deco_rng) {
+			for(auto& room : rooms)
+				for(auto& corridor : room.corridors)
+					dig_path(level, corridor, deco_rng);
 		}
 
 		void decorate_rooms(Level& level, const Room_list& rooms) {
@@ -370,11 +554,11 @@ namespace level {
 
 				switch(r.type) {
 					case Room_type::start:
-						level.get(center.x, center.y).type = Tile_type::stairs_up;
+						level.set(center.x, center.y, Tile_type::stairs_up);
 						break;
 
 					case Room_type::end:
-						level.get(center.x, center.y).type = Tile_type::stairs_down;
+						level.set(center.x, center.y, Tile_type::stairs_down);
 						break;
 
 					case Room_type::boss:
@@ -26,6 +26,56 @@ namespace asset {
 namespace mo {
 namespace level {
 
+	template<typename T>
+	struct Range {
+		T min;
+		T max;
+	};
+	using IntRange = Range<int>;
+
+	struct Dungeon_cfg {
+		IntRange room_size;
+		IntRange rooms;
+		int max_width, max_height;
+		float split_prop_factor;
+	};
+
+	/// time spent in the individual stages of generate_level (in milliseconds)
+	struct Generator_stats {
+		float process_room = 0;
+		float filter_rooms = 0;
+		float connect_rooms = 0;
+		float build_level = 0;
+		float dig_corridors = 0;
+		float decorate_rooms = 0;
+
+		auto total()const noexcept {
+			return process_room + filter_rooms + connect_rooms
+			     + build_level + dig_corridors + decorate_rooms;
+		}
+	};
+
+	/// has to be incremented whenever the output of generate_level changes (invalidates cached levels)
+	constexpr uint32_t generator_version = 2;
+
+	/// loads the generator config for the given depth from cfg:dungeons (not thread-safe)
+	extern Dungeon_cfg load_dungeon_cfg(asset::Asset_manager& assets, int depth);
+
+	/**
+	 * @brief procedurally generates a level
+	 * Only depends on its arguments and doesn't access the Asset_manager,
+	 *   so it may be called from any thread.
+	 * @param cfg The config returned by load_dungeon_cfg(..., depth)
+	 * @param seed The seed used for the current playthrough
+	 * @param depth The depth of the level (higher number is deeper => later in game)
+	 * @param difficulty The base difficulty of the generated level (MIN_INT=treasure, MAX_INT="fun")
+	 * @param stats If not null, the time spent in each stage is added to it
+	 * @return the generated level
+	 */
+	extern Level generate_level(const Dungeon_cfg& cfg, uint64_t seed,
+	                            int depth, int difficulty=0,
+	                            Generator_stats* stats=nullptr);
+
 	/**
 	 * @brief procedurally generates a level
 	 * @param seed The seed used for the current playthrough
@@ -0,0 +1,97 @@
+#include "level_pregenerator.hpp"
+
+#include "level_generator.hpp"
+
+#include <core/utils/thread_pool.hpp>
+#include <core/utils/stopwatch.hpp>
+#include <core/utils/log.hpp>
+
+namespace mo {
+namespace level {
+
+	namespace {
+		auto generate(const Dungeon_cfg& cfg, uint64_t seed, int depth, int difficulty) {
+			auto level = generate_level(cfg, seed, depth, difficulty);
+			auto population = plan_population(level, seed, depth, difficulty);
+
+			return Generated_level{seed, depth, difficulty, std::move(level), std::move(population)};
+		}
+	}
+
+	Level_pregenerator::Level_pregenerator(asset::Asset_manager& assets, util::Thread_pool& thread_pool)
+	    : _assets(assets), _thread_pool(thread_pool), _cache(assets) {
+	}
+	Level_pregenerator::~Level_pregenerator() {
+		if(_pending.valid())
+			_pending.wait();
+	}
+
+	void Level_pregenerator::request(uint64_t seed, int depth, int difficulty) {
+		// without worker threads this would just move the stall
+		if(_thread_pool.concurrency()<=1)
+			return;
+
+		if(_pending.valid()) {
+			if(_seed==seed && _depth==depth && _difficulty==difficulty)
+				return;
+
+			// the result is for another key and must not be taken as this one
+			_pending.wait();
+			_pending = {};
+		}
+
+		_seed = seed;
+		_depth = depth;
+		_difficulty = difficulty;
+
+		// the Asset_manager is not thread-safe => load the config here
+		auto cfg = load_dungeon_cfg(_assets, depth);
+
+		// loading it in take() is cheap enough
+		if(_cache.contains(cfg, seed, depth, difficulty))
+			return;
+
+		_pending = _thread_pool.async([cfg, seed, depth, difficulty] {
+			auto watch = util::Stopwatch{};
+			auto generated = generate(cfg, seed, depth, difficulty);
+
+			INFO("Pre-generated level "<<depth<<" in "<<watch.ms()<<"ms");
+			return generated;
+		});
+	}
+
+	auto Level_pregenerator::take(uint64_t seed, int depth, int difficulty) -> Generated_level {
+		auto cfg = load_dungeon_cfg(_assets, depth);
+
+		if(_pending.valid()) {
+			if(_seed==seed && _depth==depth && _difficulty==difficulty) {
+				auto watch = util::Stopwatch{};
+				auto generated = _pending.get();
+
+				INFO("Using pre-generated level "<<depth<<" (waited "<<watch.ms()<<"ms)");
+				_cache.store(cfg, seed, depth, difficulty, generated.level);
+				return generated;
+			}
+
+			_pending.wait();
+			_pending = {};
+		}
+
+		auto cached = _cache.load(cfg, seed, depth, difficulty);
+		if(cached.is_some()) {
+			auto level = std::move(cached.get_or_throw());
+			auto population = plan_population(level, seed, depth, difficulty);
+
+			return Generated_level{seed, depth, difficulty, std::move(level), std::move(population)};
+		}
+
+		auto watch = util::Stopwatch{};
+		auto generated = generate(cfg, seed, depth, difficulty);
+
+		INFO("Generated level "<<depth<<" in "<<watch.ms()<<"ms");
+		_cache.store(cfg, seed, depth, difficulty, generated.level);
+		return generated;
+	}
+
+}
+}
@@ -0,0 +1,70 @@
+/**************************************************************************\
+ * generates the next level in the background                             *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "level.hpp"
+#include "level_cache.hpp"
+#include "population.hpp"
+
+#include <future>
+
+namespace mo {
+	namespace asset {class Asset_manager;}
+	namespace util {class Thread_pool;}
+
+namespace level {
+
+	struct Generated_level {
+		uint64_t seed;
+		int depth;
+		int difficulty;
+
+		Level level;
+		std::vector<Spawn> population;
+	};
+
+	/**
+	 * Speculatively generates a level (layout and population plan) on a worker
+	 *   thread. The result is identical to a synchronous generation with the
+	 *   same arguments, so a mismatching or missing request just falls back to
+	 *   generating the level in take().
+	 * Levels that have already been generated once are loaded from the
+	 *   Level_cache instead.
+	 */
+	class Level_pregenerator {
+		public:
+			Level_pregenerator(asset::Asset_manager& assets, util::Thread_pool& thread_pool);
+			~Level_pregenerator();
+
+			/// starts generating the level in the background (replaces any other pending request)
+			void request(uint64_t seed, int depth, int difficulty);
+
+			/// returns the requested level; blocks until it's ready or generates it if it hasn't been requested
+			auto take(uint64_t seed, int depth, int difficulty) -> Generated_level;
+
+		private:
+			asset::Asset_manager& _assets;
+			util::Thread_pool& _thread_pool;
+			Level_cache _cache;
+
+			uint64_t _seed = 0;
+			int _depth = 0;
+			int _difficulty = 0;
+			std::future<Generated_level> _pending;
+	};
+
+}
+}
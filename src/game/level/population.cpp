@@ -0,0 +1,97 @@
+#include "population.hpp"
+
+#include <core/utils/random.hpp>
+
+namespace mo {
+namespace level {
+
+	using namespace util;
+
+	auto plan_population(const Level& level, uint64_t seed,
+	                     int depth, int difficulty) -> std::vector<Spawn> {
+		auto rng = random_generator{(seed+depth*7+difficulty*31) ^ 0x2545F4914F6CDD1Dull};
+		auto spawns = std::vector<Spawn>();
+
+		for(auto i=0u; i<level.room_count(); ++i) {
+			auto& room = level.room(i);
+			auto w = room.width();
+			auto h = room.height();
+			auto center = room.center();
+
+			auto rand_pos = [&](){
+				return center + glm::vec2{
+					util::random_int(rng,-w/2+2,w/2-2),
+					util::random_int(rng,-h/2+2,h/2-2)
+				};
+			};
+
+			auto spawn = [&](const asset::AID& aid) {
+				spawns.push_back(Spawn{aid, rand_pos()});
+			};
+
+
+			auto box_count = util::random_int(rng, 0, 2);
+			for(int i=0; i<box_count; i++) {
+				spawn("blueprint:box"_aid);
+			}
+
+			auto barrel_count = util::random_int(rng, 0, 2);
+			for(int i=0; i<barrel_count; i++) {
+				spawn("blueprint:barrel"_aid);
+			}
+
+			if(room.type==Room_type::start) {
+				spawn("blueprint:box"_aid);
+
+			} else {
+				auto zombie_count = util::random_int(rng, 2, 5);
+				auto crow_count   = util::random_int(rng, 0, 10);
+
+				for(int i=0; i<zombie_count; i++) {
+					spawn("blueprint:zombie"_aid);
+				}
+				for(int i=0; i<crow_count; i++) {
+					spawn("blueprint:crow"_aid);
+				}
+
+				if(room.type==Room_type::end) {
+					auto enemy_count = depth>0 ? util::random_int(rng, 1, 2) : 1;
+
+					auto min_type = 0;
+					auto max_type = 2;
+					if(depth==0)
+						min_type = 2;
+					else if(depth==1)
+						max_type = 1;
+
+					switch(util::random_int(rng, min_type, max_type)) {
+						case 0:
+							for(int i=0; i<enemy_count; i++)
+								spawn("blueprint:pyro"_aid);
+							break;
+
+						case 1:
+							for(int i=0; i<enemy_count; i++)
+								spawn("blueprint:vomit_zombie"_aid);
+							break;
+
+						case 2:
+						default:
+							for(int i=0; i<enemy_count; i++)
+								spawn("blueprint:turret_ice"_aid);
+							break;
+					}
+
+				} else if(depth>0) {
+					if(util::random_bool(rng, 0.3f)) {
+						spawn("blueprint:turret_ice"_aid);
+					}
+				}
+			}
+		}
+
+		return spawns;
+	}
+
+}
+}
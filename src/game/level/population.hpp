@@ -0,0 +1,41 @@
+/**************************************************************************\
+ * decides which entities are spawned where in a generated level          *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "level.hpp"
+
+#include "../../core/asset/aid.hpp"
+
+#include <glm/vec2.hpp>
+#include <vector>
+
+namespace mo {
+namespace level {
+
+	struct Spawn {
+		asset::AID blueprint;
+		glm::vec2 position;
+	};
+
+	/**
+	 * @brief plans the initial population of all rooms
+	 * Only depends on its arguments, so it may be called from any thread.
+	 */
+	extern auto plan_population(const Level& level, uint64_t seed,
+	                            int depth, int difficulty) -> std::vector<Spawn>;
+
+}
+}
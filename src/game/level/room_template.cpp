@@ -1,5 +1,6 @@
 #include "room_template.hpp"
 
+#include "level_file.hpp"
 
 namespace mo {
 namespace level {
@@ -16,11 +17,39 @@ namespace level {
 		// TODO: ?
 	}
 	void Room_template::_load(const TiledLevel& l) {
-		_props.resize(_tiles.size());
+		_props.resize(static_cast<std::size_t>(_width*_height));
 
 		// TODO: load properties & objects
 
 	}
+	void Room_template::_store(std::vector<Level_file_object>& objs)const {
+		objs.reserve(_objs.size());
+		for(auto& o : _objs)
+			objs.push_back(Level_file_object{o.x, o.y, static_cast<uint32_t>(o.type)});
+	}
+	void Room_template::_load(const Level_file_view& file) {
+		_props.resize(static_cast<std::size_t>(_width*_height));
+
+		_objs.clear();
+		_objs.reserve(file.object_count());
+		for(auto i=0u; i<file.object_count(); ++i) {
+			auto& o = file.objects()[i];
+			_objs.push_back(Room_object_props{o.x, o.y, static_cast<Room_obj_type>(o.type)});
+		}
+	}
+
+}
+
+namespace asset {
+	auto Loader<level::Room_template>::load(istream in) -> std::shared_ptr<level::Room_template> {
+		auto r = std::make_shared<level::Room_template>();
+		level::load_level_asset(*r, in);
+		return r;
+	}
+
+	void Loader<level::Room_template>::store(ostream out, const level::Room_template& asset) {
+		asset.store(out);
+	}
 
 }
 }
@@ -51,6 +51,8 @@ namespace level {
 		private:
 			virtual void _store(TiledLevel& l)const;
 			virtual void _load(const TiledLevel& l);
+			virtual void _store(std::vector<Level_file_object>& objs)const;
+			virtual void _load(const Level_file_view& file);
 
 			std::vector<Room_tile_props> _props;
 			std::vector<Room_object_props> _objs;
@@ -61,17 +63,8 @@ namespace level {
 namespace asset {
 	template<>
 	struct Loader<level::Room_template> {
-		using RT = std::shared_ptr<const level::Room_template>;
-
-		RT operator()(istream in) {
-			auto r = std::make_shared<level::Room_template>();
-			r->load(in);
-			return r;
-		}
-
-		void operator()(ostream out, const level::Room_template& asset) {
-			asset.store(out);
-		}
+		static auto load(istream in) -> std::shared_ptr<level::Room_template>;
+		static void store(ostream out, const level::Room_template& asset);
 	};
 }
 }
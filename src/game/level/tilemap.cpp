@@ -52,44 +52,119 @@ namespace level {
 	};
 
 	Tilemap::Tilemap(Engine &engine, const Level &lev)
-	    : _level(lev),
-		  _object(layout, create_dynamic_buffer<TileVertex>(16*16*6)) {
+	    : _level(lev) {
 		// Create and attach the Shader
-		_shader.attach_shader(engine.assets().load<Shader>("vert_shader:tilemap"_aid))
-				.attach_shader(engine.assets().load<Shader>("frag_shader:tilemap"_aid))
-		        .bind_all_attribute_locations(layout)
-		        .build();
+		_shader = load_program(engine.assets(), "vert_shader:tilemap"_aid,
+		                       "frag_shader:tilemap"_aid, layout);
 
 		// Load a predefined texture and bind it
 		_texture = engine.assets().load<Texture>("tex:tilemap"_aid);
+
+		_vertices.reserve(tilemap_chunk_size*tilemap_chunk_size*vertex_count);
 	}
 
 
 	void Tilemap::draw(const Camera& cam){
-		auto tex_res = vec2{_texture->width(), _texture->height()};
+		_update_chunks(cam);
+
+		auto cam_area  = cam.area();
+		auto cam_start = vec2{cam_area.x, cam_area.y};
+		auto cam_end   = vec2{cam_area.z, cam_area.w};
+
+		// tiles are centered on their position
+		auto to_chunk = [](float v) {
+			return static_cast<int>(std::floor((v+0.5f) / tilemap_chunk_size));
+		};
+		auto min_cx = std::max(0, to_chunk(cam_start.x-1));
+		auto min_cy = std::max(0, to_chunk(cam_start.y-1));
+		auto max_cx = std::min(_chunks_x-1, to_chunk(cam_end.x));
+		auto max_cy = std::min(_chunks_y-1, to_chunk(cam_end.y));
 
 		// Binding tilemap texture
 		_texture->bind();
 
+		// Updating MVP-Matrix and give it to the shader
+		glm::mat4 MVP = cam.vp();
+		_shader->bind().set_uniform("MVP", MVP)
+		              .set_uniform("myTextureSampler", 0);
+
+		for(auto cy=min_cy; cy<=max_cy; ++cy) {
+			for(auto cx=min_cx; cx<=max_cx; ++cx) {
+				auto& chunk = _chunks[cy*_chunks_x + cx];
+				if(chunk.dirty)
+					_build_chunk(cx, cy, chunk);
+
+				if(chunk.object)
+					chunk.object->draw();
+			}
+		}
+
+		if(debug_logging){
+			std::cout << "Drawing Tiles start at X:" << cam_start.x << " | at Y:" << cam_start.y
+			          << "\nends at X:" << cam_end.x << " | at Y:" << cam_end.y << std::endl;
+			std::cout << "Drawing Chunks " << min_cx << "/" << min_cy << " to " << max_cx << "/" << max_cy << std::endl;
+			std::cout << "CamPos: " << cam.position().x << "/" << cam.position().y << std::endl;
+			std::cout << "cur zoom: " << cam.zoom() << std::endl;
+			std::cout << "CamSize: " << cam.viewport().z << ":" << cam.viewport().w << std::endl;
+		}
+
+	}
+
+	void Tilemap::_update_chunks(const Camera& cam) {
+		auto tex_res = vec2{_texture->width(), _texture->height()};
 		auto tile_res = cam.world_scale();
-		auto tileset_width = static_cast<int>(tex_res.x / cam.world_scale());
-		auto pixel_correction = 0.5f;
 
-		auto cam_area  = cam.area();
-		auto cam_start = vec2{cam_area.x, cam_area.y};
-		auto cam_end   = vec2{cam_area.z, cam_area.w};
+		auto mark_all = [&] {
+			for(auto& c : _chunks)
+				c.dirty = true;
+		};
+
+		if(_level.width()!=_level_width || _level.height()!=_level_height) {
+			_level_width  = _level.width();
+			_level_height = _level.height();
+			_chunks_x = (_level_width +tilemap_chunk_size-1) / tilemap_chunk_size;
+			_chunks_y = (_level_height+tilemap_chunk_size-1) / tilemap_chunk_size;
+			_chunks.clear();
+			_chunks.resize(static_cast<std::size_t>(_chunks_x*_chunks_y));
+
+		} else if(tile_res!=_tile_res || tex_res!=_tex_res) {
+			mark_all();
+
+		} else if(_level.revision()!=_level_revision) {
+			auto known = _level.foreach_modification(_level_revision, [&](int min_x, int min_y, int max_x, int max_y) {
+				auto min_cx = std::max(0, min_x) / tilemap_chunk_size;
+				auto min_cy = std::max(0, min_y) / tilemap_chunk_size;
+				auto max_cx = std::min(_chunks_x-1, max_x / tilemap_chunk_size);
+				auto max_cy = std::min(_chunks_y-1, max_y / tilemap_chunk_size);
+
+				for(auto cy=min_cy; cy<=max_cy; ++cy)
+					for(auto cx=min_cx; cx<=max_cx; ++cx)
+						_chunks[cy*_chunks_x + cx].dirty = true;
+			});
+
+			if(!known)
+				mark_all();
+		}
+
+		_level_revision = _level.revision();
+		_tile_res = tile_res;
+		_tex_res = tex_res;
+	}
+
+	void Tilemap::_build_chunk(int cx, int cy, Chunk& chunk) {
+		auto tileset_width = static_cast<int>(_tex_res.x / _tile_res);
+		auto pixel_correction = 0.5f;
 
-		auto cam_range = glm::abs(cam_end-cam_start);
 		_vertices.clear();
-		_vertices.reserve(std::ceil(cam_range.x * cam_range.y) * vertex_count);
 
-		// Filling the vector with vertices of the displayed triangles and corresponding uv-data
-		_level.foreach_tile(cam_start.x, cam_start.y, cam_end.x, cam_end.y,
+		// Filling the vector with vertices of the triangles and corresponding uv-data
+		_level.foreach_tile(cx*tilemap_chunk_size, cy*tilemap_chunk_size,
+		                    (cx+1)*tilemap_chunk_size, (cy+1)*tilemap_chunk_size,
 		                    [&](int x, int y, const auto& tile) {
 
 			int tile_type = static_cast<int>(tile.type);
 			auto tileset_pos = vec2 {
-				(tile_type % tileset_width) * tile_res,
+				(tile_type % tileset_width) * _tile_res,
 				0
 			};
 
@@ -100,29 +175,18 @@ namespace level {
 					vuv[i].x>0 ? -pixel_correction : pixel_correction,
 					vuv[i].y>0 ? -pixel_correction : pixel_correction
 				};
-				auto uv = ((vuv[i]*tile_res + tileset_pos + cor)/tex_res);
+				auto uv = ((vuv[i]*_tile_res + tileset_pos + cor)/_tex_res);
 
 				_vertices.emplace_back(vp[i]+p, uv);
 			}
 		});
 
+		chunk.dirty = false;
 
-		// Updating MVP-Matrix and give it to the shader
-		glm::mat4 MVP = cam.vp();
-		_shader.bind().set_uniform("MVP", MVP)
-		              .set_uniform("myTextureSampler", 0);
-
-		_object.buffer().set(_vertices);
-		_object.draw();
-
-		if(debug_logging){
-			std::cout << "Drawing Tiles start at X:" << cam_start.x << " | at Y:" << cam_start.y
-			          << "\nends at X:" << cam_end.x << " | at Y:" << cam_end.y << std::endl;
-			std::cout << "CamPos: " << cam.position().x << "/" << cam.position().y << std::endl;
-			std::cout << "cur zoom: " << cam.zoom() << std::endl;
-			std::cout << "CamSize: " << cam.viewport().z << ":" << cam.viewport().w << std::endl;
-		}
-
+		if(_vertices.empty())
+			chunk.object.reset();
+		else
+			chunk.object = std::make_unique<Object>(layout, create_buffer(_vertices));
 	}
 
 }
@@ -15,11 +15,12 @@
 
 #pragma once
 
-#include <core/renderer/shader.hpp>
+#include <core/renderer/program_cache.hpp>
 #include <core/renderer/vertex_object.hpp>
 #include <core/renderer/texture.hpp>
 
 #include <vector>
+#include <memory>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
@@ -39,6 +40,13 @@ namespace level {
 		    : pos(pos), uv(uv) {}
 	};
 
+	/// number of tiles per side of a chunk of the tilemap
+	constexpr int tilemap_chunk_size = 16;
+
+	/**
+	 * Draws the tiles of the level from static vertex buffers per chunk, that
+	 *   are only rebuilt when a tile of the chunk has been modified.
+	 */
 	class Tilemap {
 		public:
 			Tilemap(Engine &engine, const Level &lev);
@@ -46,12 +54,30 @@ namespace level {
 			void draw(const renderer::Camera& cam);
 
 		private:
+			struct Chunk {
+				std::unique_ptr<renderer::Object> object; //< null if not built or empty
+				bool dirty = true;
+			};
+
+			void _update_chunks(const renderer::Camera& cam);
+			void _build_chunk(int cx, int cy, Chunk& chunk);
+
 			const Level &_level;
 			std::vector<TileVertex> _vertices;
 
-			renderer::Object _object;
-			renderer::Shader_program _shader;
+			renderer::Shader_program_ptr _shader;
 			renderer::Texture_ptr _texture;
+
+			std::vector<Chunk> _chunks;
+			int _chunks_x = 0;
+			int _chunks_y = 0;
+
+			// the vertices depend on these, so all chunks are rebuilt if any of them changes
+			uint32_t  _level_revision = 0;
+			int       _level_width = -1;
+			int       _level_height = -1;
+			float     _tile_res = 0;
+			glm::vec2 _tex_res;
 	};
 
 }
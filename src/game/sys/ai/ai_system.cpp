@@ -1,14 +1,15 @@
 #include "ai_system.hpp"
 
-#include "target_tag_comp.hpp"
-#include "../physics/transform_system.hpp"
+#include "../physics/transform_comp.hpp"
 #include "../combat/comp/damage_effect_comp.hpp"
 
 #include "../../level/level.hpp"
 
-#include <game/game_engine.hpp>
-
 #include <core/units.hpp>
+#include <core/utils/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 namespace mo {
 namespace sys {
@@ -16,70 +17,231 @@ namespace ai {
 
 	using namespace unit_literals;
 
-	Ai_system::Ai_system(ecs::Entity_manager& entity_manager,
-	                     physics::Transform_system& transform_system, level::Level& level)
+	namespace {
+		constexpr auto min_agents_per_chunk = 16;
+
+		class Fnv1a {
+			public:
+				void add(uint64_t v)noexcept {
+					for(auto i=0; i<8; ++i, v>>=8) {
+						_hash ^= v & 0xff;
+						_hash *= 0x100000001b3ull;
+					}
+				}
+				auto value()const noexcept {return _hash;}
+
+			private:
+				uint64_t _hash = 0xcbf29ce484222325ull;
+		};
+
+		auto bits(float v) -> uint64_t {
+			uint32_t b;
+			std::memcpy(&b, &v, sizeof(b));
+			return b;
+		}
+
+		float confusion_of(ecs::Entity& e) {
+			return e.get<combat::Damage_effect_comp>().process(0.f, [](auto& dec){
+				return dec.confusion();
+			});
+		}
+	}
+
+	Ai_system::Ai_system(ecs::Entity_manager& entity_manager, level::Level& level,
+	                     util::Thread_pool& thread_pool, uint64_t seed)
 	    : _simples(entity_manager.list<Simple_ai_comp>()),
-	      _transform_system(transform_system), _level(level) {
+	      _targets_tags(entity_manager.list<Target_tag_comp>()), _level(level),
+	      _thread_pool(thread_pool), _seed_rng(seed), _perception(level),
+	      _swarms(_simples), _routes(level, _perception) {
 
 		entity_manager.register_component_type<Simple_ai_comp>();
 		entity_manager.register_component_type<Target_tag_comp>();
 	}
+	Ai_system::~Ai_system() {
+		INFO("Route cache: "<<_routes.hits()<<" hits, "<<_routes.misses()<<" misses, "
+		     <<_routes.evictions()<<" evictions");
+	}
 
 	void Ai_system::update(Time dt) {
+		_perception.update();
+
+		_seed_agents();
+		_swarms.update();
+
+		_snapshot();
+		_decide_all(_thread_pool, dt);
+
+		for(auto i=0u; i<_agents.size(); ++i)
+			_commit(_agents[i], _intents[i], dt);
+	}
+
+	auto Ai_system::decide(util::Thread_pool& pool, Time dt) -> uint64_t {
+		_perception.update();
+
+		_seed_agents();
+		_swarms.update();
+		_snapshot();
+		_decide_all(pool, dt);
+
+		auto hash = Fnv1a{};
+		for(auto& intent : _intents) {
+			auto target = std::find_if(_targets.begin(), _targets.end(), [&](auto& t) {
+				return t.entity==intent.target;
+			});
+			hash.add(static_cast<uint64_t>(target-_targets.begin()));
+			hash.add(bits(intent.wander_dir.value()));
+			hash.add(bits(intent.rot_delay.value()));
+
+			auto rng = intent.rng;
+			hash.add(rng());
+		}
+
+		return hash.value();
+	}
+
+	void Ai_system::_decide_all(util::Thread_pool& pool, Time dt) {
+		_intents.resize(_agents.size());
+		pool.parallel_for(_agents.size(), min_agents_per_chunk,
+		                  [&](std::size_t begin, std::size_t end, std::size_t) {
+			for(auto i=begin; i<end; ++i)
+				_decide(_agents[i], dt, _intents[i]);
+		});
+	}
+
+	void Ai_system::_seed_agents() {
+		for(auto& e : _simples) {
+			if(!e._rng_seeded) {
+				// seeded in pool order => same streams (and initial directions) for the same seed
+				e._rng = util::split_mix_generator{_seed_rng()};
+				e._rng_seeded = true;
+
+				e._wander_dir = static_cast<float>(util::random_int(e._rng, 0,4))*90_deg;
+				e._swarm_dir = e._wander_dir;
+			}
+		}
+	}
+
+	void Ai_system::_snapshot() {
+		auto room_of = [&](Position p) {
+			return _perception.room_id(static_cast<int>(p.x.value()+0.5f),
+			                           static_cast<int>(p.y.value()+0.5f));
+		};
+
+		_agents.clear();
+
 		for(auto& e : _simples) {
 			e.owner().get<physics::Transform_comp>().process([&](auto& trans){
-				ecs::Entity* target_entity = nullptr;
-
-				auto flocking = e._wander_dir;
-				auto flocking_count = 1.f;
-
-				// TODO: keep distance; use target_pos instead of direction
-
-				_transform_system.foreach_in_range(trans.position(), trans.rotation(), e.near, e.max, e.far_angle, e.near_angle,
-						[&](ecs::Entity& target){
-
-					if(target.has<Target_tag_comp>())
-						target_entity = &target;
-
-					target.get<Simple_ai_comp>().process([&](auto& ai){
-						if(e._swarm_id>=0 && e._swarm_id==ai._swarm_id) {
-							flocking+=ai._wander_dir;
-							flocking_count++;
-							//constexpr auto target_weight = 5.f;
-							if(ai._target) {
-								constexpr auto target_weight = 5.f;
-								flocking+=ai._wander_dir * target_weight;
-								flocking_count+=target_weight;
-							}
-						}
-					});
-				});
+				auto p = trans.position();
+				_agents.push_back(Agent{&e, p, trans.rotation(), confusion_of(e.owner()),
+				                        room_of(p)});
+			});
+		}
 
-				auto confusion = e.owner().get<combat::Damage_effect_comp>().process(0.f, [](auto& dec){
-					return dec.confusion();
-				});
+		_targets.clear();
+		for(auto& t : _targets_tags) {
+			t.owner().get<physics::Transform_comp>().process([&](auto& trans){
+				auto p = trans.position();
+				_targets.push_back(Target{&t.owner(), p, confusion_of(t.owner()),
+				                          room_of(p)});
+			});
+		}
+	}
 
-				if(confusion < 0.5f) {
-					e._wander_dir = e._wander_dir*0.5f + (flocking/flocking_count)*0.5f;
-				}
+	auto Ai_system::_visible(const Agent& agent, const Target& target)const -> bool {
+		auto& e = *agent.ai;
+
+		if(!_perception.room_visible(agent.room, target.room))
+			return false;
+
+		auto diff = remove_units(target.position-agent.position);
+		auto distance_2 = glm::dot(diff, diff);
+		auto near = e.near.value();
+		auto max = e.max.value();
+
+		if(distance_2>max*max)
+			return false;
+
+		auto target_dir = Angle(std::atan2(diff.y, diff.x));
+		auto dir_diff = std::abs(normalize(agent.rotation-target_dir));
+		if(dir_diff>180_deg)
+			dir_diff = 360_deg - dir_diff;
+		dir_diff = std::abs(dir_diff);
+
+		Angle a = distance_2<near*near ? e.near_angle : e.far_angle;
+		if(dir_diff>a/2.f)
+			return false;
+
+		auto distance = glm::sqrt(distance_2);
+		if(distance>0) {
+			auto step = diff / distance;
+			auto mp = remove_units(agent.position);
+			for(float d=0; d<=distance; d++) {
+				mp+=step;
+				if(!_perception.walkable(static_cast<int>(mp.x+0.5f), static_cast<int>(mp.y+0.5f)))
+					return false;
+			}
+		}
 
-				if(target_entity) {
-					confusion += target_entity->get<combat::Damage_effect_comp>().process(0.f, [](auto& dec){
-						return dec.confusion();
-					});
-				}
+		return true;
+	}
 
-				if(confusion > 0.2f) {
-					target_entity = nullptr;
-				}
+	void Ai_system::_decide(const Agent& agent, Time dt, Intent& intent)const {
+		auto& e = *agent.ai;
+		const Target* target = nullptr;
 
-				if(target_entity) {
-					e.target(target_entity->shared_from_this());
+		// TODO: keep distance; use target_pos instead of direction
 
-				}else{
-					e.no_target(dt, _level);
-				}
-			});
+		for(auto& t : _targets) {
+			if(_visible(agent, t))
+				target = &t;
+		}
+
+		auto confusion = agent.confusion;
+
+		intent.wander_dir = e._wander_dir;
+		intent.rot_delay = e._rot_delay;
+		intent.rng = e._rng;
+
+		if(confusion < 0.5f && e._swarm_id>=0) {
+			intent.wander_dir = e._swarm_dir;
+		}
+
+		if(target) {
+			confusion += target->confusion;
+		}
+
+		if(confusion > 0.2f) {
+			target = nullptr;
+		}
+
+		intent.target = target ? target->entity : nullptr;
+
+		if(!target && !e._target) {
+			e.wander(dt, agent.position, _perception, intent.wander_dir, intent.rot_delay, intent.rng);
+		}
+	}
+
+	void Ai_system::_commit(const Agent& agent, const Intent& intent, Time dt) {
+		auto& e = *agent.ai;
+
+		e._wander_dir = intent.wander_dir;
+		e._rot_delay = intent.rot_delay;
+		e._rng = intent.rng;
+
+		if(intent.target) {
+			e.target(intent.target->shared_from_this());
+
+		}else{
+			e.no_target(dt);
+
+			// lost sight of the target => plan a route to its current position
+			if(e._target && !e._route_planned) {
+				e._route_planned = true;
+				e._target->get<physics::Transform_comp>().process([&](auto& tt){
+					e._route = _routes.find_path(agent.position, tt.position());
+					e._route_index = 0;
+				});
+			}
 		}
 	}
 
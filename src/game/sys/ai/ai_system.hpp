@@ -18,29 +18,86 @@
 #include "../../../core/ecs/ecs.hpp"
 #include "../../../core/units.hpp"
 #include "../../../core/utils/template_utils.hpp"
+#include "../../../core/utils/random.hpp"
+
+#include <vector>
 
 #include "simple_ai_comp.hpp"
+#include "swarm_subsystem.hpp"
+#include "route_cache.hpp"
+#include "perception_data.hpp"
+#include "target_tag_comp.hpp"
 
 namespace mo {
 	class Game_engine;
 	namespace level{class Level;}
+	namespace util{class Thread_pool;}
 
 namespace sys {
-	namespace physics{ class Transform_system; }
-
 	namespace ai {
 
+		/**
+		 * The update is split into a read-only "sense and decide" phase, that is
+		 *   executed in parallel and only reads the snapshot taken at the
+		 *   beginning of the frame, and a serial "commit" phase that applies the
+		 *   resulting intents. Each agent has its own random stream, so the
+		 *   result doesn't depend on the number of threads.
+		 */
 		class Ai_system {
 			public:
-				Ai_system(ecs::Entity_manager& entity_manager,
-				          physics::Transform_system& transform_system, level::Level& level);
+				Ai_system(ecs::Entity_manager& entity_manager, level::Level& level,
+				          util::Thread_pool& thread_pool, uint64_t seed);
+				~Ai_system();
 
 				void update(Time dt);
 
+				/**
+				 * Executes only the "sense and decide" phase on the given pool and returns
+				 *   a hash of the intents, without applying them. Used by the ai_bench to
+				 *   check that the result doesn't depend on the number of threads.
+				 */
+				auto decide(util::Thread_pool& pool, Time dt) -> uint64_t;
+
 			private:
+				struct Agent {
+					Simple_ai_comp* ai;
+					Position position;
+					Angle rotation;
+					float confusion;
+					int room;
+				};
+				struct Target {
+					ecs::Entity* entity;
+					Position position;
+					float confusion;
+					int room;
+				};
+				struct Intent {
+					ecs::Entity* target = nullptr;
+					Angle wander_dir = Angle{0};
+					Time rot_delay = Time{0};
+					util::split_mix_generator rng;
+				};
+
+				void _seed_agents();
+				void _decide_all(util::Thread_pool& pool, Time dt);
+				void _snapshot();
+				void _decide(const Agent& agent, Time dt, Intent& intent)const;
+				auto _visible(const Agent& agent, const Target& target)const -> bool;
+				void _commit(const Agent& agent, const Intent& intent, Time dt);
+
 				Simple_ai_comp::Pool& _simples;
-				physics::Transform_system& _transform_system;
+				Target_tag_comp::Pool& _targets_tags;
 				level::Level& _level;
+				util::Thread_pool& _thread_pool;
+				util::split_mix_generator _seed_rng;
+				Perception_data _perception;
+				Swarm_subsystem _swarms;
+				Route_cache _routes;
+
+				std::vector<Agent> _agents;
+				std::vector<Target> _targets;
+				std::vector<Intent> _intents; //< one per agent; each chunk writes its own slice
 		};
 
 	}
@@ -0,0 +1,212 @@
+#include "perception_data.hpp"
+
+#include "../../level/level.hpp"
+
+#include <core/utils/log.hpp>
+#include <core/utils/stopwatch.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace mo {
+namespace sys {
+namespace ai {
+
+	namespace {
+		constexpr uint16_t straight_cost = 3;
+		constexpr uint16_t diagonal_cost = 4;
+		constexpr uint16_t max_cost = max_clearance*straight_cost;
+
+		struct Area {
+			int min_x, min_y, max_x, max_y;
+		};
+	}
+
+	Perception_data::Perception_data(const level::Level& level)
+	    : _level(level), _revision(level.revision()), _content_revision(level.content_revision()) {
+		bake();
+	}
+
+	auto Perception_data::outdated()const noexcept -> bool {
+		return _content_revision!=_level.content_revision();
+	}
+
+	void Perception_data::bake() {
+		auto watch = util::Stopwatch{};
+
+		_revision = _level.revision();
+		_content_revision = _level.content_revision();
+		_width = _level.width();
+		_height = _level.height();
+
+		_clearance.resize(_width*_height);
+		_bake_clearance(0, 0, _width-1, _height-1);
+		_bake_rooms();
+		_room_visibility.assign(_room_count*_room_count, false);
+		_bake_visibility(0, 0, _width-1, _height-1);
+
+		INFO("Baked ai perception data for "<<_width<<"x"<<_height<<" tiles and "
+		     <<_room_count<<" rooms in "<<watch.ms()<<"ms");
+	}
+
+	void Perception_data::update() {
+		if(outdated()) {
+			bake();
+			return;
+		}
+
+		if(_revision==_level.revision())
+			return;
+
+		auto areas = std::vector<Area>{};
+		auto known = _level.foreach_modification(_revision, [&](int min_x, int min_y, int max_x, int max_y) {
+			areas.push_back(Area{min_x, min_y, max_x, max_y});
+		});
+
+		if(!known) {
+			bake();
+			return;
+		}
+
+		// the clearance of all areas first, because the lines of sight may cross several of them
+		for(auto& a : areas)
+			_bake_clearance(a.min_x-max_clearance, a.min_y-max_clearance,
+			                a.max_x+max_clearance, a.max_y+max_clearance);
+
+		for(auto& a : areas)
+			_bake_visibility(a.min_x, a.min_y, a.max_x, a.max_y);
+
+		_revision = _level.revision();
+	}
+
+	void Perception_data::_bake_clearance(int min_x, int min_y, int max_x, int max_y) {
+		constexpr auto inf = std::numeric_limits<uint16_t>::max() - 2*diagonal_cost;
+
+		min_x = std::max(min_x, 0);
+		min_y = std::max(min_y, 0);
+		max_x = std::min(max_x, _width-1);
+		max_y = std::min(max_y, _height-1);
+
+		for(auto y=min_y; y<=max_y; ++y)
+			for(auto x=min_x; x<=max_x; ++x)
+				_clearance[y*_width+x] = _level.solid_unchecked(x,y) ? 0 : inf;
+
+		// everything outside of the level is solid. The tiles around the area keep their
+		//   values, which are still correct if the area has been extended by max_clearance.
+		auto at = [&](int x, int y) -> uint16_t {
+			return in_bounds(x,y) ? _clearance[y*_width+x] : 0;
+		};
+
+		// two-pass chamfer distance transform
+		for(auto y=min_y; y<=max_y; ++y) {
+			for(auto x=min_x; x<=max_x; ++x) {
+				auto& c = _clearance[y*_width+x];
+				if(c==0) continue;
+
+				c = std::min<uint16_t>(c, at(x-1,y  )+straight_cost);
+				c = std::min<uint16_t>(c, at(x,  y-1)+straight_cost);
+				c = std::min<uint16_t>(c, at(x-1,y-1)+diagonal_cost);
+				c = std::min<uint16_t>(c, at(x+1,y-1)+diagonal_cost);
+			}
+		}
+		for(auto y=max_y; y>=min_y; --y) {
+			for(auto x=max_x; x>=min_x; --x) {
+				auto& c = _clearance[y*_width+x];
+				if(c==0) continue;
+
+				c = std::min<uint16_t>(c, at(x+1,y  )+straight_cost);
+				c = std::min<uint16_t>(c, at(x,  y+1)+straight_cost);
+				c = std::min<uint16_t>(c, at(x+1,y+1)+diagonal_cost);
+				c = std::min<uint16_t>(c, at(x-1,y+1)+diagonal_cost);
+				c = std::min(c, max_cost);
+			}
+		}
+	}
+
+	void Perception_data::_bake_rooms() {
+		_room_ids.assign(_width*_height, -1);
+		_room_count = static_cast<int>(_level.room_count());
+
+		for(auto i=0; i<_room_count; ++i) {
+			auto& r = _level.room(i);
+			for(auto y=std::max(0,r.top); y<std::min(_height,r.bottom); ++y)
+				for(auto x=std::max(0,r.left); x<std::min(_width,r.right); ++x)
+					_room_ids[y*_width+x] = static_cast<int16_t>(i);
+		}
+	}
+
+	void Perception_data::_bake_visibility(int min_x, int min_y, int max_x, int max_y) {
+		// any line of sight between two rooms has to pass an opening in the
+		//   walls of both of them, so we only test lines between openings
+		std::vector<std::vector<glm::ivec2>> openings(_room_count);
+		std::vector<bool> openings_found(_room_count, false);
+
+		auto openings_of = [&](int i) -> const std::vector<glm::ivec2>& {
+			if(!openings_found[i]) {
+				auto& r = _level.room(i);
+				for(auto y=r.top; y<r.bottom; ++y) {
+					for(auto x=r.left; x<r.right; ++x) {
+						auto border = x==r.left || x==r.right-1 || y==r.top || y==r.bottom-1;
+						if(border && walkable(x,y))
+							openings[i].emplace_back(x,y);
+					}
+				}
+				openings_found[i] = true;
+			}
+
+			return openings[i];
+		};
+
+		// the lines between the openings of two rooms stay within their bounding box
+		auto affected = [&](int a, int b) {
+			auto& ra = _level.room(a);
+			auto& rb = _level.room(b);
+			return std::min(ra.left, rb.left)<=max_x && std::max(ra.right, rb.right)-1>=min_x
+			    && std::min(ra.top, rb.top)<=max_y && std::max(ra.bottom, rb.bottom)-1>=min_y;
+		};
+
+		auto line_of_sight = [&](glm::ivec2 a, glm::ivec2 b) {
+			auto diff = glm::vec2(b-a);
+			auto steps = static_cast<int>(glm::length(diff)*2.f) + 1;
+			auto step = diff / static_cast<float>(steps);
+
+			auto p = glm::vec2(a);
+			for(auto i=0; i<steps; ++i, p+=step) {
+				if(!walkable(static_cast<int>(p.x+0.5f), static_cast<int>(p.y+0.5f)))
+					return false;
+			}
+
+			return true;
+		};
+
+		for(auto a=0; a<_room_count; ++a) {
+			_room_visibility[a*_room_count+a] = true;
+
+			for(auto b=a+1; b<_room_count; ++b) {
+				if(!affected(a,b))
+					continue;
+
+				auto visible = false;
+
+				for(auto oa : openings_of(a)) {
+					for(auto ob : openings_of(b)) {
+						if(line_of_sight(oa, ob)) {
+							visible = true;
+							break;
+						}
+					}
+					if(visible)
+						break;
+				}
+
+				_room_visibility[a*_room_count+b] = visible;
+				_room_visibility[b*_room_count+a] = visible;
+			}
+		}
+	}
+
+}
+}
+}
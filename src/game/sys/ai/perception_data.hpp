@@ -0,0 +1,91 @@
+/**************************************************************************\
+ * static per-level data used by the ai (clearance, rooms, visibility)    *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace mo {
+	namespace level{class Level;}
+
+namespace sys {
+namespace ai {
+
+	/// larger distances to the closest solid tile are not tracked (see Perception_data::clearance())
+	constexpr int max_clearance = 16;
+
+	/**
+	 * Baked once per level (and again after it has been modified):
+	 *  - clearance: distance of each tile to the closest solid tile (chamfer 3-4)
+	 *  - room id of each tile (-1 for corridors)
+	 *  - coarse room-to-room visibility, based on the openings in their walls
+	 * Streamed chunks of the level only update the clearance and visibility around them.
+	 */
+	class Perception_data {
+		public:
+			Perception_data(const level::Level& level);
+
+			void bake();
+			/// true if the content of the level changed, so the data has to be baked again
+			auto outdated()const noexcept -> bool;
+			/// bakes the data if it's outdated, otherwise only updates the streamed parts of the level
+			void update();
+
+			/**
+			 * distance to the closest solid tile in tiles (at most max_clearance);
+			 *   0 for solid tiles and outside of the level
+			 */
+			auto clearance(int x, int y)const noexcept -> float {
+				return in_bounds(x,y) ? _clearance[y*_width+x] / 3.f : 0.f;
+			}
+			auto walkable(int x, int y)const noexcept -> bool {
+				return in_bounds(x,y) && _clearance[y*_width+x]>0;
+			}
+
+			auto room_id(int x, int y)const noexcept -> int {
+				return in_bounds(x,y) ? _room_ids[y*_width+x] : -1;
+			}
+
+			/// true if anything in room b might be visible from room a; unknown rooms (<0) are always visible
+			auto room_visible(int a, int b)const noexcept -> bool {
+				return a<0 || b<0 || _room_visibility[a*_room_count + b];
+			}
+
+			auto in_bounds(int x, int y)const noexcept -> bool {
+				return x>=0 && y>=0 && x<_width && y<_height;
+			}
+
+		private:
+			// the areas are inclusive and in tiles
+			void _bake_clearance(int min_x, int min_y, int max_x, int max_y);
+			void _bake_rooms();
+			void _bake_visibility(int min_x, int min_y, int max_x, int max_y);
+
+			const level::Level& _level;
+			uint32_t _revision;
+			uint32_t _content_revision;
+			int _width = 0;
+			int _height = 0;
+			int _room_count = 0;
+
+			std::vector<uint16_t> _clearance;
+			std::vector<int16_t> _room_ids;
+			std::vector<bool> _room_visibility;
+	};
+
+}
+}
+}
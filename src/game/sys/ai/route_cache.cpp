@@ -0,0 +1,177 @@
+#include "route_cache.hpp"
+
+#include "perception_data.hpp"
+
+#include "../../level/level.hpp"
+
+#include <core/utils/log.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace mo {
+namespace sys {
+namespace ai {
+
+	using util::position;
+
+	namespace {
+		auto tile_of(Position p) {
+			return position{p.x.value(), p.y.value()};
+		}
+
+		auto dist2(position a, position b) {
+			return (a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y);
+		}
+	}
+
+	Route_cache::Route_cache(const level::Level& level, const Perception_data& perception,
+	                         std::size_t capacity)
+	    : _level(level), _perception(perception), _capacity(capacity), _level_revision(level.revision()),
+	      _content_revision(level.content_revision()) {
+	}
+
+	void Route_cache::invalidate() {
+		DEBUG("Route cache invalidated. hits="<<_hits<<", misses="<<_misses
+		      <<", evictions="<<_evictions<<", entries="<<_entries.size());
+
+		_entries.clear();
+		_index.clear();
+		_level_revision = _level.revision();
+		_content_revision = _level.content_revision();
+	}
+
+	void Route_cache::_update() {
+		if(_content_revision!=_level.content_revision()) {
+			invalidate();
+			return;
+		}
+
+		if(_level_revision==_level.revision())
+			return;
+
+		auto areas = std::vector<std::array<int,4>>{};
+		auto known = _level.foreach_modification(_level_revision, [&](int min_x, int min_y, int max_x, int max_y) {
+			areas.push_back({{min_x, min_y, max_x, max_y}});
+		});
+
+		if(!known) {
+			invalidate();
+			return;
+		}
+
+		auto affected = [&](const Entry& e) {
+			if(e.path.empty())
+				return true; // the streamed chunks might connect the rooms
+
+			for(auto& p : e.path)
+				for(auto& a : areas)
+					if(p.x>=a[0] && p.y>=a[1] && p.x<=a[2] && p.y<=a[3])
+						return true;
+
+			return false;
+		};
+
+		for(auto iter=_entries.begin(); iter!=_entries.end();) {
+			if(affected(*iter)) {
+				_index.erase(iter->key);
+				iter = _entries.erase(iter);
+			} else
+				++iter;
+		}
+
+		_level_revision = _level.revision();
+	}
+
+	auto Route_cache::route(std::size_t from_room, std::size_t to_room) -> const util::path& {
+		_update();
+
+		auto key = (static_cast<Key>(from_room)<<32) | static_cast<Key>(to_room);
+
+		auto iter = _index.find(key);
+		if(iter!=_index.end()) {
+			_hits++;
+			_entries.splice(_entries.begin(), _entries, iter->second);
+			return iter->second->path;
+		}
+
+		_misses++;
+
+		if(_entries.size()>=_capacity) {
+			_evictions++;
+			_index.erase(_entries.back().key);
+			_entries.pop_back();
+		}
+
+		// the route back is just the reversed route
+		auto reverse_key = (static_cast<Key>(to_room)<<32) | static_cast<Key>(from_room);
+		auto reverse = _index.find(reverse_key);
+
+		util::path path;
+		if(reverse!=_index.end()) {
+			path.assign(reverse->second->path.rbegin(), reverse->second->path.rend());
+
+		} else {
+			auto from = _level.room(from_room).center();
+			auto to = _level.room(to_room).center();
+			path = _search({from.x, from.y}, {to.x, to.y});
+		}
+
+		_entries.push_front(Entry{key, std::move(path)});
+		_index[key] = _entries.begin();
+
+		return _entries.front().path;
+	}
+
+	auto Route_cache::find_path(Position from, Position to) -> util::path {
+		auto from_tile = tile_of(from);
+		auto to_tile = tile_of(to);
+
+		auto from_id = _perception.room_id(from_tile.x, from_tile.y);
+		auto to_id = _perception.room_id(to_tile.x, to_tile.y);
+
+		if(from_id<0 || to_id<0)
+			return _search(from_tile, to_tile);
+
+		if(from_id==to_id)
+			return util::path{to_tile};
+
+		auto& cached = route(from_id, to_id);
+		if(cached.empty())
+			return {};
+
+		// splice: enter the route where it is closest to our position and leave
+		//   it where it is closest to the destination
+		auto enter = std::size_t(0);
+		auto leave = cached.size()-1;
+		for(auto i=0u; i<cached.size(); ++i) {
+			if(dist2(cached[i], from_tile) < dist2(cached[enter], from_tile))
+				enter = i;
+			if(dist2(cached[i], to_tile) <= dist2(cached[leave], to_tile))
+				leave = i;
+		}
+
+		if(leave<enter)
+			return util::path{to_tile};
+
+		auto path = util::path(cached.begin()+enter, cached.begin()+leave+1);
+		path.push_back(to_tile);
+		return path;
+	}
+
+	auto Route_cache::_search(position from, position to)const -> util::path {
+		auto scorer = [&](position, position, position node, position goal) {
+			// the goal may be solid (e.g. stairs in the center of a room)
+			if(!(node==goal) && !_perception.walkable(node.x, node.y))
+				return -1e9f;
+
+			return std::sqrt(static_cast<float>(dist2(node, goal)));
+		};
+
+		return util::create_path_finder({_level.width(), _level.height()}, scorer).search(from, to);
+	}
+
+}
+}
+}
@@ -0,0 +1,82 @@
+/**************************************************************************\
+ * caches routes between rooms                                            *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "../../../core/units.hpp"
+#include "../../../core/utils/astar.hpp"
+
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+namespace mo {
+	namespace level{class Level;}
+
+namespace sys {
+namespace ai {
+	class Perception_data;
+
+	/**
+	 * LRU cache of the routes between the centers of two rooms.
+	 * Paths between positions in different rooms are spliced from the cached
+	 *   route. All entries are dropped when the content of the level changes
+	 *   (e.g. a door has been toggled). Streamed chunks only drop the routes
+	 *   through them and the routes that haven't been found.
+	 */
+	class Route_cache {
+		public:
+			Route_cache(const level::Level& level, const Perception_data& perception,
+			            std::size_t capacity=64);
+
+			/// route (in tiles) from the center of from_room to the center of to_room
+			auto route(std::size_t from_room, std::size_t to_room) -> const util::path&;
+
+			/// path (in tiles) from one position to another; empty if there is none
+			auto find_path(Position from, Position to) -> util::path;
+
+			void invalidate();
+
+			auto hits()const noexcept      {return _hits;}
+			auto misses()const noexcept    {return _misses;}
+			auto evictions()const noexcept {return _evictions;}
+
+		private:
+			using Key = uint64_t;
+			struct Entry {
+				Key key;
+				util::path path;
+			};
+
+			void _update();
+			auto _search(util::position from, util::position to)const -> util::path;
+
+			const level::Level& _level;
+			const Perception_data& _perception;
+			const std::size_t _capacity;
+			uint32_t _level_revision;
+			uint32_t _content_revision;
+
+			std::list<Entry> _entries; //< most recently used first
+			std::unordered_map<Key, std::list<Entry>::iterator> _index;
+
+			uint64_t _hits = 0;
+			uint64_t _misses = 0;
+			uint64_t _evictions = 0;
+	};
+
+}
+}
+}
@@ -8,7 +8,7 @@
 #include <sf2/sf2.hpp>
 
 #include <core/utils/random.hpp>
-#include "../../level/level.hpp"
+#include "perception_data.hpp"
 
 namespace mo {
 namespace sys {
@@ -57,19 +57,12 @@ namespace ai {
 	}
 
 
-	namespace {
-		auto rng = util::create_random_generator();
-
-		Angle random_angle(Angle min, Angle max) {
-			return Angle{util::random_real(rng, remove_unit(min), remove_unit(max))};
-		}
-	}
-
 	Simple_ai_comp::Simple_ai_comp(ecs::Entity& owner)
 	    : Component(owner), attack_distance(2_m),
 	      near(2_m), max(10_m), near_angle(360_deg), far_angle(180_deg),
 	      _follow_time(0.5_s), _follow_time_left(0),
-	      _wander_dir(static_cast<float>(util::random_int(rng, 0,4))*90_deg), _rot_delay(0_s) {
+	      _wander_dir(0_deg), _rot_delay(0_s),
+	      _swarm_dir(_wander_dir) {
 
 		auto controller_m = owner.get<controller::Controllable_comp>();
 
@@ -80,48 +73,47 @@ namespace ai {
 			controller_m.get_or_throw().set(type());
 	}
 
-	void Simple_ai_comp::no_target(Time dt, level::Level& level)noexcept {
+	void Simple_ai_comp::no_target(Time dt)noexcept {
 		if(_target) {
 			_follow_time_left-=dt;
-			if(_follow_time_left<=0_s)
+			if(_follow_time_left<=0_s) {
 				_target.reset();
-
-		} else {
-			auto pos = owner().get<physics::Transform_comp>()
-			            .process(Position{0,0}, [&](auto& t){return t.position();});
-
-			auto is_solid = [&](Angle a, float o){
-				auto dest = pos+rotate(Position{1_m*o,0_m}, a);
-				return level.solid(dest.x.value(),dest.y.value());
-			};
-
-			_rot_delay+=dt;
-			if(_rot_delay>2_s) {
-				_wander_dir+=random_angle(-20_deg, 20_deg);
-				_rot_delay = 0_s;
+				_route.clear();
+				_route_planned = false;
 			}
+		}
+	}
 
-			if(is_solid(_wander_dir,1) || is_solid(_wander_dir, 2.f)) {
-
-				Angle a = util::random_bool(rng, 0.5) ? -90_deg : 90_deg;
-				_rot_delay = 0_s;
-
-				do {
-
-					if(!is_solid(_wander_dir+a,1)) {
-						_wander_dir+=a;
-						break;
+	void Simple_ai_comp::wander(Time dt, Position pos, const Perception_data& perception,
+	                            Angle& dir, Time& rot_delay, util::split_mix_generator& rng)const noexcept {
+		auto clearance = [&](Angle a, float o){
+			auto dest = pos+rotate(Position{1_m*o,0_m}, a);
+			return perception.clearance(static_cast<int>(dest.x.value()), static_cast<int>(dest.y.value()));
+		};
+
+		rot_delay+=dt;
+		if(rot_delay>2_s) {
+			dir+=Angle{util::random_real(rng, remove_unit(-20_deg), remove_unit(20_deg))};
+			rot_delay = 0_s;
+		}
 
-					} else if(!is_solid(_wander_dir-a,1)) {
+		if(clearance(dir,1)<=0.f || clearance(dir, 2.f)<=0.f) {
+			rot_delay = 0_s;
 
-						_wander_dir-=a;
-						break;
+			// turn into the most open direction; random preference if both sides are equal
+			Angle a = util::random_bool(rng, 0.5) ? -90_deg : 90_deg;
+			auto best = dir;
+			auto best_clearance = 0.f;
 
-					} else {
-						a*=2;
-					}
-				} while(abs(a)<=180_deg);
+			for(auto candidate : {dir+a, dir-a, dir+a*2.f}) {
+				auto c = clearance(candidate, 1);
+				if(c>best_clearance) {
+					best = candidate;
+					best_clearance = c;
+				}
 			}
+
+			dir = best;
 		}
 	}
 
@@ -139,6 +131,18 @@ namespace ai {
 
 				auto distance = glm::length(dir) * 1_m;
 
+				// target is out of sight => follow the route to its last position
+				for(; _route_index<_route.size(); _route_index++) {
+					auto wp = glm::vec2(_route[_route_index].x, _route[_route_index].y);
+					auto wp_dir = wp - remove_units(t.position());
+
+					if(glm::length(wp_dir)>0.5f) {
+						c.look_in_dir(wp_dir);
+						c.move(wp_dir);
+						return;
+					}
+				}
+
 				c.look_at(remove_units(tt.position()));
 
 				if(distance<=attack_distance)
@@ -20,11 +20,13 @@
 
 #include "../controller/controller.hpp"
 
-namespace mo {
-	namespace level{class Level;}
+#include "../../../core/utils/random.hpp"
+#include "../../../core/utils/astar.hpp"
 
+namespace mo {
 namespace sys {
 namespace ai {
+	class Perception_data;
 
 	class Simple_ai_comp : public ecs::Component<Simple_ai_comp>, public controller::Controller {
 		public:
@@ -40,8 +42,14 @@ namespace ai {
 			void target(ecs::Entity_ptr e)noexcept {
 				_target = e;
 				_follow_time_left = _follow_time;
+				_route.clear();
+				_route_planned = false;
 			}
-			void no_target(Time dt, level::Level& level)noexcept;
+			void no_target(Time dt)noexcept;
+
+			/// computes the next wander direction; doesn't modify the component
+			void wander(Time dt, Position pos, const Perception_data& perception,
+			            Angle& dir, Time& rot_delay, util::split_mix_generator& rng)const noexcept;
 
 			Distance attack_distance;
 			Distance near;
@@ -51,12 +59,19 @@ namespace ai {
 
 		private:
 			friend class Ai_system;
+			friend class Swarm_subsystem;
 			Time _follow_time;
 			Time _follow_time_left;
 			ecs::Entity_ptr _target;
 			Angle _wander_dir;
 			Time _rot_delay;
 			int _swarm_id = -1;
+			Angle _swarm_dir;
+			util::split_mix_generator _rng;
+			bool _rng_seeded = false;
+			util::path _route;
+			std::size_t _route_index = 0;
+			bool _route_planned = false;
 	};
 
 }
@@ -0,0 +1,228 @@
+#include "swarm_subsystem.hpp"
+
+#include "../physics/transform_comp.hpp"
+
+#include <core/units.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mo {
+namespace sys {
+namespace ai {
+
+	using namespace unit_literals;
+
+	namespace {
+		constexpr auto target_weight = 5.f;
+		constexpr auto cohesion_weight = 0.5f;
+		constexpr auto separation_weight = 1.0f;
+		constexpr auto separation_distance = 1.f; // in m
+	}
+
+	Swarm_subsystem::Swarm_subsystem(Simple_ai_comp::Pool& simples)
+	    : _simples(simples) {
+	}
+
+	void Swarm_subsystem::update() {
+		_gather();
+
+		for(auto& s : _swarms) {
+			_bin(s);
+			_flock(s);
+		}
+
+		_write_back();
+	}
+
+	void Swarm_subsystem::_gather() {
+		auto& members = _gathered;
+		members.clear();
+
+		for(auto& e : _simples) {
+			if(e._swarm_id<0)
+				continue;
+
+			e.owner().get<physics::Transform_comp>().process([&](auto& trans){
+				members.push_back(Member{e._swarm_id, &e, remove_units(trans.position())});
+			});
+		}
+
+		// stable, so the members of a swarm keep their (deterministic) pool order
+		std::stable_sort(members.begin(), members.end(), [](auto& a, auto& b){
+			return a.swarm_id < b.swarm_id;
+		});
+
+		auto count = members.size();
+		_members.resize(count);
+		_x.resize(count);
+		_y.resize(count);
+		_dir_x.resize(count);
+		_dir_y.resize(count);
+		_weight.resize(count);
+		_cell.resize(count);
+		_steer_x.resize(count);
+		_steer_y.resize(count);
+
+		_swarms.clear();
+
+		for(auto i=0u; i<count; ++i) {
+			auto& m = members[i];
+
+			if(_swarms.empty() || _swarms.back().id!=m.swarm_id) {
+				if(!_swarms.empty())
+					_swarms.back().end = i;
+
+				_swarms.emplace_back();
+				_swarms.back().id = m.swarm_id;
+				_swarms.back().begin = i;
+				_swarms.back().radius = 0.f;
+			}
+
+			_swarms.back().radius = std::max(_swarms.back().radius, m.ai->near/1_m);
+
+			_members[i] = m.ai;
+			_x[i] = m.pos.x;
+			_y[i] = m.pos.y;
+			_dir_x[i] = std::cos(m.ai->_wander_dir.value());
+			_dir_y[i] = std::sin(m.ai->_wander_dir.value());
+			_weight[i] = m.ai->_target ? 1.f+target_weight : 1.f;
+		}
+
+		if(!_swarms.empty())
+			_swarms.back().end = count;
+	}
+
+	void Swarm_subsystem::_bin(Swarm& s) {
+		s.radius = std::max(s.radius, separation_distance);
+
+		auto max_x = s.min_x = _x[s.begin];
+		auto max_y = s.min_y = _y[s.begin];
+		for(auto i=s.begin; i<s.end; ++i) {
+			s.min_x = std::min(s.min_x, _x[i]);
+			s.min_y = std::min(s.min_y, _y[i]);
+			max_x = std::max(max_x, _x[i]);
+			max_y = std::max(max_y, _y[i]);
+		}
+
+		s.cells_x = static_cast<int>((max_x-s.min_x) / s.radius) + 1;
+		s.cells_y = static_cast<int>((max_y-s.min_y) / s.radius) + 1;
+
+		s.cell_begin.assign(s.cells_x*s.cells_y+1, 0);
+
+		for(auto i=s.begin; i<s.end; ++i) {
+			auto cx = static_cast<int>((_x[i]-s.min_x) / s.radius);
+			auto cy = static_cast<int>((_y[i]-s.min_y) / s.radius);
+			_cell[i] = cy*s.cells_x + cx;
+			s.cell_begin[_cell[i]+1]++;
+		}
+
+		for(auto c=1u; c<s.cell_begin.size(); ++c)
+			s.cell_begin[c] += s.cell_begin[c-1];
+
+		// counting sort of the swarm block by cell
+		auto n = s.end - s.begin;
+		_order.resize(n);
+		auto next = s.cell_begin;
+		for(auto i=s.begin; i<s.end; ++i)
+			_order[next[_cell[i]]++] = i;
+
+		auto permute = [&](auto& v) {
+			using T = typename std::remove_reference_t<decltype(v)>::value_type;
+			auto tmp = std::vector<T>(n);
+			for(auto i=0u; i<n; ++i)
+				tmp[i] = v[_order[i]];
+			std::copy(tmp.begin(), tmp.end(), v.begin()+s.begin);
+		};
+		permute(_members);
+		permute(_x);
+		permute(_y);
+		permute(_dir_x);
+		permute(_dir_y);
+		permute(_weight);
+		permute(_cell);
+	}
+
+	void Swarm_subsystem::_flock(const Swarm& s) {
+		const auto r2 = s.radius*s.radius;
+		const auto sep2 = separation_distance*separation_distance;
+
+		const float* __restrict__ xs = _x.data() + s.begin;
+		const float* __restrict__ ys = _y.data() + s.begin;
+		const float* __restrict__ dxs = _dir_x.data() + s.begin;
+		const float* __restrict__ dys = _dir_y.data() + s.begin;
+		const float* __restrict__ ws = _weight.data() + s.begin;
+
+		for(auto i=0u; i<s.end-s.begin; ++i) {
+			const auto xi = xs[i];
+			const auto yi = ys[i];
+			const auto cell = static_cast<int>(_cell[s.begin+i]);
+			const auto cx = cell % s.cells_x;
+			const auto cy = cell / s.cells_x;
+
+			float align_x=0, align_y=0, align_w=0;
+			float coh_x=0, coh_y=0, coh_n=0;
+			float sep_x=0, sep_y=0;
+
+			for(auto ny=std::max(0,cy-1); ny<=std::min(s.cells_y-1,cy+1); ++ny) {
+				// the cells of a row are stored next to each other => one contiguous range
+				auto row = ny*s.cells_x;
+				auto first = s.cell_begin[row + std::max(0,cx-1)];
+				auto last  = s.cell_begin[row + std::min(s.cells_x-1,cx+1) + 1];
+
+				for(auto j=first; j<last; ++j) {
+					auto dx = xs[j]-xi;
+					auto dy = ys[j]-yi;
+					auto d2 = dx*dx + dy*dy;
+
+					auto in  = static_cast<float>(d2<r2);
+					auto sep = static_cast<float>(d2<sep2) * static_cast<float>(d2>0.f);
+					auto w   = in*ws[j];
+
+					align_x += w*dxs[j];
+					align_y += w*dys[j];
+					align_w += w;
+
+					coh_x += in*dx;
+					coh_y += in*dy;
+					coh_n += in;
+
+					auto inv = sep / (d2+0.0001f);
+					sep_x -= dx*inv;
+					sep_y -= dy*inv;
+				}
+			}
+
+			// align_w and coh_n are always >=1, because every member sees itself
+			auto steer_x = align_x/align_w
+			             + cohesion_weight * coh_x/(coh_n*s.radius)
+			             + separation_weight * sep_x*separation_distance;
+			auto steer_y = align_y/align_w
+			             + cohesion_weight * coh_y/(coh_n*s.radius)
+			             + separation_weight * sep_y*separation_distance;
+
+			_steer_x[s.begin+i] = steer_x;
+			_steer_y[s.begin+i] = steer_y;
+		}
+	}
+
+	void Swarm_subsystem::_write_back() {
+		for(auto i=0u; i<_members.size(); ++i) {
+			auto steer = glm::vec2{_steer_x[i], _steer_y[i]};
+			auto len = glm::length(steer);
+			auto dir = glm::vec2{_dir_x[i], _dir_y[i]} * 0.5f;
+
+			if(len>0.0001f)
+				dir += steer/len * 0.5f;
+
+			auto& ai = *_members[i];
+			if(glm::length(dir)>0.0001f)
+				ai._swarm_dir = Angle{std::atan2(dir.y, dir.x)};
+			else
+				ai._swarm_dir = ai._wander_dir;
+		}
+	}
+
+}
+}
+}
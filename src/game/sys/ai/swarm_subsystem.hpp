@@ -0,0 +1,84 @@
+/**************************************************************************\
+ * flocking (alignment, cohesion, separation) of swarm members            *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+#pragma once
+
+#include "simple_ai_comp.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace mo {
+namespace sys {
+namespace ai {
+
+	/**
+	 * Keeps the members of all swarms in packed arrays (one block per swarm,
+	 *   binned into a coarse grid) and computes their steering directions in
+	 *   a single pass. The results are written back into the Simple_ai_comps
+	 *   (_swarm_dir) and applied by the Ai_system.
+	 */
+	class Swarm_subsystem {
+		public:
+			Swarm_subsystem(Simple_ai_comp::Pool& simples);
+
+			void update();
+
+		private:
+			struct Member {
+				int swarm_id;
+				Simple_ai_comp* ai;
+				glm::vec2 pos;
+			};
+			struct Swarm {
+				int id;
+				std::size_t begin;
+				std::size_t end;
+				float radius;
+				float min_x, min_y;
+				int cells_x, cells_y;
+				std::vector<uint32_t> cell_begin; //< cells_x*cells_y+1 offsets into the swarm block
+			};
+
+			void _gather();
+			void _bin(Swarm& swarm);
+			void _flock(const Swarm& swarm);
+			void _write_back();
+
+			Simple_ai_comp::Pool& _simples;
+
+			std::vector<Swarm> _swarms;
+
+			// member data, sorted by swarm and grid cell
+			std::vector<Simple_ai_comp*> _members;
+			std::vector<float> _x;
+			std::vector<float> _y;
+			std::vector<float> _dir_x;
+			std::vector<float> _dir_y;
+			std::vector<float> _weight;
+			std::vector<uint32_t> _cell;
+
+			// results
+			std::vector<float> _steer_x;
+			std::vector<float> _steer_y;
+
+			// scratch buffers
+			std::vector<Member> _gathered;
+			std::vector<uint32_t> _order;
+	};
+
+}
+}
+}
@@ -159,7 +159,7 @@ namespace graphic {
 	}
 
 	namespace {
-		Particle_emiter_ptr create_orb_emiter(Texture_ptr tex,
+		Particle_emiter_ptr create_orb_emiter(Atlas_texture tex,
 		                                      Particle_renderer& particle_renderer) {
 			if(tex) {
 				return particle_renderer.create_emiter(
@@ -185,7 +185,7 @@ namespace graphic {
 			return {};
 		}
 
-		Particle_emiter_ptr create_thrower_emiter(Texture_ptr tex,
+		Particle_emiter_ptr create_thrower_emiter(Atlas_texture tex,
 		                                      Particle_renderer& particle_renderer, float count_fac=1) {
 			if(tex) {
 				return particle_renderer.create_emiter(
@@ -211,7 +211,7 @@ namespace graphic {
 			return {};
 		}
 
-		Particle_emiter_ptr create_explosion_emiter(Texture_ptr tex,
+		Particle_emiter_ptr create_explosion_emiter(Atlas_texture tex,
 		                                      Particle_renderer& particle_renderer, float zoom=1.f) {
 			if(tex) {
 				return particle_renderer.create_emiter(
@@ -239,8 +239,8 @@ namespace graphic {
 			return {};
 		}
 
-		Texture_ptr load_tex(asset::Asset_manager& a, std::string tex_name) {
-			return a.load<renderer::Texture>(asset::AID(
+		auto load_tex(asset::Asset_manager& a, std::string tex_name) -> renderer::Atlas_texture {
+			return renderer::Atlas_texture(a, asset::AID(
 					asset::Asset_type::tex, std::move(tex_name)));
 		}
 	}
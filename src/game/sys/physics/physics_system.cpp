@@ -148,7 +148,7 @@ namespace physics {
 
 		for(auto x : util::range(min_world_x, max_world_x)) {
 			for(auto y : util::range(min_world_y, max_world_y)) {
-				if(_world.solid(x,y)) {
+				if(_world.solid_unchecked(x,y)) {
 					auto tile_dim = _world.get(x,y).dimensions();
 
 					auto n = Position(x,y) - pos;
@@ -83,9 +83,9 @@ namespace physics {
 				using namespace unit_literals;
 				p = clamp(p, {0_m, 0_m}, {(_cells_x*_cell_size-1)*1_m, (_cells_y*_cell_size-1)*1_m});
 			}
-			inline uint16_t _get_cell_idx_for(Position pos) {
-				const auto x = static_cast<uint16_t>(pos.x.value() / _cell_size);
-				const auto y = static_cast<uint16_t>(pos.y.value() / _cell_size);
+			inline int32_t _get_cell_idx_for(Position pos) {
+				const auto x = static_cast<int32_t>(pos.x.value() / _cell_size);
+				const auto y = static_cast<int32_t>(pos.y.value() / _cell_size);
 
 				return y*_cells_x + x;
 			}
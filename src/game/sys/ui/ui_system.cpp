@@ -83,7 +83,6 @@ namespace ui {
 	      _hud_health_min_tex(e.assets().load<Texture>("tex:ui_hud_health_min"_aid)),
 	      _score_font(e.assets().load<Font>("font:nixie"_aid)),
 	      _score_mult_font(e.assets().load<Font>("font:menu_font"_aid)),
-	      _score_text(_score_font),
 	      _score_mult_text(_score_mult_font),
 	      _join_msg(e.assets(), e.assets().load<Texture>("tex:ui_hud_join"_aid)),
 	      _bubble_renderer(e.assets(), 58/2.f),
@@ -94,20 +93,14 @@ namespace ui {
 
 		em.register_component_type<Ui_minimal_comp>();
 
-		_score_shader.attach_shader(e.assets().load<renderer::Shader>("vert_shader:simple"_aid))
-		             .attach_shader(e.assets().load<renderer::Shader>("frag_shader:simple"_aid))
-                     .bind_all_attribute_locations(renderer::text_vertex_layout)
-                     .build();
+		_score_shader = load_program(e.assets(), "vert_shader:simple"_aid,
+		                             "frag_shader:simple"_aid, text_vertex_layout);
 
-		_hud_shader.attach_shader(e.assets().load<Shader>("vert_shader:hud"_aid))
-	               .attach_shader(e.assets().load<Shader>("frag_shader:hud"_aid))
-	               .bind_all_attribute_locations(simple_vertex_layout)
-	               .build();
+		_hud_shader = load_program(e.assets(), "vert_shader:hud"_aid,
+		                           "frag_shader:hud"_aid, simple_vertex_layout);
 
-		_health_shader.attach_shader(e.assets().load<Shader>("vert_shader:hud_health"_aid))
-		              .attach_shader(e.assets().load<Shader>("frag_shader:hud_health"_aid))
-                      .bind_all_attribute_locations(simple_vertex_layout)
-                      .build();
+		_health_shader = load_program(e.assets(), "vert_shader:hud_health"_aid,
+		                              "frag_shader:hud_health"_aid, simple_vertex_layout);
 
 		_cam.zoom(0.5f);
 	}
@@ -226,7 +219,7 @@ namespace ui {
 		glm::vec2 upper_left  = world_cam.screen_to_world({world_cam.viewport().x, world_cam.viewport().y});
 		glm::vec2 lower_right = world_cam.screen_to_world({world_cam.viewport().z, world_cam.viewport().w});
 
-		_health_shader.bind().set_uniform("tex", 0);
+		_health_shader->bind().set_uniform("tex", 0);
 		_hud_health_min_tex->bind();
 		auto min_health_scale = glm::vec3(
 			_hud_health_min_tex->width()  / world_cam.world_scale() /1.5f,
@@ -247,7 +240,7 @@ namespace ui {
 
 					auto model = glm::scale(glm::translate(glm::mat4{}, {pos.x-min_health_scale.x/2, pos.y-min_health_scale.y, 0.f}), min_health_scale);
 
-					_health_shader.set_uniform("mvp", world_cam.vp() * model)
+					_health_shader->set_uniform("mvp", world_cam.vp() * model)
 								  .set_uniform("health", health.hp_percent())
 								  .set_uniform("health_anim", health.hp_percent());
 
@@ -259,9 +252,9 @@ namespace ui {
 
 		// draw bg
 		_hud_bg_tex->bind(0);
-		_hud_shader.bind().set_uniform("tex", 0);
+		_hud_shader->bind().set_uniform("tex", 0);
 		for(auto& hud : _ui_comps) {
-			_hud_shader.set_uniform("mvp", hud._mvp);
+			_hud_shader->set_uniform("mvp", hud._mvp);
 
 			_hud.draw();
 		}
@@ -294,10 +287,10 @@ namespace ui {
 
 
 		// draw health
-		_health_shader.bind().set_uniform("tex", 0);
+		_health_shader->bind().set_uniform("tex", 0);
 		_hud_health_tex->bind();
 		for(auto& hud : _ui_comps) {
-			_health_shader.set_uniform("mvp", hud._mvp)
+			_health_shader->set_uniform("mvp", hud._mvp)
 			              .set_uniform("health", hud._health_c)
 			              .set_uniform("health_anim", hud._health);
 
@@ -307,9 +300,9 @@ namespace ui {
 
 		// draw fg
 		_hud_fg_tex->bind(0);
-		_hud_shader.bind().set_uniform("tex", 0);
+		_hud_shader->bind().set_uniform("tex", 0);
 		for(auto& hud : _ui_comps) {
-			_hud_shader.set_uniform("mvp", hud._mvp);
+			_hud_shader->set_uniform("mvp", hud._mvp);
 
 			_hud.draw();
 		}
@@ -342,18 +335,20 @@ namespace ui {
 
 		// draw score
 		_score_font->bind();
-		_score_shader.bind()
+		_score_shader->bind()
 		             .set_uniform("VP", _cam.vp())
 		             .set_uniform("texture", 0)
 		             .set_uniform("layer",   1.0f)
 		             .set_uniform("clip", glm::vec4(0,0,1,1))
 		             .set_uniform("color",   glm::vec4(2,2,2,1));
 
+		auto score_index = std::size_t(0);
 		for(auto& hud : _ui_comps) {
-			std::stringstream str;
-			str<<std::setfill(' ')<<std::setw(4)<<hud._score;
+			if(score_index>=_score_texts.size())
+				_score_texts.emplace_back(_score_font);
 
-			_score_text.set(str.str());
+			auto& score_text = _score_texts[score_index++];
+			score_text.set_number(hud._score, 4);
 
 			auto offset = hud._offset;
 
@@ -364,8 +359,8 @@ namespace ui {
 
 			auto model = glm::translate(glm::mat4{}, offset);
 
-			_score_shader.set_uniform("model",model);
-			_score_text.draw();
+			_score_shader->set_uniform("model",model);
+			score_text.draw();
 		}
 
 
@@ -379,7 +374,7 @@ namespace ui {
 			_score_mult_font->bind();
 			_score_mult_text.set(multiplicator_str);
 			auto f = 0.2+score_mult/10.f;
-			_score_shader.set_uniform("color",   glm::vec4(f,f,f,1));
+			_score_shader->set_uniform("color",   glm::vec4(f,f,f,1));
 			for(auto& hud : _ui_comps) {
 				auto offset = hud._offset;
 
@@ -389,7 +384,7 @@ namespace ui {
 					offset+=glm::vec3(+80, 140, 0);
 
 				auto model = glm::scale(glm::translate(glm::mat4{}, offset), glm::vec3(0.75f,0.75f,1.f));
-				_score_shader.set_uniform("model",model);
+				_score_shader->set_uniform("model",model);
 				_score_mult_text.draw();
 			}
 		}
@@ -19,7 +19,7 @@
 #include <core/utils/events.hpp>
 
 #include <core/renderer/graphics_ctx.hpp>
-#include <core/renderer/shader.hpp>
+#include <core/renderer/program_cache.hpp>
 #include <core/renderer/text.hpp>
 #include <core/renderer/camera.hpp>
 #include <core/renderer/primitives.hpp>
@@ -46,18 +46,18 @@ namespace ui {
 			Ui_comp::Pool& _ui_comps;
 
 			renderer::Camera _cam;
-			renderer::Shader_program _hud_shader;
-			renderer::Shader_program _health_shader;
+			renderer::Shader_program_ptr _hud_shader;
+			renderer::Shader_program_ptr _health_shader;
 			renderer::Object _hud;
 			renderer::Texture_ptr _hud_bg_tex;
 			renderer::Texture_ptr _hud_fg_tex;
 			renderer::Texture_ptr _hud_health_tex;
 			renderer::Texture_ptr _hud_health_min_tex;
 
-			renderer::Shader_program _score_shader;
+			renderer::Shader_program_ptr _score_shader;
 			renderer::Font_ptr    _score_font;
 			renderer::Font_ptr     _score_mult_font;
-			renderer::Text_dynamic _score_text;
+			std::vector<renderer::Text_dynamic> _score_texts; //< one per hud, updated incrementally
 			renderer::Text_dynamic _score_mult_text;
 
 			renderer::Textured_box _join_msg;
@@ -0,0 +1,177 @@
+/**************************************************************************\
+ * ai_bench - determinism and scaling check for the ai system             *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+/*
+ * Simulates the ai of a growing number of agents on an open level and
+ *   compares the intents of the parallel "sense and decide" phase with the
+ *   ones of a single thread, as well as two worlds created with the same seed.
+ *
+ * usage: ai_bench [--agents N] [--threads N] [--frames N] [--assets DIR] [--write-dir DIR]
+ *
+ *  --agents     largest number of agents (starts at 256 and doubles up to N)
+ *  --threads    worker threads of the parallel pool (default: hardware threads - 1)
+ *  --assets     directory containing the assets (default: the working directory)
+ *  --write-dir  write directory of the asset manager (default: ~/.config/MagnumOpus_ai_bench)
+ *
+ * Returns 0 on success and 1 if the intents differ.
+ */
+
+#include "core/asset/asset_manager.hpp"
+#include "core/ecs/ecs.hpp"
+#include "core/utils/stopwatch.hpp"
+#include "core/utils/thread_pool.hpp"
+
+#include "game/level/level.hpp"
+#include "game/sys/ai/ai_system.hpp"
+#include "game/sys/physics/transform_comp.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
+using namespace mo;
+using namespace mo::unit_literals;
+
+namespace {
+	constexpr auto seed = uint64_t(42);
+	constexpr auto level_size = 256;
+
+	auto open_level() {
+		auto rooms = std::vector<level::Room>{
+			level::Room(1, 1, level_size-2, level_size-2, level::Room_type::start, 0)
+		};
+		auto level = level::Level{level::Tile_type::floor_tile, level_size, level_size, rooms};
+
+		// a few pillars, so the agents have to avoid walls and can't see everything
+		for(auto y=8; y<level_size-8; y+=16)
+			for(auto x=8; x<level_size-8; x+=16)
+				level.set(x, y, level::Tile_type::wall_stone);
+
+		return level;
+	}
+
+	/// agents and targets at random positions; the same for each call
+	struct World {
+		ecs::Entity_manager entities;
+		std::vector<ecs::Entity_ptr> owned;
+		sys::ai::Ai_system ai;
+
+		World(asset::Asset_manager& assets, level::Level& level, util::Thread_pool& pool, int agents)
+		    : entities(assets), ai(entities, level, pool, seed) {
+			entities.register_component_type<sys::physics::Transform_comp>();
+
+			auto rng = std::mt19937{7};
+			auto pos = std::uniform_real_distribution<float>{2.f, level_size-3.f};
+			auto rot = std::uniform_real_distribution<float>{0.f, 360.f};
+
+			auto spawn = [&](bool agent) {
+				auto e = entities.emplace();
+				e->emplace<sys::physics::Transform_comp>(Distance(pos(rng)), Distance(pos(rng)),
+				                                         rot(rng)*1_deg);
+				if(agent)
+					e->emplace<sys::ai::Simple_ai_comp>();
+				else
+					e->emplace<sys::ai::Target_tag_comp>();
+				owned.push_back(e);
+			};
+
+			for(auto i=0; i<agents/64+1; ++i)
+				spawn(false);
+			for(auto i=0; i<agents; ++i)
+				spawn(true);
+		}
+	};
+}
+
+int main(int argc, char** argv) {
+	auto max_agents = 16384;
+	auto threads = -1;
+	auto frames = 20;
+	std::string asset_dir;
+	std::string write_dir;
+
+	for(auto i=1; i<argc; ++i) {
+		auto arg = std::string(argv[i]);
+		auto has_value = i+1<argc;
+
+		if(arg=="--agents" && has_value)       max_agents = std::atoi(argv[++i]);
+		else if(arg=="--threads" && has_value) threads = std::atoi(argv[++i]);
+		else if(arg=="--frames" && has_value)  frames = std::atoi(argv[++i]);
+		else if(arg=="--assets" && has_value)  asset_dir = argv[++i];
+		else if(arg=="--write-dir" && has_value) write_dir = argv[++i];
+		else {
+			std::cerr<<"usage: "<<argv[0]<<" [--agents N] [--threads N] [--frames N]"
+			           " [--assets DIR] [--write-dir DIR]"<<std::endl;
+			return 1;
+		}
+	}
+
+	asset::Asset_manager assets(argc>0 ? argv[0] : "", "MagnumOpus_ai_bench", asset_dir, write_dir);
+
+	util::Thread_pool serial{0};
+	util::Thread_pool parallel{threads};
+	auto level = open_level();
+	constexpr auto dt = Time(1.f/60);
+
+	std::cout<<"Sense and decide phase (ms/frame)"<<std::endl;
+	std::cout<<"  "<<std::setw(8)<<"agents"<<std::setw(12)<<"1 thread"
+	         <<std::setw(12)<<(std::to_string(parallel.concurrency())+" threads")
+	         <<std::setw(12)<<"speedup"<<std::setw(14)<<"us/agent"<<std::endl;
+
+	auto failed = false;
+
+	for(auto agents=256; agents<=max_agents && !failed; agents*=2) {
+		auto world = std::make_unique<World>(assets, level, parallel, agents);
+		auto twin = std::make_unique<World>(assets, level, serial, agents);
+
+		auto serial_ms = 0.f;
+		auto parallel_ms = 0.f;
+
+		for(auto f=0; f<frames && !failed; ++f) {
+			auto watch = util::Stopwatch{};
+			auto serial_hash = world->ai.decide(serial, dt);
+			serial_ms += watch.lap_ms();
+			auto parallel_hash = world->ai.decide(parallel, dt);
+			parallel_ms += watch.lap_ms();
+
+			if(serial_hash!=parallel_hash) {
+				std::cerr<<"Intents of "<<agents<<" agents differ between 1 and "
+				         <<parallel.concurrency()<<" threads in frame "<<f<<std::endl;
+				failed = true;
+			}
+			if(twin->ai.decide(serial, dt)!=serial_hash) {
+				std::cerr<<"Intents of "<<agents<<" agents differ between two worlds with the same seed in frame "
+				         <<f<<std::endl;
+				failed = true;
+			}
+
+			// the commit phase is always serial, so the results of the two pools can't diverge there
+			world->ai.update(dt);
+			twin->ai.update(dt);
+		}
+
+		std::cout<<"  "<<std::setw(8)<<agents<<std::fixed<<std::setprecision(3)
+		         <<std::setw(12)<<(serial_ms/frames)<<std::setw(12)<<(parallel_ms/frames)
+		         <<std::setw(11)<<std::setprecision(2)<<(serial_ms/parallel_ms)<<"x"
+		         <<std::setw(14)<<std::setprecision(3)<<(parallel_ms*1000.f/frames/agents)<<std::endl;
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,521 @@
+/**************************************************************************\
+ * atlas_builder - packs sprite and particle textures into atlas pages    *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+/*
+ * Packs the textures of the tex:-assets into a few atlas pages and writes the
+ *   mapping from their AIDs to the regions on the pages (cfg:texture_atlas).
+ *   Textures that are used with their own shaders (tilemaps, fonts, UI) and
+ *   textures that are larger than --max-size are not packed.
+ *
+ * Pages are only rewritten if one of their textures has changed, so the
+ *   hot-reload of a running game only has to reload the affected pages.
+ *   New textures are packed into new pages; --full repacks everything.
+ *
+ * usage: atlas_builder [--out DIR] [--page-size N] [--max-size N]
+ *                      [--exclude PATTERN]... [--full]
+ *
+ *  --out       directory of the pages (default: assets/textures/atlas); has
+ *              to be the atlas/-subdirectory of the tex:-directory, because
+ *              the pages are referenced as tex:atlas/page_N.tga
+ *  --page-size maximum width and height of a page (default: 2048)
+ *  --max-size  maximum width or height of a packed texture (default: 1024)
+ *  --exclude   textures whose AID contains PATTERN are not packed
+ *              (default: tilemap, font, ui_, element_)
+ *
+ * Returns 0 on success and 1 if a page couldn't be written or verified.
+ */
+
+#include "core/asset/asset_manager.hpp"
+#include "core/renderer/texture_atlas_data.hpp"
+#include "core/utils/log.hpp"
+#include "core/utils/stopwatch.hpp"
+
+#include <soil/stb_image_aug.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace mo;
+
+namespace {
+	constexpr auto padding = 1; //< extruded border around each texture
+	const auto page_prefix = std::string("atlas/page_");
+	const auto page_suffix = std::string(".tga");
+
+	struct Source {
+		std::string path;
+		std::vector<std::string> aids;
+		int width = 0, height = 0;
+		std::vector<uint8_t> pixels; //< RGBA, top row first
+		std::string hash;
+
+		int page = -1;
+		int x = 0, y = 0;
+	};
+
+	struct Page {
+		Page(int index, int width=0, int height=0)
+		    : index(index), width(width), height(height) {}
+
+		int index;
+		int width, height;
+		std::vector<Source*> sources;
+		bool dirty = false;   //< pixels have to be rewritten
+		bool repack = false;  //< the size of a texture has changed
+	};
+
+	auto page_aid(int index) {
+		return "tex:"+page_prefix+std::to_string(index)+page_suffix;
+	}
+	auto page_index(const std::string& aid) -> int {
+		auto name = asset::AID(aid).name();
+		if(!util::starts_with(name, page_prefix))
+			return -1;
+
+		return std::atoi(name.c_str()+page_prefix.size());
+	}
+
+	auto hash(const std::vector<uint8_t>& pixels, int width, int height) -> std::string {
+		auto h = 0xcbf29ce484222325ull;
+		auto add = [&](uint8_t v) {
+			h ^= v;
+			h *= 0x100000001b3ull;
+		};
+		for(auto v : {width, height})
+			for(auto i=0; i<4; ++i)
+				add(static_cast<uint8_t>(v>>(i*8)));
+
+		for(auto p : pixels)
+			add(p);
+
+		auto ss = std::stringstream{};
+		ss<<std::hex<<std::setw(16)<<std::setfill('0')<<h;
+		return ss.str();
+	}
+
+	auto load_source(const std::string& path, Source& s) -> bool {
+		int comp;
+		auto data = stbi_load(path.c_str(), &s.width, &s.height, &comp, 4);
+		if(!data) {
+			std::cerr<<"Couldn't decode "<<path<<": "<<stbi_failure_reason()<<std::endl;
+			return false;
+		}
+
+		s.path = path;
+		s.pixels.assign(data, data + s.width*s.height*4);
+		s.hash = hash(s.pixels, s.width, s.height);
+		stbi_image_free(data);
+		return true;
+	}
+
+	auto excluded(const std::string& name, const std::vector<std::string>& patterns) {
+		return std::any_of(patterns.begin(), patterns.end(), [&](auto& p) {
+			return name.find(p)!=std::string::npos;
+		});
+	}
+
+	auto next_pow2(int v) {
+		auto r = 1;
+		while(r<v)
+			r*=2;
+		return r;
+	}
+
+	/**
+	 * Shelf packing: the textures (sorted by height) are placed left to right
+	 *   on horizontal shelves; a new shelf is started below the last one, if
+	 *   none of the existing ones has enough space left.
+	 * Textures that don't fit into the page are returned.
+	 */
+	auto pack(Page& page, std::vector<Source*> sources, int page_size) -> std::vector<Source*> {
+		struct Shelf {
+			int y, height, x;
+		};
+
+		std::sort(sources.begin(), sources.end(), [](auto a, auto b) {
+			return std::make_tuple(-a->height, -a->width, a->path) <
+			       std::make_tuple(-b->height, -b->width, b->path);
+		});
+
+		auto shelves = std::vector<Shelf>{};
+		auto overflow = std::vector<Source*>{};
+		auto used_width = 0;
+		auto used_height = 0;
+
+		for(auto s : sources) {
+			auto w = s->width  + 2*padding;
+			auto h = s->height + 2*padding;
+
+			auto best = static_cast<Shelf*>(nullptr);
+			for(auto& shelf : shelves) {
+				if(shelf.height>=h && shelf.x+w<=page_size && (!best || shelf.height<best->height))
+					best = &shelf;
+			}
+
+			if(!best) {
+				if(used_height+h>page_size || w>page_size) {
+					overflow.push_back(s);
+					continue;
+				}
+				shelves.push_back(Shelf{used_height, h, 0});
+				used_height += h;
+				best = &shelves.back();
+			}
+
+			s->page = page.index;
+			s->x = best->x + padding;
+			s->y = best->y + padding;
+			best->x += w;
+			used_width = std::max(used_width, best->x);
+			page.sources.push_back(s);
+		}
+
+		page.width  = next_pow2(used_width);
+		page.height = next_pow2(used_height);
+		page.dirty = true;
+		page.repack = false;
+
+		return overflow;
+	}
+
+	auto compose(const Page& page) -> std::vector<uint8_t> {
+		auto pixels = std::vector<uint8_t>(page.width*page.height*4, 0);
+
+		for(auto s : page.sources) {
+			// copy the texture and extrude its border, so linear filtering
+			//   doesn't bleed into its neighbours
+			for(auto y=-padding; y<s->height+padding; ++y) {
+				auto sy = std::min(std::max(y, 0), s->height-1);
+				for(auto x=-padding; x<s->width+padding; ++x) {
+					auto sx = std::min(std::max(x, 0), s->width-1);
+					auto src = &s->pixels[(sy*s->width + sx)*4];
+					auto dst = &pixels[((s->y+y)*page.width + s->x+x)*4];
+					std::copy(src, src+4, dst);
+				}
+			}
+		}
+
+		return pixels;
+	}
+
+	/// 32 bit RLE compressed TGA with the origin in the top-left corner
+	auto write_tga(const std::string& path, const std::vector<uint8_t>& rgba,
+	               int width, int height) -> bool {
+		auto out = std::ofstream(path, std::ios::binary);
+		if(!out)
+			return false;
+
+		uint8_t header[18] = {};
+		header[2]  = 10;
+		header[12] = width & 0xff;
+		header[13] = (width>>8) & 0xff;
+		header[14] = height & 0xff;
+		header[15] = (height>>8) & 0xff;
+		header[16] = 32;
+		header[17] = 0x28;
+		out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+		auto pixel = [&](int x, int y) {
+			return &rgba[(y*width + x)*4];
+		};
+		auto same = [&](int x, int y, int x2) {
+			return std::equal(pixel(x,y), pixel(x,y)+4, pixel(x2,y));
+		};
+		auto write_pixel = [&](const uint8_t* p) {
+			char bgra[4] = {char(p[2]), char(p[1]), char(p[0]), char(p[3])};
+			out.write(bgra, 4);
+		};
+
+		// packets don't cross scanlines
+		for(auto y=0; y<height; ++y) {
+			for(auto x=0; x<width; ) {
+				auto run = 1;
+				while(x+run<width && run<128 && same(x,y,x+run))
+					run++;
+
+				if(run>1) {
+					out.put(static_cast<char>(0x80 | (run-1)));
+					write_pixel(pixel(x,y));
+					x += run;
+					continue;
+				}
+
+				auto raw = 1;
+				while(x+raw<width && raw<128 && !(x+raw+1<width && same(x+raw,y,x+raw+1)))
+					raw++;
+
+				out.put(static_cast<char>(raw-1));
+				for(auto i=0; i<raw; ++i)
+					write_pixel(pixel(x+i,y));
+				x += raw;
+			}
+		}
+
+		return out.good();
+	}
+
+	auto verify_tga(const std::string& path, const std::vector<uint8_t>& rgba,
+	                int width, int height) -> bool {
+		int w, h, comp;
+		auto data = stbi_load(path.c_str(), &w, &h, &comp, 4);
+		if(!data)
+			return false;
+
+		auto equal = w==width && h==height && std::equal(rgba.begin(), rgba.end(), data);
+		stbi_image_free(data);
+		return equal;
+	}
+
+	auto read_atlas(const std::string& path) -> renderer::Atlas_data {
+		auto in = std::ifstream(path);
+		if(!in)
+			return {};
+
+		return renderer::load_atlas_data(in);
+	}
+}
+
+int main(int argc, char** argv) {
+	auto out_dir = std::string("assets/textures/atlas");
+	auto page_size = 2048;
+	auto max_size = 1024;
+	auto patterns = std::vector<std::string>{};
+	auto full = false;
+
+	for(auto i=1; i<argc; ++i) {
+		auto arg = std::string(argv[i]);
+		auto has_value = i+1<argc;
+
+		if(arg=="--out" && has_value)             out_dir = argv[++i];
+		else if(arg=="--page-size" && has_value)  page_size = std::atoi(argv[++i]);
+		else if(arg=="--max-size" && has_value)   max_size = std::atoi(argv[++i]);
+		else if(arg=="--exclude" && has_value)    patterns.push_back(argv[++i]);
+		else if(arg=="--full")                    full = true;
+		else {
+			std::cerr<<"usage: "<<argv[0]<<" [--out DIR] [--page-size N] [--max-size N]"
+			         <<" [--exclude PATTERN]... [--full]"<<std::endl;
+			return 1;
+		}
+	}
+
+	if(patterns.empty())
+		patterns = {"tilemap", "font", "ui_", "element_"};
+
+	max_size = std::min(max_size, page_size - 2*padding);
+
+	auto watch = util::Stopwatch{};
+
+	// own write directory, the pages are written directly into the asset directory
+	asset::Asset_manager assets(argc>0 ? argv[0] : "", "MagnumOpus_atlas_builder");
+
+
+	// collect the textures; multiple AIDs may refer to the same file
+	auto sources = std::vector<std::unique_ptr<Source>>{};
+	auto source_by_path = std::unordered_map<std::string, Source*>{};
+	auto excluded_paths = std::vector<std::string>{};
+
+	auto aids = assets.list(asset::Asset_type::tex);
+	std::sort(aids.begin(), aids.end(), [](auto& a, auto& b) {return a.str()<b.str();});
+
+	for(auto& aid : aids) {
+		if(util::starts_with(aid.name(), "atlas"))
+			continue;
+
+		auto path = assets.physical_location(aid);
+		if(path.is_nothing())
+			continue;
+
+		// the same file may be reached through different paths (e.g. textures//x.png)
+		auto p = path.get_or_throw();
+		for(auto pos=p.find("//"); pos!=std::string::npos; pos=p.find("//"))
+			p.erase(pos, 1);
+
+		if(excluded(aid.name(), patterns)) {
+			excluded_paths.push_back(p);
+			continue;
+		}
+
+		auto& source = source_by_path[p];
+		if(!source) {
+			auto s = std::make_unique<Source>();
+			if(!load_source(p, *s))
+				continue;
+
+			source = s.get();
+			sources.push_back(std::move(s));
+		}
+
+		source->aids.push_back(aid.str());
+	}
+
+	// a file is excluded if any of its AIDs is (e.g. tex:x_font and tex:x.template_regular_48.tga)
+	sources.erase(std::remove_if(sources.begin(), sources.end(), [&](auto& s) {
+		auto too_large = s->width>max_size || s->height>max_size;
+		auto excluded = std::find(excluded_paths.begin(), excluded_paths.end(), s->path)
+		                !=excluded_paths.end();
+		if(too_large && !excluded)
+			std::cout<<"Not packed (too large): "<<s->path<<" ("<<s->width<<"x"<<s->height<<")"<<std::endl;
+
+		return too_large || excluded;
+	}), sources.end());
+
+
+	// reuse the pages of the last run, as long as their textures still fit
+	auto old_path = out_dir+"/atlas.json";
+	auto old = full ? renderer::Atlas_data{} : read_atlas(old_path);
+
+	auto pages = std::vector<Page>{};
+	auto old_entries = std::unordered_map<std::string, std::pair<int, const renderer::Atlas_entry_data*>>{};
+	for(auto& p : old.pages) {
+		auto index = page_index(p.texture);
+		if(index<0)
+			continue;
+
+		pages.push_back(Page{index, p.width, p.height});
+		for(auto& e : p.entries)
+			old_entries[e.texture] = {static_cast<int>(pages.size()-1), &e};
+	}
+
+	auto pool = std::vector<Source*>{};
+	for(auto& s : sources) {
+		auto old_entry = static_cast<const renderer::Atlas_entry_data*>(nullptr);
+		auto old_page = -1;
+		for(auto& aid : s->aids) {
+			auto iter = old_entries.find(aid);
+			if(iter!=old_entries.end()) {
+				std::tie(old_page, old_entry) = iter->second;
+				break;
+			}
+		}
+
+		if(!old_entry) {
+			pool.push_back(s.get());
+			continue;
+		}
+
+		auto& page = pages[old_page];
+		page.sources.push_back(s.get());
+		s->page = page.index;
+		s->x = old_entry->x;
+		s->y = old_entry->y;
+
+		if(old_entry->width!=s->width || old_entry->height!=s->height)
+			page.repack = true;
+		else if(old_entry->hash!=s->hash)
+			page.dirty = true;
+	}
+
+	for(auto& page : pages) {
+		if(page.repack) {
+			auto page_sources = std::move(page.sources);
+			page.sources.clear();
+			auto overflow = pack(page, std::move(page_sources), page_size);
+			pool.insert(pool.end(), overflow.begin(), overflow.end());
+		}
+	}
+
+	auto next_index = 0;
+	for(auto& page : pages)
+		next_index = std::max(next_index, page.index+1);
+
+	while(!pool.empty()) {
+		pages.push_back(Page{next_index++});
+		auto overflow = pack(pages.back(), pool, page_size);
+		if(overflow.size()==pool.size()) {
+			std::cerr<<"Couldn't pack "<<pool.front()->path<<" into a page"<<std::endl;
+			return 1;
+		}
+		pool = std::move(overflow);
+	}
+
+
+	// write the pages that have changed and remove the ones that are empty now
+	auto data = renderer::Atlas_data{};
+	auto written = 0;
+	auto failed = false;
+	auto used_pixels = 0ll;
+	auto page_pixels = 0ll;
+
+	std::sort(pages.begin(), pages.end(), [](auto& a, auto& b) {return a.index<b.index;});
+
+	for(auto& page : pages) {
+		auto path = out_dir+"/page_"+std::to_string(page.index)+page_suffix;
+
+		if(page.sources.empty()) {
+			std::remove(path.c_str());
+			continue;
+		}
+
+		auto exists = std::ifstream(path).good();
+		if(page.dirty || !exists) {
+			auto pixels = compose(page);
+			if(!write_tga(path, pixels, page.width, page.height) ||
+			   !verify_tga(path, pixels, page.width, page.height)) {
+				std::cerr<<"Couldn't write "<<path<<" (does the directory exist?)"<<std::endl;
+				failed = true;
+			}
+			written++;
+		}
+
+		auto page_data = renderer::Atlas_page_data{page_aid(page.index), page.width, page.height, {}};
+		for(auto s : page.sources) {
+			for(auto& aid : s->aids)
+				page_data.entries.push_back({aid, s->x, s->y, s->width, s->height, s->hash});
+
+			used_pixels += s->width * s->height;
+		}
+		std::sort(page_data.entries.begin(), page_data.entries.end(), [](auto& a, auto& b) {
+			return a.texture<b.texture;
+		});
+		page_pixels += page.width * page.height;
+
+		data.pages.push_back(std::move(page_data));
+	}
+
+	// the mapping is only rewritten if it has changed, to avoid unnecessary reloads
+	auto new_mapping = std::stringstream{};
+	renderer::store_atlas_data(new_mapping, data);
+
+	auto old_mapping = std::stringstream{};
+	old_mapping<<std::ifstream(old_path).rdbuf();
+
+	if(old_mapping.str()!=new_mapping.str()) {
+		auto out = std::ofstream(old_path);
+		out<<new_mapping.str();
+		if(!out) {
+			std::cerr<<"Couldn't write "<<old_path<<std::endl;
+			failed = true;
+		}
+	}
+
+	std::cout<<"Packed "<<sources.size()<<" textures into "<<data.pages.size()<<" pages ("
+	         <<written<<" written, "<<std::fixed<<std::setprecision(1)
+	         <<(page_pixels>0 ? 100.0*used_pixels/page_pixels : 0.0)<<"% used) in "
+	         <<watch.ms()<<"ms"<<std::endl;
+	for(auto& p : data.pages)
+		std::cout<<"  "<<p.texture<<": "<<p.width<<"x"<<p.height<<", "<<p.entries.size()<<" AIDs"<<std::endl;
+
+	return failed ? 1 : 0;
+}
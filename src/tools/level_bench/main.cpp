@@ -0,0 +1,621 @@
+/**************************************************************************\
+ * level_bench - benchmark and determinism check for the level generator  *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+/*
+ * Generates levels for a range of seeds and depths with the real cfg:dungeons
+ *   and reports the time spent in each stage of the generator, as well as the
+ *   cost of solid-queries on the last generated level. Also checks that the
+ *   route cache of the ai notices doors that have been toggled.
+ *
+ * usage: level_bench [--seeds N] [--depths N] [--difficulty N]
+ *                    [--write FILE] [--verify FILE] [--max-ms MS] [--cache N]
+ *                    [--stream SIZE] [--assets DIR] [--write-dir DIR]
+ *
+ *  --write   stores the hash of each generated level in FILE
+ *  --verify  regenerates the levels listed in FILE and compares their hashes
+ *  --max-ms  fails if a level takes longer than MS on average
+ *  --cache   compares loading the first N levels from the level cache with
+ *            generating them (uses its own write directory)
+ *  --stream  writes a SIZExSIZE level, streams it along its diagonal and checks
+ *            the streamed tiles, that the resident chunks stay bounded and that
+ *            the ai perception data is only updated around the streamed chunks
+ *  --assets     directory containing the assets (default: the working directory)
+ *  --write-dir  directory for the cache and streamed levels (default: ~/.config/MagnumOpus_level_bench)
+ *
+ * Returns 0 on success and 1 if the output or the timing doesn't match.
+ */
+
+#include "core/asset/asset_manager.hpp"
+#include "core/utils/log.hpp"
+#include "core/utils/stopwatch.hpp"
+
+#include "game/level/level.hpp"
+#include "game/level/level_cache.hpp"
+#include "game/level/level_file.hpp"
+#include "game/level/level_generator.hpp"
+#include "game/sys/ai/perception_data.hpp"
+#include "game/sys/ai/route_cache.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
+using namespace mo;
+
+namespace {
+	struct Sample {
+		uint64_t seed;
+		int depth;
+		int difficulty;
+		uint64_t hash = 0;
+	};
+
+	class Fnv1a {
+		public:
+			void add(uint64_t v)noexcept {
+				for(auto i=0; i<8; ++i, v>>=8) {
+					_hash ^= v & 0xff;
+					_hash *= 0x100000001b3ull;
+				}
+			}
+			auto value()const noexcept {return _hash;}
+
+		private:
+			uint64_t _hash = 0xcbf29ce484222325ull;
+	};
+
+	auto hash(const level::Level& level) -> uint64_t {
+		auto h = Fnv1a{};
+		h.add(level.width());
+		h.add(level.height());
+
+		for(auto y=0; y<level.height(); ++y) {
+			for(auto x=0; x<level.width(); ++x) {
+				auto& tile = level.get(x,y);
+				h.add(static_cast<uint64_t>(tile.type));
+				h.add(tile.elements.value);
+			}
+		}
+
+		h.add(level.room_count());
+		for(auto i=0u; i<level.room_count(); ++i) {
+			auto& r = level.room(i);
+			h.add(static_cast<uint64_t>(r.top));
+			h.add(static_cast<uint64_t>(r.left));
+			h.add(static_cast<uint64_t>(r.right));
+			h.add(static_cast<uint64_t>(r.bottom));
+			h.add(static_cast<uint64_t>(r.type));
+		}
+
+		return h.value();
+	}
+
+	auto read_samples(const std::string& path) -> std::vector<Sample> {
+		auto samples = std::vector<Sample>{};
+
+		std::ifstream in(path);
+		if(!in)
+			std::cerr<<"Unable to open "<<path<<std::endl;
+
+		Sample s;
+		while(in>>s.seed>>s.depth>>s.difficulty>>std::hex>>s.hash>>std::dec)
+			samples.push_back(s);
+
+		return samples;
+	}
+
+	void write_samples(const std::string& path, const std::vector<Sample>& samples) {
+		std::ofstream out(path);
+		for(auto& s : samples)
+			out<<s.seed<<" "<<s.depth<<" "<<s.difficulty<<" "
+			   <<std::hex<<s.hash<<std::dec<<"\n";
+	}
+
+	/// compares the solid-layer of the level with the per-tile query; returns false if they differ
+	auto bench_queries(const level::Level& level) -> bool {
+		constexpr auto query_count = 1<<22;
+
+		// includes a few coordinates just outside of the level
+		auto rng = std::mt19937{42};
+		auto x_dist = std::uniform_int_distribution<int>{-1, level.width()};
+		auto y_dist = std::uniform_int_distribution<int>{-1, level.height()};
+		auto queries = std::vector<std::pair<int,int>>{};
+		queries.reserve(query_count);
+		for(auto i=0; i<query_count; ++i)
+			queries.emplace_back(x_dist(rng), y_dist(rng));
+
+		auto tile_solid = [&](int x, int y) {
+			return x>=0 && y>=0 && x<level.width() && y<level.height() ? level.get(x,y).solid() : true;
+		};
+
+		auto measure = [&](const char* name, auto&& query) {
+			auto solid_count = 0;
+			auto watch = util::Stopwatch{};
+			for(auto& q : queries)
+				solid_count += query(q.first, q.second) ? 1 : 0;
+
+			std::cout<<"  "<<std::left<<std::setw(16)<<name<<std::right<<std::fixed<<std::setprecision(3)
+			         <<std::setw(12)<<(watch.ms()*1000000.f/query_count)<<" ns/query"<<std::endl;
+			return solid_count;
+		};
+
+		std::cout<<"Solid queries on a "<<level.width()<<"x"<<level.height()<<" level"<<std::endl;
+		auto expected  = measure("Tile::solid",     tile_solid);
+		auto layer     = measure("solid",           [&](int x, int y){return level.solid(x,y);});
+		auto unchecked = measure("solid_unchecked", [&](int x, int y){return level.solid_unchecked(x,y);});
+
+		auto equal = true;
+		for(auto& q : queries) {
+			if(tile_solid(q.first, q.second)!=level.solid(q.first, q.second)) {
+				std::cerr<<"Solid layer differs from the tiles at "<<q.first<<"/"<<q.second<<std::endl;
+				equal = false;
+				break;
+			}
+		}
+
+		return equal && expected==layer && layer==unchecked;
+	}
+
+	/**
+	 * Queries routes between two rooms that are connected by a short corridor with a door
+	 *   and a long detour and toggles the door; returns false if the Route_cache returns a
+	 *   stale route or doesn't count the hits, misses and evictions as expected.
+	 */
+	auto check_routes() -> bool {
+		using namespace unit_literals;
+
+		constexpr auto width = 40;
+		constexpr auto height = 24;
+		constexpr auto door_x = 20;
+		constexpr auto door_y = 6;
+
+		auto floor = [](int x, int y) {
+			auto in_room = y>=2 && y<10 && ((x>=2 && x<10) || (x>=30 && x<38));
+			auto corridor = y==door_y && x>=10 && x<30;
+			auto detour = (y>=10 && y<=20 && (x==6 || x==34)) || (y==20 && x>=6 && x<=34);
+			return in_room || corridor || detour;
+		};
+
+		auto tiles = std::vector<level::Tile>();
+		for(auto y=0; y<height; ++y) {
+			for(auto x=0; x<width; ++x) {
+				auto type = x==door_x && y==door_y ? level::Tile_type::door_open_we
+				          : floor(x,y)             ? level::Tile_type::floor_stone
+				                                   : level::Tile_type::wall_stone;
+				tiles.push_back(level::Tile{type, level::Elements{}});
+			}
+		}
+
+		auto rooms = std::vector<level::Room>{};
+		rooms.emplace_back(2, 2, 10, 10, level::Room_type::normal, 0);
+		rooms.emplace_back(2, 30, 38, 10, level::Room_type::normal, 1);
+
+		auto level = level::Level{width, height, std::move(tiles), std::move(rooms)};
+		auto perception = sys::ai::Perception_data{level};
+		auto cache = sys::ai::Route_cache{level, perception, 1};
+
+		auto valid = true;
+		auto expect = [&](bool condition, const char* msg) {
+			if(!condition) {
+				std::cerr<<"Route cache: "<<msg<<std::endl;
+				valid = false;
+			}
+		};
+		auto through_door = [&](const util::path& path) {
+			return std::any_of(path.begin(), path.end(), [&](auto& p) {
+				return p.x==door_x && p.y==door_y;
+			});
+		};
+
+		auto open_route = cache.route(0, 1);
+		expect(cache.misses()==1 && cache.hits()==0, "the first query isn't a miss");
+		expect(!open_route.empty() && through_door(open_route), "the route doesn't use the open door");
+
+		cache.route(0, 1);
+		expect(cache.hits()==1 && cache.misses()==1, "the repeated query isn't a hit");
+
+		auto from = Position{4_m, 4_m};
+		auto to = Position{35_m, 8_m};
+		auto path = cache.find_path(from, to);
+		expect(cache.hits()==2, "a path between the rooms doesn't use the cached route");
+		expect(!path.empty() && path.back()==util::position(35, 8), "the spliced path doesn't reach its target");
+
+		level.toggle(door_x, door_y);
+		perception.update();
+
+		auto closed_route = cache.route(0, 1);
+		expect(cache.misses()==2 && cache.hits()==2, "the query after toggling the door isn't a miss");
+		expect(!closed_route.empty() && !through_door(closed_route), "the route still uses the closed door");
+		expect(closed_route.size()>open_route.size(), "the detour isn't longer than the route through the door");
+
+		cache.route(1, 0);
+		expect(cache.misses()==3 && cache.evictions()==1, "the full cache didn't evict its oldest route");
+
+		level.toggle(door_x, door_y);
+		perception.update();
+		expect(cache.route(0, 1)==open_route, "the route after reopening the door differs");
+		expect(cache.misses()==4, "the query after reopening the door isn't a miss");
+
+		cache.invalidate();
+		cache.route(0, 1);
+		expect(cache.misses()==5, "the query after invalidate() isn't a miss");
+
+		std::cout<<"Routes through a toggled door"<<std::endl;
+		std::cout<<"  open            "<<std::setw(12)<<open_route.size()<<" tiles\n"
+		         <<"  closed          "<<std::setw(12)<<closed_route.size()<<" tiles\n"
+		         <<"  hits/misses     "<<std::setw(12)<<cache.hits()<<" / "<<cache.misses()
+		         <<" ("<<cache.evictions()<<" evictions)"<<std::endl;
+
+		return valid;
+	}
+
+	/// stores and reloads the levels through the Level_cache; returns false if they differ
+	auto bench_cache(asset::Asset_manager& assets, const std::vector<level::Dungeon_cfg>& cfgs,
+	                 const std::vector<Sample>& samples, std::size_t count) -> bool {
+		auto cache = level::Level_cache{assets};
+		count = std::min(count, samples.size());
+
+		auto generate_ms = 0.f;
+		auto store_ms = 0.f;
+		auto load_ms = 0.f;
+		auto hits = 0u;
+		auto equal = true;
+
+		for(auto i=0u; i<count; ++i) {
+			auto& s = samples[i];
+			auto& cfg = cfgs.at(std::max(0, s.depth));
+
+			auto watch = util::Stopwatch{};
+			auto level = level::generate_level(cfg, s.seed, s.depth, s.difficulty);
+			generate_ms += watch.lap_ms();
+
+			cache.store(cfg, s.seed, s.depth, s.difficulty, level);
+			store_ms += watch.lap_ms();
+
+			if(!cache.contains(cfg, s.seed, s.depth, s.difficulty)) {
+				std::cerr<<"Level "<<s.seed<<"/"<<s.depth<<" is missing from the level cache"<<std::endl;
+				equal = false;
+				continue;
+			}
+
+			watch.lap_ms();
+			auto cached = cache.load(cfg, s.seed, s.depth, s.difficulty);
+			load_ms += watch.lap_ms();
+
+			if(cached.is_nothing()) {
+				std::cerr<<"Cached level "<<s.seed<<"/"<<s.depth<<" couldn't be loaded"<<std::endl;
+				equal = false;
+
+			} else if(hash(cached.get_or_throw())!=hash(level)) {
+				std::cerr<<"Cached level "<<s.seed<<"/"<<s.depth<<" differs from the generated one"<<std::endl;
+				equal = false;
+
+			} else
+				hits++;
+		}
+
+		std::cout<<"Level cache ("<<hits<<" of "<<count<<" levels loaded)"<<std::endl;
+		std::cout<<std::fixed<<std::setprecision(3)
+		         <<"  generate        "<<std::setw(12)<<(generate_ms/count)<<" ms/level\n"
+		         <<"  store           "<<std::setw(12)<<(store_ms/count)<<" ms/level\n"
+		         <<"  load            "<<std::setw(12)<<(load_ms/std::max(1u, hits))<<" ms/level";
+		if(hits>0 && load_ms>0.f)
+			std::cout<<" ("<<std::setprecision(1)<<(generate_ms/count)/(load_ms/hits)<<"x faster than generating)";
+		std::cout<<std::endl;
+
+		return equal && hits==count;
+	}
+
+	/// streams a large level along its diagonal; returns false if a tile differs or too many chunks are resident
+	auto bench_streaming(asset::Asset_manager& assets, int size) -> bool {
+		constexpr auto radius = 96;
+		constexpr auto step = 16;
+
+		// a free corridor along the diagonal connects the rooms on it
+		auto expected_type = [](int x, int y) {
+			return (x*7 + y*13) % 5==0 && std::abs(x-y)>2 ? level::Tile_type::wall_stone
+			                                              : level::Tile_type::floor_stone;
+		};
+
+		auto aid = asset::AID{asset::Asset_type::gen, "level_bench_stream.mlvl"};
+		{
+			auto tiles = std::vector<level::Tile>();
+			tiles.reserve(static_cast<std::size_t>(size)*size);
+			for(auto y=0; y<size; ++y)
+				for(auto x=0; x<size; ++x)
+					tiles.push_back(level::Tile{expected_type(x,y), level::Elements{}});
+
+			// rooms along the diagonal, so their visibility changes while they are streamed
+			auto rooms = std::vector<level::Room>{};
+			for(auto p=32; p+24<size; p+=radius)
+				rooms.emplace_back(p, p, p+24, p+24, level::Room_type::normal, rooms.size());
+
+			assets.save(aid, level::Level{size, size, std::move(tiles), std::move(rooms)});
+		}
+
+		auto path = assets.physical_location(aid);
+		if(path.is_nothing()) {
+			std::cerr<<"Unable to locate the streamed level "<<aid.str()<<std::endl;
+			return false;
+		}
+
+		auto file = util::Mapped_file{path.get_or_throw()};
+		auto level = level::Level{};
+		level::load_level_file(level, level::Level_file_view{file.data(), file.size()}, path.get_or_throw());
+
+		// chunks touched by a square of 2*radius+1 tiles
+		auto max_resident = static_cast<std::size_t>((2*radius/level::level_chunk_size + 2)
+		                                            * (2*radius/level::level_chunk_size + 2));
+		auto peak_resident = std::size_t(0);
+		auto stream_ms = 0.f;
+		auto perception_ms = 0.f;
+		auto bake_ms = 0.f;
+		auto bakes = 0;
+		auto steps = 0;
+		auto valid = true;
+
+		auto perception = sys::ai::Perception_data{level};
+		auto content_revision = level.content_revision();
+
+		// the updated data has to match data baked from scratch
+		auto perception_valid = [&](int p) {
+			auto watch = util::Stopwatch{};
+			auto baked = sys::ai::Perception_data{level};
+			bake_ms += watch.ms();
+			bakes++;
+
+			for(auto y=std::max(0, p-2*radius); y<std::min(size, p+2*radius); ++y) {
+				for(auto x=std::max(0, p-2*radius); x<std::min(size, p+2*radius); ++x) {
+					if(perception.clearance(x,y)!=baked.clearance(x,y)) {
+						std::cerr<<"Updated clearance of "<<x<<"/"<<y<<" ("<<perception.clearance(x,y)
+						         <<") differs from the baked one ("<<baked.clearance(x,y)<<")"<<std::endl;
+						return false;
+					}
+				}
+			}
+
+			for(auto a=0; a<static_cast<int>(level.room_count()); ++a) {
+				for(auto b=0; b<static_cast<int>(level.room_count()); ++b) {
+					if(perception.room_visible(a,b)!=baked.room_visible(a,b)) {
+						std::cerr<<"Updated visibility of the rooms "<<a<<" and "<<b
+						         <<" differs from the baked one"<<std::endl;
+						return false;
+					}
+				}
+			}
+
+			return true;
+		};
+
+		for(auto p=0; p<size && valid; p+=step, ++steps) {
+			auto watch = util::Stopwatch{};
+			level.stream(p, p, radius);
+			stream_ms += watch.lap_ms();
+
+			perception.update();
+			perception_ms += watch.ms();
+
+			if(level.content_revision()!=content_revision || perception.outdated()) {
+				std::cerr<<"Streaming at "<<p<<"/"<<p<<" changed the content of the level"<<std::endl;
+				valid = false;
+			}
+			if(steps%16==0 && !perception_valid(p))
+				valid = false;
+
+			peak_resident = std::max(peak_resident, level.resident_chunks());
+			if(level.resident_chunks()>max_resident) {
+				std::cerr<<level.resident_chunks()<<" chunks are resident at "<<p<<"/"<<p
+				         <<", expected at most "<<max_resident<<std::endl;
+				valid = false;
+			}
+
+			for(auto o=-radius; o<=radius; o+=radius/4) {
+				auto x = p+o;
+				auto y = p-o;
+				if(x<0 || y<0 || x>=size || y>=size)
+					continue;
+
+				if(level.tile_type(x,y)!=expected_type(x,y)) {
+					std::cerr<<"Streamed tile "<<x<<"/"<<y<<" differs from the stored one"<<std::endl;
+					valid = false;
+					break;
+				}
+			}
+		}
+
+		auto chunks = (size+2 + level::level_chunk_size-1) / level::level_chunk_size;
+		std::cout<<"Streamed "<<size<<"x"<<size<<" level ("<<(chunks*chunks)<<" chunks)"<<std::endl;
+		std::cout<<std::fixed<<std::setprecision(3)
+		         <<"  stream          "<<std::setw(12)<<(stream_ms/std::max(1, steps))<<" ms/step\n"
+		         <<"  resident chunks "<<std::setw(12)<<peak_resident<<" (max "<<max_resident<<")\n"
+		         <<"  perception      "<<std::setw(12)<<(perception_ms/std::max(1, steps))<<" ms/step"
+		         <<" (full bake "<<(bake_ms/std::max(1, bakes))<<" ms)"<<std::endl;
+
+		assets.erase(aid);
+		return valid;
+	}
+
+	void print_stage(const char* name, float total, float max, std::size_t count) {
+		std::cout<<"  "<<std::left<<std::setw(16)<<name<<std::right<<std::fixed<<std::setprecision(3)
+		         <<std::setw(12)<<total
+		         <<std::setw(12)<<(total/count)
+		         <<std::setw(12)<<max<<std::endl;
+	}
+}
+
+int main(int argc, char** argv) {
+	auto seeds = 200;
+	auto depths = 10;
+	auto difficulty = 0;
+	auto max_ms = -1.f;
+	auto cache_count = 0;
+	auto stream_size = 0;
+	std::string write_path;
+	std::string verify_path;
+	std::string asset_dir;
+	std::string write_dir;
+
+	for(auto i=1; i<argc; ++i) {
+		auto arg = std::string(argv[i]);
+		auto has_value = i+1<argc;
+
+		if(arg=="--seeds" && has_value)           seeds = std::atoi(argv[++i]);
+		else if(arg=="--depths" && has_value)     depths = std::atoi(argv[++i]);
+		else if(arg=="--difficulty" && has_value) difficulty = std::atoi(argv[++i]);
+		else if(arg=="--max-ms" && has_value)     max_ms = static_cast<float>(std::atof(argv[++i]));
+		else if(arg=="--write" && has_value)      write_path = argv[++i];
+		else if(arg=="--verify" && has_value)     verify_path = argv[++i];
+		else if(arg=="--cache" && has_value)      cache_count = std::atoi(argv[++i]);
+		else if(arg=="--stream" && has_value)     stream_size = std::atoi(argv[++i]);
+		else if(arg=="--assets" && has_value)     asset_dir = argv[++i];
+		else if(arg=="--write-dir" && has_value)  write_dir = argv[++i];
+		else {
+			std::cerr<<"usage: "<<argv[0]<<" [--seeds N] [--depths N] [--difficulty N]"
+			           " [--write FILE] [--verify FILE] [--max-ms MS] [--cache N] [--stream SIZE]"
+			           " [--assets DIR] [--write-dir DIR]"<<std::endl;
+			return 1;
+		}
+	}
+
+	auto samples = std::vector<Sample>{};
+	if(!verify_path.empty()) {
+		samples = read_samples(verify_path);
+		if(samples.empty()) {
+			std::cerr<<"No levels to verify in "<<verify_path<<std::endl;
+			return 1;
+		}
+
+	} else {
+		for(auto seed=0; seed<seeds; ++seed)
+			for(auto depth=0; depth<depths; ++depth)
+				samples.push_back(Sample{static_cast<uint64_t>(seed), depth, difficulty});
+	}
+
+
+	// own write directory, so the cache of the game isn't touched
+	asset::Asset_manager assets(argc>0 ? argv[0] : "", "MagnumOpus_level_bench", asset_dir, write_dir);
+
+	// the configs are loaded up front, so only the generator itself is measured
+	auto max_depth = std::max_element(samples.begin(), samples.end(), [](auto& a, auto& b) {
+		return a.depth<b.depth;
+	})->depth;
+	auto cfgs = std::vector<level::Dungeon_cfg>{};
+	for(auto depth=0; depth<=max_depth; ++depth)
+		cfgs.push_back(level::load_dungeon_cfg(assets, depth));
+
+
+	auto total = level::Generator_stats{};
+	auto max = level::Generator_stats{};
+	auto max_level_ms = 0.f;
+	auto mismatches = 0;
+	auto unstable = 0;
+	auto last_level = level::Level{};
+
+	for(auto i=0u; i<samples.size(); ++i) {
+		auto& s = samples[i];
+		auto& cfg = cfgs.at(std::max(0, s.depth));
+
+		auto stats = level::Generator_stats{};
+		last_level = level::generate_level(cfg, s.seed, s.depth, s.difficulty, &stats);
+		auto h = hash(last_level);
+
+		// a second run in the same process catches state that leaks between calls
+		if(i%10==0 && hash(level::generate_level(cfg, s.seed, s.depth, s.difficulty))!=h) {
+			std::cerr<<"Level "<<s.seed<<"/"<<s.depth<<" differs between two runs"<<std::endl;
+			unstable++;
+		}
+
+		if(!verify_path.empty() && s.hash!=h) {
+			std::cerr<<"Level "<<s.seed<<"/"<<s.depth<<"/"<<s.difficulty<<" changed: "
+			         <<std::hex<<s.hash<<" -> "<<h<<std::dec<<std::endl;
+			mismatches++;
+		}
+		s.hash = h;
+
+		total.process_room   += stats.process_room;
+		total.filter_rooms   += stats.filter_rooms;
+		total.connect_rooms  += stats.connect_rooms;
+		total.build_level    += stats.build_level;
+		total.dig_corridors  += stats.dig_corridors;
+		total.decorate_rooms += stats.decorate_rooms;
+
+		max.process_room   = std::max(max.process_room,   stats.process_room);
+		max.filter_rooms   = std::max(max.filter_rooms,   stats.filter_rooms);
+		max.connect_rooms  = std::max(max.connect_rooms,  stats.connect_rooms);
+		max.build_level    = std::max(max.build_level,    stats.build_level);
+		max.dig_corridors  = std::max(max.dig_corridors,  stats.dig_corridors);
+		max.decorate_rooms = std::max(max.decorate_rooms, stats.decorate_rooms);
+		max_level_ms = std::max(max_level_ms, stats.total());
+	}
+
+	auto count = samples.size();
+	std::cout<<"Generated "<<count<<" levels"<<std::endl;
+	std::cout<<"  "<<std::left<<std::setw(16)<<"stage"<<std::right
+	         <<std::setw(12)<<"total ms"<<std::setw(12)<<"avg ms"<<std::setw(12)<<"max ms"<<std::endl;
+	print_stage("process_room",   total.process_room,   max.process_room,   count);
+	print_stage("filter_rooms",   total.filter_rooms,   max.filter_rooms,   count);
+	print_stage("connect_rooms",  total.connect_rooms,  max.connect_rooms,  count);
+	print_stage("build_level",    total.build_level,    max.build_level,    count);
+	print_stage("dig_corridors",  total.dig_corridors,  max.dig_corridors,  count);
+	print_stage("decorate_rooms", total.decorate_rooms, max.decorate_rooms, count);
+	print_stage("total",          total.total(),        max_level_ms,       count);
+
+	auto layers_valid = bench_queries(last_level);
+	auto routes_valid = check_routes();
+	auto cache_valid = cache_count<=0 || bench_cache(assets, cfgs, samples, cache_count);
+	auto stream_valid = stream_size<=0 || bench_streaming(assets, stream_size);
+
+	if(!write_path.empty())
+		write_samples(write_path, samples);
+
+	auto failed = false;
+
+	if(unstable>0) {
+		std::cerr<<unstable<<" levels are not reproducible"<<std::endl;
+		failed = true;
+	}
+	if(!layers_valid) {
+		std::cerr<<"The solid layer doesn't match the tiles"<<std::endl;
+		failed = true;
+	}
+	if(!routes_valid) {
+		std::cerr<<"The route cache returns stale routes"<<std::endl;
+		failed = true;
+	}
+	if(!cache_valid) {
+		std::cerr<<"The level cache doesn't reproduce the generated levels"<<std::endl;
+		failed = true;
+	}
+	if(!stream_valid) {
+		std::cerr<<"The streamed level doesn't match or isn't bounded"<<std::endl;
+		failed = true;
+	}
+	if(mismatches>0) {
+		std::cerr<<mismatches<<" of "<<count<<" levels don't match "<<verify_path<<std::endl;
+		failed = true;
+	}
+	if(max_ms>=0 && total.total()/count > max_ms) {
+		std::cerr<<"Average generation time "<<(total.total()/count)<<"ms exceeds "<<max_ms<<"ms"<<std::endl;
+		failed = true;
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/**************************************************************************\
+ * level_convert - converts between Tiled JSON maps and binary levels     *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+/*
+ * Converts Tiled JSON maps (e.g. the room templates in assets/rooms) into the
+ *   binary level format and binary levels back into Tiled JSON for editing.
+ *   The output is written next to the input (.json <-> .mlvl).
+ *
+ * usage: level_convert [--bench N] FILE...
+ *
+ *  --bench  loads each file N times in both formats and reports the average load time
+ */
+
+#include "core/utils/log.hpp"
+#include "core/utils/mapped_file.hpp"
+#include "core/utils/stopwatch.hpp"
+
+#include "game/level/level_file.hpp"
+#include "game/level/room_template.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+
+using namespace mo;
+
+namespace {
+	auto replace_extension(const std::string& path, const std::string& ext) -> std::string {
+		auto dot = path.find_last_of('.');
+		auto slash = path.find_last_of("/\\");
+		if(dot==std::string::npos || (slash!=std::string::npos && dot<slash))
+			return path + ext;
+
+		return path.substr(0, dot) + ext;
+	}
+
+	template<class F>
+	auto average_ms(int iterations, F&& f) -> float {
+		auto watch = util::Stopwatch{};
+		for(auto i=0; i<iterations; ++i)
+			f();
+
+		return watch.ms() / iterations;
+	}
+
+	void bench(const std::string& json_path, const std::string& binary_path, int iterations) {
+		auto json = std::string{};
+		{
+			std::ifstream in(json_path, std::ios::binary);
+			std::stringstream content;
+			content<<in.rdbuf();
+			json = content.str();
+		}
+
+		auto json_ms = average_ms(iterations, [&] {
+			std::istringstream in(json);
+			level::Room_template room;
+			room.import_tiled(in);
+		});
+
+		auto read_ms = average_ms(iterations, [&] {
+			std::ifstream in(binary_path, std::ios::binary);
+			level::Room_template room;
+			room.load(in);
+		});
+
+		auto mmap_ms = average_ms(iterations, [&] {
+			auto file = util::Mapped_file{binary_path};
+			level::Room_template room;
+			room.load(level::Level_file_view{file.data(), file.size()});
+		});
+
+		std::cout<<"  "<<std::fixed<<std::setprecision(4)
+		         <<"tiled json: "<<json_ms<<"ms, binary (read): "<<read_ms
+		         <<"ms, binary (mmap): "<<mmap_ms<<"ms"<<std::endl;
+	}
+}
+
+int main(int argc, char** argv) {
+	auto iterations = 0;
+	auto failed = false;
+
+	for(auto i=1; i<argc; ++i) {
+		auto arg = std::string(argv[i]);
+
+		if(arg=="--bench" && i+1<argc) {
+			iterations = std::max(1, std::atoi(argv[++i]));
+			continue;
+		}
+
+		std::ifstream in(arg, std::ios::binary);
+		if(!in) {
+			std::cerr<<"Unable to open "<<arg<<std::endl;
+			failed = true;
+			continue;
+		}
+
+		try {
+			level::Room_template room;
+			room.load(in);
+
+			auto magic = uint32_t(0);
+			in.clear();
+			in.seekg(0);
+			in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+			auto binary = level::is_level_file(&magic, sizeof(magic));
+
+			auto out_path = replace_extension(arg, binary ? ".json" : ".mlvl");
+			std::ofstream out(out_path, std::ios::binary);
+			if(binary)
+				room.export_tiled(out);
+			else
+				room.store(out);
+			out.close();
+
+			std::cout<<arg<<" -> "<<out_path<<" ("<<room.width()<<"x"<<room.height()<<")"<<std::endl;
+
+			if(iterations>0)
+				bench(binary ? out_path : arg, binary ? arg : out_path, iterations);
+
+		} catch(const std::exception& e) {
+			std::cerr<<"Unable to convert "<<arg<<": "<<e.what()<<std::endl;
+			failed = true;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
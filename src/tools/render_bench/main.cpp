@@ -0,0 +1,718 @@
+/**************************************************************************\
+ * render_bench - CPU-side benchmarks of the renderer                     *
+ *                                               ___                      *
+ *    /\/\   __ _  __ _ _ __  _   _ _ __ ___     /___\_ __  _   _ ___     *
+ *   /    \ / _` |/ _` | '_ \| | | | '_ ` _ \   //  // '_ \| | | / __|    *
+ *  / /\/\ \ (_| | (_| | | | | |_| | | | | | | / \_//| |_) | |_| \__ \    *
+ *  \/    \/\__,_|\__, |_| |_|\__,_|_| |_| |_| \___/ | .__/ \__,_|___/    *
+ *                |___/                              |_|                  *
+ *                                                                        *
+ * Copyright (c) 2014 Florian Oetke                                       *
+ *                                                                        *
+ *  This file is part of MagnumOpus and distributed under the MIT License *
+ *  See LICENSE file for details.                                         *
+\**************************************************************************/
+
+
+/*
+ * Measures the parts of the renderer that don't need an OpenGL context,
+ *   with randomly placed sprites.
+ *
+ * usage: render_bench [--sprites N] [--particles N] [--frames N] [--scores N] [--textures FILE...]
+ *
+ *  --scores    highest score of the text cache churn (default: 9999)
+ *  --textures  PNGs to decode and load from the texture cache instead (e.g. all PNGs in assets/textures)
+ *
+ * Returns 0 on success and 1 if the instanced sprites don't match the
+ *   vertices generated on the CPU, the sprites are sorted incorrectly,
+ *   the particle simulation diverges from the reference implementation,
+ *   the text cache exceeds its budget or a texture loaded from the cache
+ *   differs from the decoded one.
+ */
+
+#include "core/renderer/particle_simulation.hpp"
+#include "core/renderer/sprite_geometry.hpp"
+#include "core/renderer/texture_cache.hpp"
+#include "core/renderer/text_cache.hpp"
+#include "core/utils/radix_sort.hpp"
+#include "core/utils/stopwatch.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstdlib>
+#include <random>
+
+namespace mo {namespace renderer {class Texture;}}
+
+using namespace mo;
+using namespace mo::renderer;
+
+namespace {
+	struct Bench_sprite {
+		glm::vec3 position;
+		float rotation;
+		glm::vec2 size;
+		glm::vec4 uv;
+		const Texture* texture;
+		glm::vec2 texture_size; //< in world units
+	};
+
+	/// the camera all sprites are drawn with
+	const auto origin = glm::vec2{50.f, 50.f};
+
+	/// vertex format before the sprites have been packed (with a host pointer in each vertex)
+	struct Legacy_vertex {
+		glm::vec3 pos;
+		glm::vec2 uv;
+		const Texture* tex;
+	};
+
+	void append_legacy_vertices(std::vector<Legacy_vertex>& out, const Bench_sprite& s) {
+		auto half = s.size / 2.f;
+		auto c = glm::cos(s.rotation);
+		auto si = glm::sin(s.rotation);
+
+		auto vertex = [&](float x, float y, float u, float v) {
+			auto p = glm::vec2(s.position) + glm::vec2(c*x - si*y, si*x + c*y);
+			out.push_back(Legacy_vertex{glm::vec3(p, s.position.z), {u, v}, s.texture});
+		};
+
+		vertex(-half.x, -half.y, s.uv.x, s.uv.y);
+		vertex(-half.x,  half.y, s.uv.x, s.uv.w);
+		vertex( half.x,  half.y, s.uv.z, s.uv.w);
+
+		vertex( half.x,  half.y, s.uv.z, s.uv.w);
+		vertex(-half.x, -half.y, s.uv.x, s.uv.y);
+		vertex( half.x, -half.y, s.uv.z, s.uv.y);
+	}
+
+	auto random_sprites(std::size_t count) -> std::vector<Bench_sprite> {
+		auto rng = std::mt19937{42};
+		auto pos = std::uniform_real_distribution<float>{0.f, 100.f};
+		auto rot = std::uniform_real_distribution<float>{0.f, 6.28f};
+		auto layer = std::uniform_int_distribution<int>{0, 3};
+		auto size = std::uniform_real_distribution<float>{4.f, 32.f};
+		auto uv = std::uniform_int_distribution<int>{0, 7};
+		auto texture = std::uniform_int_distribution<std::size_t>{1, 32};
+
+		auto sprites = std::vector<Bench_sprite>{};
+		sprites.reserve(count);
+		for(auto i=0u; i<count; ++i) {
+			auto u = uv(rng)/8.f;
+			auto texture_size = glm::vec2{size(rng), size(rng)/8.f};
+			sprites.push_back(Bench_sprite{
+				{pos(rng), pos(rng), layer(rng)*0.1f},
+				rot(rng),
+				glm::vec2{1/8.f, 1.f} * texture_size,
+				{u, 0.f, u+1/8.f, 1.f},
+				reinterpret_cast<const Texture*>(texture(rng)*64), // only used as a key
+				texture_size
+			});
+		}
+
+		return sprites;
+	}
+
+	void print_result(const char* name, float ms, std::size_t frames, std::size_t bytes) {
+		std::cout<<"  "<<std::left<<std::setw(16)<<name<<std::right<<std::fixed<<std::setprecision(3)
+		         <<std::setw(12)<<(ms/frames)<<" ms/frame"
+		         <<std::setw(12)<<(bytes/1024)<<" KiB/frame"
+		         <<std::setw(12)<<(bytes*60/1024/1024)<<" MiB/s at 60 FPS"<<std::endl;
+	}
+
+	/// a corner in world units relative to the camera, as the vertex shaders see it
+	struct Corner {
+		glm::vec3 pos;
+		glm::vec2 uv;
+	};
+
+	auto unpack(const Sprite_vertex& v) -> Corner {
+		return {glm::vec3(glm::vec2(v.position)/sprite_position_scale, v.layer), glm::vec2(v.uv)/65535.f};
+	}
+	auto unpack(const Legacy_vertex& v) -> Corner {
+		return {v.pos - glm::vec3(origin, 0.f), v.uv};
+	}
+
+	/// expands an instance like sprite_instanced.vert does
+	auto expand(const Sprite_instance& s, glm::vec2 texture_size, glm::vec2 corner) -> Corner {
+		auto uv = glm::vec4(s.uv) / 65535.f;
+		auto layer_rotation = glm::vec2(s.layer_rotation) / 32767.f;
+
+		auto half_size = (glm::vec2(uv.z, uv.w) - glm::vec2(uv.x, uv.y)) * texture_size * sprite_position_scale * 0.5f;
+		auto local = corner * half_size;
+		auto rotation = layer_rotation.y * 3.14159265f;
+		auto c = glm::cos(rotation);
+		auto si = glm::sin(rotation);
+		auto p = glm::vec2(s.position) + glm::vec2(c*local.x - si*local.y, si*local.x + c*local.y);
+
+		return {glm::vec3(p/sprite_position_scale, layer_rotation.x),
+		        glm::mix(glm::vec2(uv.x, uv.y), glm::vec2(uv.z, uv.w), corner*0.5f + 0.5f)};
+	}
+
+	/// the packed formats are exact to about 1/256 world units (positions) and 1/65535 (uv)
+	auto equal(const Corner& a, const Corner& b) {
+		return glm::all(glm::lessThan(glm::abs(a.pos-b.pos), glm::vec3(0.01f)))
+		    && glm::all(glm::lessThan(glm::abs(a.uv-b.uv), glm::vec2(0.0002f)));
+	}
+
+	auto bench_sprites(const std::vector<Bench_sprite>& sprites, std::size_t frames) -> bool {
+		auto legacy_vertices = std::vector<Legacy_vertex>{};
+		auto vertices = std::vector<Sprite_vertex>{};
+		auto instances = std::vector<Sprite_instance>{};
+
+		auto watch = util::Stopwatch{};
+		for(auto f=0u; f<frames; ++f) {
+			legacy_vertices.clear();
+			for(auto& s : sprites)
+				append_legacy_vertices(legacy_vertices, s);
+		}
+		auto legacy_ms = watch.lap_ms();
+
+		for(auto f=0u; f<frames; ++f) {
+			vertices.clear();
+			for(auto& s : sprites)
+				append_sprite_vertices(vertices, glm::vec2(s.position)-origin, s.position.z,
+				                       s.rotation, s.size, s.uv);
+		}
+		auto vertex_ms = watch.lap_ms();
+
+		for(auto f=0u; f<frames; ++f) {
+			instances.clear();
+			for(auto& s : sprites)
+				instances.push_back(make_sprite_instance(glm::vec2(s.position)-origin, s.position.z,
+				                                         s.rotation, s.uv));
+		}
+		auto instance_ms = watch.lap_ms();
+
+		std::cout<<"Sprite geometry for "<<sprites.size()<<" sprites"<<std::endl;
+		print_result("legacy vertices", legacy_ms, frames, legacy_vertices.size()*sizeof(Legacy_vertex));
+		print_result("vertices", vertex_ms, frames, vertices.size()*sizeof(Sprite_vertex));
+		print_result("instances", instance_ms, frames, instances.size()*sizeof(Sprite_instance));
+
+		// the packed vertices (fallback without instancing) trade CPU time for upload bandwidth
+		std::cout<<"  packed vertices take "<<std::setprecision(2)<<(vertex_ms/legacy_ms)
+		         <<"x the CPU time of the legacy vertices for "
+		         <<(100*sizeof(Sprite_vertex)/sizeof(Legacy_vertex))<<"% of the upload"<<std::endl;
+
+		// corners in the order of append_sprite_vertices
+		const glm::vec2 corners[] = {{-1,-1}, {-1,1}, {1,1}, {1,1}, {-1,-1}, {1,-1}};
+		for(auto i=0u; i<instances.size(); ++i) {
+			for(auto c=0u; c<6; ++c) {
+				auto expected = unpack(legacy_vertices[i*6+c]);
+
+				if(!equal(unpack(vertices[i*6+c]), expected)) {
+					std::cerr<<"Vertex "<<(i*6+c)<<" doesn't match the unpacked vertex"<<std::endl;
+					return false;
+				}
+				if(!equal(expand(instances[i], sprites[i].texture_size, corners[c]), expected)) {
+					std::cerr<<"Instance "<<i<<" doesn't match its vertices"<<std::endl;
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	/// sorting the vertices by texture (old) vs. radix sorting the draw keys
+	auto bench_sort(const std::vector<Bench_sprite>& sprites, std::size_t frames) -> bool {
+		auto vertices = std::vector<Legacy_vertex>{};
+		auto instances = std::vector<Sprite_instance>{};
+		auto keys = std::vector<Sprite_draw_key>{};
+		for(auto& s : sprites) {
+			append_legacy_vertices(vertices, s);
+			instances.push_back(make_sprite_instance(glm::vec2(s.position)-origin, s.position.z,
+			                                         s.rotation, s.uv));
+
+			auto texture_id = static_cast<uint32_t>(reinterpret_cast<std::uintptr_t>(s.texture)/64);
+			keys.push_back(Sprite_draw_key{make_draw_key(s.position.z, texture_id),
+			                               static_cast<uint32_t>(keys.size())});
+		}
+
+		auto sorted_vertices = std::vector<Legacy_vertex>{};
+		auto watch = util::Stopwatch{};
+		for(auto f=0u; f<frames; ++f) {
+			sorted_vertices = vertices;
+			std::stable_sort(sorted_vertices.begin(), sorted_vertices.end(), [](auto& a, auto& b) {
+				return a.tex < b.tex;
+			});
+		}
+		auto stable_sort_ms = watch.lap_ms();
+
+		auto sorted_keys = std::vector<Sprite_draw_key>{};
+		auto tmp = std::vector<Sprite_draw_key>{};
+		auto sorted_instances = std::vector<Sprite_instance>{};
+		for(auto f=0u; f<frames; ++f) {
+			sorted_keys = keys;
+			util::radix_sort(sorted_keys, tmp, [](const Sprite_draw_key& k) {return k.key;});
+
+			sorted_instances.clear();
+			for(auto& k : sorted_keys)
+				sorted_instances.push_back(instances[k.index]);
+		}
+		auto radix_sort_ms = watch.lap_ms();
+
+		std::cout<<"  "<<std::setw(8)<<sprites.size()<<std::fixed<<std::setprecision(3)
+		         <<std::setw(14)<<(stable_sort_ms/frames)<<std::setw(14)<<(radix_sort_ms/frames)<<std::endl;
+
+		for(auto i=1u; i<sorted_keys.size(); ++i) {
+			auto& a = sorted_keys[i-1];
+			auto& b = sorted_keys[i];
+			if(a.key>b.key || (a.key==b.key && a.index>b.index)) {
+				std::cerr<<"Draw keys are not sorted (stable) at "<<i<<std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	/// tiles on a 16x16 grid are solid
+	struct Grid_environment : Environment_callback {
+		bool check_collision(int x, int y)const noexcept override {
+			return (x&15)==0 || (y&15)==0;
+		}
+	};
+
+	auto bench_particle_curves() {
+		using namespace unit_literals;
+
+		return Particle_curves{
+			util::scerp(0_deg, 20_deg),
+			util::lerp(Speed_per_time(8), Speed_per_time(0), Speed_per_time(2)),
+			util::lerp(Angle_acceleration(3), Angle_acceleration(0)),
+			util::lerp(glm::vec4(1,0.5,0.2,1), glm::vec4(0.2,0.2,0.2,0), glm::vec4(0.1,0.1,0.1,0)),
+			util::lerp(Position(0.5_m,0.5_m), Position(0.1_m,0.1_m), Position(0.1_m,0.1_m)),
+			util::cerp<int8_t>({0,1,2,3})
+		};
+	}
+
+	/// the particle simulation before it was split into arrays (one Xerp lookup and virtual call per particle)
+	struct Reference_particle {
+		uint16_t  seed;
+		glm::vec2 position;
+		glm::vec2 initial_velocity;
+		glm::vec4 color;
+		glm::vec2 size;
+		float     rotation;
+		float     orientation;
+		float     frame;
+		float     velocity;
+		float     angular_velocity;
+		float     time_to_live;
+		float     max_age;
+	};
+
+	auto simulate_reference(const Particle_curves& c, float dt, const Environment_callback& env,
+	                        Reference_particle& p) -> bool {
+		using namespace unit_literals;
+
+		auto t = (p.max_age-p.time_to_live) / p.max_age;
+
+		p.color    = c.color(t, p.seed);
+		p.size     = remove_units(c.size(t, p.seed));
+		p.frame    = c.frame(t, p.seed);
+
+		p.velocity         += (c.acceleration(t, p.seed)*Time(dt)).value();
+		p.angular_velocity += c.angular_acceleration(t, p.seed).value()*dt;
+
+		p.orientation = normalize(Angle(p.orientation+ p.angular_velocity*dt)).value();
+		p.rotation = p.orientation + c.rotation_offset(t, p.seed).value() - (90_deg).value();
+
+		int x = static_cast<int>(p.position.x+0.5);
+		int y = static_cast<int>(p.position.y+0.5);
+
+		if(env.check_collision(x,y)) {
+			auto rel = glm::vec2{x-p.position.x, y-p.position.y};
+			auto arel = glm::abs(rel);
+
+			if((arel.x<0.01 && arel.y<0.01))
+				return false;
+
+			auto dv = glm::vec2{glm::cos(p.orientation), glm::sin(p.orientation)};
+
+			if(glm::abs(arel.x-arel.y) < 0.01) {
+				dv.x=-dv.x;
+				dv.y=-dv.y;
+			} else if(arel.x > arel.y) {
+				dv.x=-dv.x;
+			} else {
+				dv.y=-dv.y;
+			}
+
+			p.orientation = glm::atan(dv.y, dv.x);
+			p.velocity*=0.9f;
+		}
+
+		auto r = p.velocity * dt;
+		p.position += r*glm::vec2{glm::cos(p.orientation), glm::sin(p.orientation)};
+		p.position += p.initial_velocity * dt;
+
+		p.time_to_live=glm::max(p.time_to_live-dt, 0.f);
+		return p.time_to_live>0;
+	}
+
+	auto bench_particles(std::size_t count, std::size_t frames) -> bool {
+		constexpr auto dt = 1.f/60;
+
+		auto rng = std::mt19937{42};
+		auto pos = std::uniform_real_distribution<float>{1.f, 63.f};
+		auto angle = std::uniform_real_distribution<float>{-3.14f, 3.14f};
+		auto vel = std::uniform_real_distribution<float>{-0.5f, 0.5f};
+
+		// unique seeds, so the particles can be matched with the reference
+		auto seeds = std::vector<uint16_t>(65536);
+		std::iota(seeds.begin(), seeds.end(), 0);
+		std::shuffle(seeds.begin(), seeds.end(), rng);
+
+		auto curves = bench_particle_curves();
+		auto env = Grid_environment{};
+
+		// long lived, so (nearly) all particles are simulated in every frame
+		auto ttl = frames*dt * 4.f;
+
+		auto simulation = Particle_simulation{curves, Collision_handler::bounce, false};
+		auto reference = std::vector<Reference_particle>{};
+		reference.reserve(count);
+
+		for(auto i=0u; i<count; ++i) {
+			auto p = glm::vec2{pos(rng), pos(rng)};
+			auto v = glm::vec2{vel(rng), vel(rng)};
+			auto o = angle(rng);
+			auto s = seeds[i % seeds.size()];
+
+			simulation.add(p, v, o, ttl, s);
+			reference.push_back(Reference_particle{s, p, v, glm::vec4{0}, glm::vec2{0},
+			                                       0, o, 0, 0, 0, ttl, ttl});
+		}
+
+		auto watch = util::Stopwatch{};
+		for(auto f=0u; f<frames; ++f) {
+			auto last = reference.end()-1;
+			for(auto iter=reference.begin(); iter!=last+1;) {
+				if(simulate_reference(curves, dt, env, *iter)) {
+					++iter;
+				} else {
+					std::swap(*last, *iter);
+					last--;
+				}
+			}
+			reference.erase(last+1, reference.end());
+		}
+		auto reference_ms = watch.lap_ms();
+
+		for(auto f=0u; f<frames; ++f)
+			simulation.simulate(dt, env);
+		auto soa_ms = watch.lap_ms();
+
+		auto ns_per_particle = [&](float ms) {
+			return ms*1000.f*1000.f / (frames*count);
+		};
+
+		std::cout<<"Particle simulation for "<<count<<" particles (ns/particle)"<<std::endl;
+		std::cout<<"  "<<std::left<<std::setw(16)<<"reference"<<std::right<<std::fixed<<std::setprecision(2)
+		         <<std::setw(12)<<ns_per_particle(reference_ms)<<std::endl;
+		std::cout<<"  "<<std::left<<std::setw(16)<<"arrays"<<std::right<<std::fixed<<std::setprecision(2)
+		         <<std::setw(12)<<ns_per_particle(soa_ms)<<std::endl;
+
+		if(count>seeds.size()) {
+			std::cout<<"  not verified (more particles than seeds)"<<std::endl;
+			return true;
+		}
+
+		// the simulation stores the frame as the end of its region in the (default 0,0,1,1) uv_rect
+		auto frame_count = curves.frame.max()+1.f;
+
+		auto reference_index = std::vector<int>(seeds.size(), -1);
+		for(auto i=0u; i<reference.size(); ++i)
+			reference_index[reference[i].seed] = static_cast<int>(i);
+
+		// The curve terms (color, size, frame) only depend on the age and seed and have to match.
+		// The positions are rounded differently (fast_sin_cos, the wrapped orientation and the
+		//   order of the integration), which is below 1e-5 per frame. But a particle that is
+		//   moved over a tile border by that bounces at another tile (or dies at a tile center)
+		//   and takes a different path from there on. With std::sin/cos nearly as many particles
+		//   drift (149 instead of 150 at -O3), so this can't be fixed by a more exact sin/cos.
+		//   It's not visible in a particle effect, so up to 1% of the particles may drift.
+		auto& instances = simulation.instances();
+		auto& instance_seeds = simulation.seeds();
+		auto curve_errors = 0u;
+		auto drifted = instances.size()>reference.size() ? instances.size()-reference.size()
+		                                                 : reference.size()-instances.size();
+		auto max_drift = 0.f;
+		for(auto i=0u; i<instances.size(); ++i) {
+			auto ri = reference_index[instance_seeds[i]];
+			if(ri<0) {
+				drifted++;
+				continue;
+			}
+
+			auto& a = instances[i];
+			auto& b = reference[ri];
+			auto curves_equal = glm::all(glm::lessThan(glm::abs(a.color-b.color), glm::vec4(0.001f)))
+			                 && glm::all(glm::lessThan(glm::abs(a.size-b.size), glm::vec2(0.001f)))
+			                 && std::abs(a.uv_rect.z - (b.frame+1.f)/frame_count) < 0.0001f;
+			if(!curves_equal)
+				curve_errors++;
+
+			auto drift = glm::length(a.position-b.position);
+			if(drift>=0.01f) {
+				drifted++;
+				max_drift = std::max(max_drift, drift);
+			}
+		}
+
+		auto max_drifted = count/100;
+		std::cout<<"  "<<curve_errors<<" particles with different curve values (expected 0)\n"
+		         <<"  "<<drifted<<" particles drifted from the reference path by more than 0.01"
+		         <<" (max "<<std::setprecision(2)<<max_drift<<", allowed "<<max_drifted
+		         <<": rounding differences let them bounce at other tiles)"<<std::endl;
+
+		if(curve_errors>0) {
+			std::cerr<<"Particle curves don't match the reference"<<std::endl;
+			return false;
+		}
+		if(drifted>max_drifted) {
+			std::cerr<<"Particle simulation doesn't match the reference"<<std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	auto read_file(const std::string& path) -> std::vector<uint8_t> {
+		std::ifstream in(path, std::ios::binary);
+		return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+	}
+
+	/// decoding the PNGs (a miss of the Texture_loader) vs. reading their cache entries (a hit)
+	auto bench_textures(const std::vector<std::string>& paths) -> bool {
+		auto pngs = std::vector<std::vector<uint8_t>>{};
+		auto png_bytes = std::size_t(0);
+		for(auto& path : paths) {
+			pngs.push_back(read_file(path));
+			png_bytes += pngs.back().size();
+		}
+
+		struct Variant {
+			const char* name;
+			Texture_cache_settings settings;
+		};
+		const Variant variants[] = {
+			{"rgba",         {true, false, false}},
+			{"rgba+mipmaps", {true, true,  false}},
+			{"dxt5+mipmaps", {true, true,  true}}
+		};
+
+		std::cout<<"Texture loading for "<<pngs.size()<<" PNGs ("<<(png_bytes/1024)<<" KiB, cache entries"
+		         <<" read from memory)"<<std::endl;
+		std::cout<<"  "<<std::left<<std::setw(16)<<"settings"<<std::right<<std::setw(12)<<"decode ms"
+		         <<std::setw(12)<<"cache ms"<<std::setw(10)<<"speedup"<<std::setw(14)<<"cache KiB"<<std::endl;
+
+		for(auto& v : variants) {
+			auto entries = std::vector<std::vector<uint8_t>>{};
+			auto decoded = std::vector<Texture_pixels>{};
+
+			// same steps as the worker of the Texture_loader
+			auto watch = util::Stopwatch{};
+			for(auto i=0u; i<pngs.size(); ++i) {
+				auto hash = texture_cache_hash(pngs[i], v.settings);
+				auto pixels = decode_texture(pngs[i], paths[i]);
+				if(pixels.data.empty()) {
+					std::cerr<<"Couldn't decode "<<paths[i]<<std::endl;
+					return false;
+				}
+
+				if(v.settings.mipmaps)
+					generate_mipmaps(pixels);
+				if(v.settings.compression)
+					compress_texture(pixels);
+
+				entries.push_back(write_texture_cache(hash, pixels));
+				decoded.push_back(std::move(pixels));
+			}
+			auto decode_ms = watch.lap_ms();
+
+			auto loaded = std::vector<Texture_pixels>(pngs.size());
+			auto valid = true;
+			for(auto i=0u; i<pngs.size(); ++i) {
+				auto hash = texture_cache_hash(pngs[i], v.settings);
+				valid &= read_texture_cache(entries[i].data(), entries[i].size(), hash, loaded[i]);
+			}
+			auto cache_ms = watch.lap_ms();
+
+			auto entry_bytes = std::size_t(0);
+			for(auto i=0u; i<pngs.size(); ++i) {
+				entry_bytes += entries[i].size();
+
+				if(!valid || loaded[i].data!=decoded[i].data || loaded[i].levels!=decoded[i].levels
+				        || loaded[i].format!=decoded[i].format) {
+					std::cerr<<"Cache entry of "<<paths[i]<<" doesn't match the decoded texture"<<std::endl;
+					return false;
+				}
+			}
+
+			std::cout<<"  "<<std::left<<std::setw(16)<<v.name<<std::right<<std::fixed<<std::setprecision(3)
+			         <<std::setw(12)<<decode_ms<<std::setw(12)<<cache_ms
+			         <<std::setw(9)<<std::setprecision(1)<<(decode_ms/cache_ms)<<"x"
+			         <<std::setw(14)<<(entry_bytes/1024)<<std::endl;
+		}
+
+		return true;
+	}
+
+	/**
+	 * A score that counts from 0 up to max_score and is shown for a few frames each,
+	 *   laid out through the bounded text cache of Font::text(), an unbounded one (as
+	 *   before the budget) and a Text_dynamic::set_number() field; returns false if the
+	 *   bounded cache returns the wrong text or exceeds its budget.
+	 */
+	auto bench_scores(int max_score) -> bool {
+		constexpr auto frames_per_score = 3;
+		constexpr auto score_width = 4;
+
+		using Vertices = std::vector<Font_vertex>;
+
+		auto bounded = Text_cache<Vertices>{};
+		auto unbounded = Text_cache<Vertices>{std::numeric_limits<std::size_t>::max()};
+		auto peak_bytes = std::size_t(0);
+		auto peak_entries = std::size_t(0);
+		auto field = std::string();
+		auto field_quads = std::size_t(0);
+		auto valid = true;
+
+		// six vertices per glyph, the first one marks the score
+		auto text = [](Text_cache<Vertices>& cache, int score) {
+			auto str = std::to_string(score);
+			auto cached = cache.find(str);
+			if(cached)
+				return cached;
+
+			auto vertices = std::make_shared<const Vertices>(str.size()*6,
+			        Font_vertex{{static_cast<float>(score), 0.f}, {0.f, 0.f}});
+			cache.insert(str, vertices, vertices->size()*sizeof(Font_vertex));
+			return vertices;
+		};
+
+		auto watch = util::Stopwatch{};
+		auto bounded_ms = 0.f;
+		for(auto score=0; score<=max_score; ++score) {
+			for(auto f=0; f<frames_per_score; ++f) {
+				watch.reset();
+				auto vertices = text(bounded, score);
+				bounded_ms += watch.ms();
+
+				if(vertices->front().xy.x!=static_cast<float>(score)) {
+					std::cerr<<"The text cache returned the text of "<<vertices->front().xy.x
+					         <<" for "<<score<<std::endl;
+					valid = false;
+				}
+
+				text(unbounded, score);
+
+				// set_number only rewrites the quads of the changed digits
+				auto chars = std::to_string(score);
+				chars.insert(0, std::max(0, score_width-static_cast<int>(chars.size())), ' ');
+				for(auto i=0u; i<chars.size(); ++i)
+					if(field.size()!=chars.size() || field[i]!=chars[i])
+						field_quads++;
+				field = chars;
+			}
+
+			peak_bytes = std::max(peak_bytes, bounded.stats().bytes);
+			peak_entries = std::max(peak_entries, bounded.stats().entries);
+		}
+
+		if(peak_bytes>text_cache_budget) {
+			std::cerr<<"The text cache grew to "<<peak_bytes<<" bytes, its budget is "
+			         <<text_cache_budget<<std::endl;
+			valid = false;
+		}
+
+		auto frames = static_cast<std::size_t>(max_score+1) * frames_per_score;
+		auto print = [&](const char* name, std::size_t entries, std::size_t bytes, const Text_cache_stats& stats) {
+			std::cout<<"  "<<std::left<<std::setw(16)<<name<<std::right
+			         <<std::setw(10)<<entries
+			         <<std::setw(12)<<std::fixed<<std::setprecision(1)<<(bytes/1024.f)
+			         <<std::setw(10)<<stats.hits<<std::setw(10)<<stats.misses
+			         <<std::setw(11)<<stats.evictions<<std::endl;
+		};
+
+		std::cout<<"Score 0-"<<max_score<<", "<<frames_per_score<<" frames each ("
+		         <<std::setprecision(4)<<(bounded_ms*1000.f/frames)<<" us/frame in the bounded cache)"<<std::endl;
+		std::cout<<"  "<<std::left<<std::setw(16)<<"text cache"<<std::right<<std::setw(10)<<"entries"
+		         <<std::setw(12)<<"KiB"<<std::setw(10)<<"hits"<<std::setw(10)<<"misses"
+		         <<std::setw(11)<<"evictions"<<std::endl;
+		print("bounded",   bounded.stats().entries,   bounded.stats().bytes,   bounded.stats());
+		std::cout<<"  "<<std::left<<std::setw(16)<<"bounded (peak)"<<std::right<<std::setw(10)<<peak_entries
+		         <<std::setw(12)<<(peak_bytes/1024.f)<<std::endl;
+		print("unbounded", unbounded.stats().entries, unbounded.stats().bytes, unbounded.stats());
+		std::cout<<"  "<<std::left<<std::setw(16)<<"set_number"<<std::right<<std::setw(10)<<1
+		         <<std::setw(12)<<(score_width*6*sizeof(Font_vertex)/1024.f)
+		         <<"  ("<<field_quads<<" quads rewritten)"<<std::endl;
+
+		return valid;
+	}
+}
+
+int main(int argc, char** argv) {
+	auto sprite_count = 10000;
+	auto particle_count = 50000;
+	auto frames = 100;
+	auto textures = std::vector<std::string>{};
+	auto max_score = 9999;
+
+	for(auto i=1; i<argc; ++i) {
+		auto arg = std::string(argv[i]);
+		auto has_value = i+1<argc;
+
+		if(arg=="--sprites" && has_value)        sprite_count = std::atoi(argv[++i]);
+		else if(arg=="--particles" && has_value) particle_count = std::atoi(argv[++i]);
+		else if(arg=="--frames" && has_value)    frames = std::atoi(argv[++i]);
+		else if(arg=="--scores" && has_value)    max_score = std::atoi(argv[++i]);
+		else if(arg=="--textures" && has_value) {
+			while(i+1<argc && argv[i+1][0]!='-')
+				textures.emplace_back(argv[++i]);
+		}
+		else {
+			std::cerr<<"usage: "<<argv[0]<<" [--sprites N] [--particles N] [--frames N] [--scores N]"
+			         <<" [--textures FILE...]"
+			         <<std::endl;
+			return 1;
+		}
+	}
+
+	if(!textures.empty())
+		return bench_textures(textures) ? 0 : 1;
+
+	auto sprites = random_sprites(static_cast<std::size_t>(std::max(1, sprite_count)));
+	frames = std::max(1, frames);
+
+	auto failed = false;
+
+	if(!bench_sprites(sprites, static_cast<std::size_t>(frames)))
+		failed = true;
+
+	std::cout<<"Sorting sprites (ms/frame)"<<std::endl;
+	std::cout<<"  "<<std::setw(8)<<"sprites"<<std::setw(14)<<"stable_sort"<<std::setw(14)<<"radix_sort"<<std::endl;
+	for(auto count : {1000, 5000, 10000, 50000}) {
+		if(!bench_sort(random_sprites(count), static_cast<std::size_t>(frames)))
+			failed = true;
+	}
+
+	if(!bench_particles(static_cast<std::size_t>(std::max(1, particle_count)), static_cast<std::size_t>(frames)))
+		failed = true;
+
+	if(!bench_scores(std::max(0, max_score)))
+		failed = true;
+
+	return failed ? 1 : 0;
+}